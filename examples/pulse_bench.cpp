@@ -0,0 +1,649 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+
+#include "../include/SharedMemoryRing.h"
+#include "../include/NATSProtocolParser.h"
+#include "../include/ByteScan.h"
+#include "../include/TrafficStats.h"
+#include "../include/LocalHarness.h"
+#include "../include/Tls.h"
+#include "../include/AllocStats.h"
+
+#pragma comment(lib, "Ws2_32.lib")
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    int port = 4222;
+    std::string unixSocketPath;
+    std::string sharedMemoryRing;
+    bool parserOnly = false;
+    bool trafficOnly = false;
+    bool local = false;
+    bool tlsCompare = false;
+    size_t subjects = 16;
+    size_t subscribersPerSubject = 4;
+    int fanoutSubscribers = 0;
+    int messages = 100000;
+    size_t payloadSize = 16;
+};
+
+class BenchConnection {
+public:
+    BenchConnection() : socket_(INVALID_SOCKET) {
+    }
+
+    ~BenchConnection() {
+        tls_.reset();
+        if (socket_ != INVALID_SOCKET) {
+            closesocket(socket_);
+        }
+    }
+
+    // With tls set, INFO is read in the clear and everything after it goes
+    // through a TLS session. Without verbose, a PING round trip stands in for
+    // the +OK.
+    bool connect(const BenchOptions& options, const std::shared_ptr<pulse_broker::TlsContext>& tls = nullptr,
+                 bool verbose = true) {
+        if (options.unixSocketPath.empty()) {
+            socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (socket_ == INVALID_SOCKET) {
+                return false;
+            }
+
+            sockaddr_in serverAddr;
+            serverAddr.sin_family = AF_INET;
+            serverAddr.sin_port = htons(options.port);
+            inet_pton(AF_INET, options.host.c_str(), &(serverAddr.sin_addr));
+
+            if (::connect(socket_, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+                return false;
+            }
+        } else {
+            socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (socket_ == INVALID_SOCKET) {
+                return false;
+            }
+
+            sockaddr_un serverAddr = {};
+            serverAddr.sun_family = AF_UNIX;
+            options.unixSocketPath.copy(serverAddr.sun_path, sizeof(serverAddr.sun_path) - 1);
+
+            if (::connect(socket_, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+                return false;
+            }
+        }
+
+        std::string info = readLine();
+        if (info.substr(0, 4) != "INFO") {
+            return false;
+        }
+
+        if (tls) {
+            tls_ = tls->createSession(static_cast<int>(socket_));
+            if (!tls_ || !tls_->connect()) {
+                return false;
+            }
+        }
+
+        if (!verbose) {
+            return send("CONNECT {\"verbose\":false}\r\nPING\r\n") && readLine() == "PONG";
+        }
+        return send("CONNECT {}\r\n") && readLine() == "+OK";
+    }
+
+    bool isKernelTls() const {
+        return tls_ && tls_->isKernelSend();
+    }
+
+    bool send(const std::string& data) {
+        if (!tls_) {
+            return ::send(socket_, data.c_str(), static_cast<int>(data.size()), 0) != SOCKET_ERROR;
+        }
+
+        size_t offset = 0;
+        while (offset < data.size()) {
+            int sent = tls_->write(data.data() + offset, data.size() - offset);
+            if (sent <= 0) {
+                return false;
+            }
+            offset += static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    std::string readLine() {
+        size_t end;
+        while ((end = buffer_.find("\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return "";
+            }
+        }
+
+        std::string line = buffer_.substr(0, end);
+        buffer_.erase(0, end + 2);
+        return line;
+    }
+
+    bool readMsg(size_t payloadSize) {
+        std::string header = readLine();
+        if (header.substr(0, 4) != "MSG ") {
+            return false;
+        }
+
+        while (buffer_.size() < payloadSize + 2) {
+            if (!fill()) {
+                return false;
+            }
+        }
+
+        buffer_.erase(0, payloadSize + 2);
+        return true;
+    }
+
+private:
+    SOCKET socket_;
+    std::string buffer_;
+    std::unique_ptr<pulse_broker::TlsSession> tls_;
+
+    bool fill() {
+        char chunk[pulse_broker::TlsSession::MAX_RECORD_SIZE];
+        int bytesReceived = tls_ ? tls_->read(chunk, sizeof(chunk)) : recv(socket_, chunk, sizeof(chunk), 0);
+        if (bytesReceived <= 0) {
+            return false;
+        }
+
+        buffer_.append(chunk, bytesReceived);
+        return true;
+    }
+};
+
+static double percentile(std::vector<double>& samples, double p) {
+    size_t index = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+static int runLatency(const BenchOptions& options) {
+    BenchConnection publisher;
+    BenchConnection subscriber;
+
+    if (!publisher.connect(options) || !subscriber.connect(options)) {
+        std::cerr << "Failed to connect to server" << std::endl;
+        return 1;
+    }
+
+    if (!subscriber.send("SUB bench.latency 1\r\n") || subscriber.readLine() != "+OK") {
+        std::cerr << "Failed to subscribe" << std::endl;
+        return 1;
+    }
+
+    std::string payload(options.payloadSize, 'x');
+    std::string pub = "PUB bench.latency " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+
+    std::vector<double> samples;
+    samples.reserve(options.messages);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < options.messages; i++) {
+        auto sent = std::chrono::steady_clock::now();
+
+        if (!publisher.send(pub) || !subscriber.readMsg(payload.size()) || publisher.readLine() != "+OK") {
+            std::cerr << "Transport error after " << i << " messages" << std::endl;
+            return 1;
+        }
+
+        auto received = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(received - sent).count());
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Transport:   " << (options.unixSocketPath.empty() ? "tcp" : "unix") << std::endl;
+    std::cout << "Messages:    " << options.messages << " x " << options.payloadSize << " bytes" << std::endl;
+    std::cout << "Throughput:  " << static_cast<long long>(options.messages / elapsed) << " msgs/s" << std::endl;
+    std::cout << "Latency p50: " << percentile(samples, 0.50) << " us" << std::endl;
+    std::cout << "Latency p99: " << percentile(samples, 0.99) << " us" << std::endl;
+    return 0;
+}
+
+static int runFanout(const BenchOptions& options) {
+    BenchConnection publisher;
+    if (!publisher.connect(options)) {
+        std::cerr << "Failed to connect to server" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<BenchConnection>> subscribers;
+    for (int i = 0; i < options.fanoutSubscribers; i++) {
+        std::unique_ptr<BenchConnection> subscriber(new BenchConnection());
+        if (!subscriber->connect(options) || !subscriber->send("SUB bench.fanout 1\r\n") || subscriber->readLine() != "+OK") {
+            std::cerr << "Failed to subscribe connection " << i << std::endl;
+            return 1;
+        }
+        subscribers.push_back(std::move(subscriber));
+    }
+
+    std::string payload(options.payloadSize, 'x');
+    std::string pub = "PUB bench.fanout " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+
+    // Each reader drains its slice of subscribers once per message; a publish
+    // counts as delivered when every reader has finished that message.
+    size_t readerCount = std::thread::hardware_concurrency();
+    if (readerCount == 0 || readerCount > 8) {
+        readerCount = readerCount == 0 ? 1 : 8;
+    }
+    std::atomic<size_t> finished(0);
+    std::atomic<bool> failed(false);
+
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < readerCount; r++) {
+        readers.emplace_back([&, r]() {
+            for (int m = 0; m < options.messages && !failed; m++) {
+                for (size_t i = r; i < subscribers.size(); i += readerCount) {
+                    if (!subscribers[i]->readMsg(payload.size())) {
+                        failed = true;
+                        break;
+                    }
+                }
+                finished++;
+            }
+        });
+    }
+
+    std::vector<double> samples;
+    samples.reserve(options.messages);
+
+    for (int m = 0; m < options.messages && !failed; m++) {
+        auto sent = std::chrono::steady_clock::now();
+
+        if (!publisher.send(pub) || publisher.readLine() != "+OK") {
+            failed = true;
+            break;
+        }
+        while (finished < readerCount * (m + 1) && !failed) {
+            std::this_thread::yield();
+        }
+
+        auto delivered = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(delivered - sent).count());
+    }
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    if (failed) {
+        std::cerr << "Transport error during fan-out" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Fan-out:     " << subscribers.size() << " subscribers, " << options.messages << " x "
+              << options.payloadSize << " bytes" << std::endl;
+    std::cout << "Broadcast p50: " << percentile(samples, 0.50) << " us" << std::endl;
+    std::cout << "Broadcast p99: " << percentile(samples, 0.99) << " us" << std::endl;
+    return 0;
+}
+
+static int runSharedMemory(const BenchOptions& options) {
+    BenchConnection subscriber;
+
+    if (!subscriber.connect(options)) {
+        std::cerr << "Failed to connect to server" << std::endl;
+        return 1;
+    }
+
+    if (!subscriber.send("SUB bench.shm 1\r\n") || subscriber.readLine() != "+OK") {
+        std::cerr << "Failed to subscribe" << std::endl;
+        return 1;
+    }
+
+    auto ring = pulse_broker::SharedMemoryRing::attach(options.sharedMemoryRing);
+    if (!ring) {
+        std::cerr << "Failed to attach to shared memory ring " << options.sharedMemoryRing << std::endl;
+        return 1;
+    }
+
+    std::string payload(options.payloadSize, 'x');
+    int received = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread reader([&]() {
+        while (received < options.messages && subscriber.readMsg(payload.size())) {
+            received++;
+        }
+    });
+
+    for (int i = 0; i < options.messages; i++) {
+        ring->publish("bench.shm", payload);
+    }
+
+    reader.join();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Transport:   shm (" << options.sharedMemoryRing << ")" << std::endl;
+    std::cout << "Messages:    " << received << "/" << options.messages << " x " << options.payloadSize << " bytes" << std::endl;
+    std::cout << "Throughput:  " << static_cast<long long>(received / elapsed) << " msgs/s" << std::endl;
+    return received == options.messages ? 0 : 1;
+}
+
+static int runParser(const BenchOptions& options) {
+    std::string payload(options.payloadSize, 'x');
+    std::string pub = "PUB bench.parser.subject " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+
+    std::string stream;
+    stream.reserve(pub.size() * options.messages);
+    for (int i = 0; i < options.messages; i++) {
+        stream += pub;
+    }
+
+    pulse_broker::NATSProtocolParser parser;
+    pulse_broker::Command command;
+    std::vector<pulse_broker::ScanLevel> levels = {pulse_broker::ScanLevel::SCALAR};
+    if (pulse_broker::detectScanLevel() != pulse_broker::ScanLevel::SCALAR) {
+        levels.push_back(pulse_broker::ScanLevel::SSE2);
+    }
+    if (pulse_broker::detectScanLevel() == pulse_broker::ScanLevel::AVX2) {
+        levels.push_back(pulse_broker::ScanLevel::AVX2);
+    }
+
+    std::cout << "Stream:      " << options.messages << " x PUB with " << options.payloadSize << " byte payload" << std::endl;
+
+    for (auto level : levels) {
+        pulse_broker::setScanLevel(level);
+
+        auto start = std::chrono::steady_clock::now();
+
+        size_t offset = 0;
+        int parsed = 0;
+        while (offset < stream.size()) {
+            size_t consumed;
+            if (parser.parse(stream.data() + offset, stream.size() - offset, command, consumed)) {
+                parsed++;
+            }
+            offset += consumed;
+        }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << pulse_broker::scanLevelName(level) << ": " << static_cast<long long>(parsed / elapsed) << " msgs/s, "
+                  << static_cast<long long>(stream.size() / elapsed / (1024 * 1024)) << " MB/s" << std::endl;
+    }
+
+    pulse_broker::setScanLevel(pulse_broker::detectScanLevel());
+    return 0;
+}
+
+static int runTraffic(const BenchOptions& options) {
+    std::vector<std::string> subjects;
+    for (int i = 0; i < 1000; i++) {
+        subjects.push_back("bench.traffic." + std::to_string(i));
+    }
+
+    pulse_broker::TrafficStats stats;
+    const char publisher[] = "cid:1";
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < options.messages; i++) {
+        // Every other message goes to one hot subject, the rest spread out.
+        const std::string& subject = (i & 1) ? subjects[0] : subjects[i % subjects.size()];
+        stats.record(subject, publisher, sizeof(publisher) - 1, options.payloadSize);
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    pulse_broker::TrafficReport report = stats.getReport();
+
+    std::cout << "Records:     " << options.messages << " over " << subjects.size() << " subjects" << std::endl;
+    std::cout << "Throughput:  " << static_cast<long long>(options.messages / elapsed) << " records/s, "
+              << elapsed * 1e9 / options.messages << " ns/record" << std::endl;
+    std::cout << "Memory:      " << stats.getMemoryUsage() / 1024 << " KiB" << std::endl;
+    if (!report.current.subjectsByMessages.empty()) {
+        std::cout << "Hottest:     " << report.current.subjectsByMessages[0].key << " ("
+                  << report.current.subjectsByMessages[0].messages << " msgs)" << std::endl;
+    }
+    return 0;
+}
+
+static int runLocal(const BenchOptions& options) {
+    pulse_broker::ServerOptions serverOptions;
+    serverOptions.trafficStats = false;
+    pulse_broker::LocalHarness harness(serverOptions);
+    if (!harness.start()) {
+        std::cerr << "Failed to start in-process server" << std::endl;
+        return 1;
+    }
+
+    pulse_broker::Workload workload;
+    workload.subjects = options.subjects;
+    workload.subscribersPerSubject = options.subscribersPerSubject;
+    workload.messages = static_cast<size_t>(options.messages);
+    workload.payloadSize = options.payloadSize;
+
+    pulse_broker::AllocRegistry::reset();
+    pulse_broker::WorkloadResult result = harness.run(workload);
+    std::vector<pulse_broker::AllocReport> allocations = pulse_broker::AllocRegistry::getReport();
+    harness.stop();
+
+    if (!result.complete) {
+        std::cerr << "Workload incomplete: " << result.delivered << " of " << result.expectedDeliveries
+                  << " deliveries" << std::endl;
+        return 1;
+    }
+
+    std::cout << "In-process:  " << workload.subjects << " subjects x " << workload.subscribersPerSubject
+              << " subscribers, " << result.published << " x " << options.payloadSize << " bytes" << std::endl;
+    std::cout << "Published:   " << static_cast<long long>(result.published / result.elapsedSeconds) << " msgs/s"
+              << std::endl;
+    std::cout << "Delivered:   " << static_cast<long long>(result.delivered / result.elapsedSeconds) << " msgs/s, "
+              << static_cast<long long>(result.deliveredBytes / result.elapsedSeconds / (1024 * 1024)) << " MB/s"
+              << std::endl;
+
+    if (pulse_broker::AllocRegistry::isEnabled()) {
+        for (const auto& report : allocations) {
+            std::cout << "Allocs " << report.tag << ": "
+                      << static_cast<double>(report.allocations) / std::max<uint64_t>(result.published, 1)
+                      << " per msg, " << report.allocatedBytes / std::max<uint64_t>(result.published, 1)
+                      << " bytes per msg, " << report.liveBytes / 1024 << " KiB live" << std::endl;
+        }
+    }
+    return 0;
+}
+
+// Streams messages from one publisher to one subscriber through an
+// in-process broker on loopback, in plaintext, with TLS records encrypted by
+// OpenSSL in user space and, where the platform has kTLS, with them handed
+// to the kernel. Each run listens on its own port, starting at --port.
+static int runTlsCompare(const BenchOptions& options) {
+    if (!pulse_broker::TlsContext::isAvailable()) {
+        std::cerr << "pulse_bench was built without TLS (configure with -DPULSE_BROKER_TLS=ON)" << std::endl;
+        return 1;
+    }
+
+    struct Mode {
+        const char* name;
+        bool tls;
+        bool kernel;
+    };
+    const Mode modes[] = {{"plaintext", false, false}, {"tls", true, false}, {"ktls", true, true}};
+
+    std::string payload(options.payloadSize, 'x');
+    std::string pub = "PUB bench.tls " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+    const int batch = 64;
+
+    std::cout << "Stream:      " << options.messages << " x " << options.payloadSize << " bytes over loopback" << std::endl;
+
+    int port = options.port;
+    for (const Mode& mode : modes) {
+        if (mode.kernel && !pulse_broker::TlsContext::isKernelOffloadAvailable()) {
+            std::cout << mode.name << ": skipped, kernel TLS is not available on this platform" << std::endl;
+            continue;
+        }
+
+        pulse_broker::ServerOptions serverOptions;
+        serverOptions.host = "127.0.0.1";
+        serverOptions.port = port++;
+        serverOptions.trafficStats = false;
+
+        std::string error;
+        std::shared_ptr<pulse_broker::TlsContext> clientTls;
+        if (mode.tls) {
+            serverOptions.tls = pulse_broker::TlsContext::createSelfSigned(mode.kernel, error);
+            clientTls = pulse_broker::TlsContext::createClient(mode.kernel, error);
+            if (!serverOptions.tls || !clientTls) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        }
+
+        pulse_broker::NATSServer server(serverOptions);
+        if (!server.start()) {
+            std::cerr << "Failed to start server on port " << serverOptions.port << std::endl;
+            return 1;
+        }
+
+        BenchOptions connectOptions = options;
+        connectOptions.host = serverOptions.host;
+        connectOptions.port = serverOptions.port;
+        connectOptions.unixSocketPath.clear();
+
+        BenchConnection publisher;
+        BenchConnection subscriber;
+        if (!publisher.connect(connectOptions, clientTls, false) || !subscriber.connect(connectOptions, clientTls, false) ||
+            !subscriber.send("SUB bench.tls 1\r\nPING\r\n") || subscriber.readLine() != "PONG") {
+            std::cerr << "Failed to connect to server" << std::endl;
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::thread writer([&]() {
+            std::string chunk;
+            for (int i = 0; i < options.messages; i += batch) {
+                chunk.clear();
+                for (int j = i; j < options.messages && j < i + batch; j++) {
+                    chunk += pub;
+                }
+                if (!publisher.send(chunk)) {
+                    break;
+                }
+            }
+        });
+
+        int received = 0;
+        while (received < options.messages && subscriber.readMsg(payload.size())) {
+            received++;
+        }
+        writer.join();
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        server.stop();
+
+        if (received < options.messages) {
+            std::cerr << mode.name << ": received " << received << " of " << options.messages << std::endl;
+            return 1;
+        }
+
+        std::cout << mode.name << ": " << static_cast<long long>(received / elapsed) << " msgs/s, "
+                  << static_cast<long long>(static_cast<double>(received) * payload.size() / elapsed / (1024 * 1024))
+                  << " MB/s";
+        if (mode.kernel && !subscriber.isKernelTls()) {
+            std::cout << " (kernel TLS unavailable, records encrypted in user space)";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) {
+            options.host = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            options.port = std::stoi(argv[++i]);
+        } else if (arg == "--unix" && i + 1 < argc) {
+            options.unixSocketPath = argv[++i];
+        } else if (arg == "--shm" && i + 1 < argc) {
+            options.sharedMemoryRing = argv[++i];
+        } else if (arg == "--parser") {
+            options.parserOnly = true;
+        } else if (arg == "--traffic") {
+            options.trafficOnly = true;
+        } else if (arg == "--local") {
+            options.local = true;
+        } else if (arg == "--tls-compare") {
+            options.tlsCompare = true;
+        } else if (arg == "--subjects" && i + 1 < argc) {
+            options.subjects = std::stoul(argv[++i]);
+        } else if (arg == "--subscribers" && i + 1 < argc) {
+            options.subscribersPerSubject = std::stoul(argv[++i]);
+        } else if (arg == "--fanout" && i + 1 < argc) {
+            options.fanoutSubscribers = std::stoi(argv[++i]);
+        } else if (arg == "--msgs" && i + 1 < argc) {
+            options.messages = std::stoi(argv[++i]);
+        } else if (arg == "--size" && i + 1 < argc) {
+            options.payloadSize = std::stoul(argv[++i]);
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  --host <host>     Server host (default: 127.0.0.1)" << std::endl;
+            std::cout << "  --port <port>     Server port (default: 4222)" << std::endl;
+            std::cout << "  --unix <path>     Connect over a Unix domain socket instead of TCP" << std::endl;
+            std::cout << "  --shm <name>      Publish through a shared memory ring (--shm-ring on the server)" << std::endl;
+            std::cout << "  --parser          Benchmark the protocol parser on an in-memory PUB stream" << std::endl;
+            std::cout << "  --traffic         Benchmark the publish-path traffic analytics" << std::endl;
+            std::cout << "  --fanout <n>      Time broadcasts to n subscribers of one subject" << std::endl;
+            std::cout << "  --local           Run a seeded pub/sub workload against an in-process broker" << std::endl;
+            std::cout << "  --tls-compare     Compare plaintext and TLS throughput over loopback (and kernel TLS where available)" << std::endl;
+            std::cout << "  --subjects <n>    Subjects in the --local workload (default: 16)" << std::endl;
+            std::cout << "  --subscribers <n> Subscribers per subject in the --local workload (default: 4)" << std::endl;
+            std::cout << "  --msgs <count>    Number of messages (default: 100000)" << std::endl;
+            std::cout << "  --size <bytes>    Payload size (default: 16)" << std::endl;
+            return 0;
+        }
+    }
+
+    if (options.parserOnly) {
+        return runParser(options);
+    }
+    if (options.trafficOnly) {
+        return runTraffic(options);
+    }
+    if (options.local) {
+        return runLocal(options);
+    }
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed" << std::endl;
+        return 1;
+    }
+
+    int result;
+    if (options.tlsCompare) {
+        result = runTlsCompare(options);
+    } else if (!options.sharedMemoryRing.empty()) {
+        result = runSharedMemory(options);
+    } else if (options.fanoutSubscribers > 0) {
+        result = runFanout(options);
+    } else {
+        result = runLatency(options);
+    }
+
+    WSACleanup();
+    return result;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "LockStats.h"
+#include "SubjectTable.h"
+#include "Subscription.h"
+#include "MessageHistory.h"
+#include "WorkQueue.h"
+
+namespace pulse_broker {
+
+// Subjects starting with prefix in account are delivered to the importing
+// account as well. The exporting account has to export a prefix covering it.
+struct AccountImport {
+    std::string account;
+    std::string prefix;
+};
+
+// Clients whose CONNECT carries one of users join the account.
+struct AccountConfig {
+    std::string name;
+    std::vector<std::string> users;
+    std::vector<std::string> exports;
+    std::vector<AccountImport> imports;
+};
+
+// A subject namespace of its own: subscriptions, retained history, work
+// queues and the lock guarding them are per account, so one tenant's SUB
+// churn does not contend with another's publishes. Subject strings are
+// still interned in the server's shared SubjectTable, which is thread-safe.
+class Account {
+public:
+    struct Importer {
+        Account* account;
+        std::string prefix;
+    };
+
+    Account(const std::string& name, SubjectTable& subjects, const std::vector<SubjectHistoryLimit>& history,
+            const std::vector<WorkQueueConfig>& workQueues);
+
+    Account(const Account&) = delete;
+    Account& operator=(const Account&) = delete;
+
+    const std::string& getName() const { return name_; }
+
+    // Guarded by getMutex().
+    SubscriptionStore& getSubscriptions() { return subscriptions_; }
+    MessageHistory* getHistory() { return history_.get(); }
+    WorkQueues* getWorkQueues() { return workQueues_.get(); }
+    BrokerMutex& getMutex() { return mutex_; }
+
+    // Fixed once the accounts are built, so read without a lock.
+    const std::vector<Importer>& getImporters() const { return importers_; }
+
+private:
+    friend class Accounts;
+
+    std::string name_;
+    SubscriptionStore subscriptions_;
+    std::unique_ptr<MessageHistory> history_;
+    std::unique_ptr<WorkQueues> workQueues_;
+    BrokerMutex mutex_{"Account::mutex_"};
+    std::vector<Importer> importers_;
+};
+
+// The global account, which takes every client not assigned elsewhere, plus
+// the configured ones. Built once at startup.
+class Accounts {
+public:
+    static const char* const GLOBAL;
+
+    Accounts(SubjectTable& subjects, const std::vector<AccountConfig>& configs,
+             const std::vector<SubjectHistoryLimit>& history, const std::vector<WorkQueueConfig>& workQueues);
+
+    Accounts(const Accounts&) = delete;
+    Accounts& operator=(const Accounts&) = delete;
+
+    Account& getGlobal() { return *accounts_.front(); }
+
+    // The account for a CONNECT user; the global account if none claims it.
+    Account& findByUser(const std::string& user);
+
+    // nullptr if there is no account called name.
+    Account* find(const std::string& name);
+
+    const std::vector<std::unique_ptr<Account>>& getAll() const { return accounts_; }
+
+    // Checks names, users and that every import is covered by an export,
+    // describing the first problem in error.
+    static bool validate(const std::vector<AccountConfig>& configs, std::string& error);
+
+private:
+    std::vector<std::unique_ptr<Account>> accounts_;
+    std::unordered_map<std::string, Account*> byName_;
+    std::unordered_map<std::string, Account*> byUser_;
+};
+
+} // namespace pulse_broker
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+// Subsystems whose heap use is counted in a PULSE_BROKER_ALLOC_STATS build.
+// NONE is everything else and is not reported.
+enum class AllocTag : uint8_t {
+    NONE,
+    PARSER,
+    SUBSCRIPTIONS,
+    CLIENT_BUFFERS,
+    OUTBOUND_FRAMES,
+    COUNT
+};
+
+const char* allocTagName(AllocTag tag);
+
+struct AllocReport {
+    std::string tag;
+    uint64_t liveBytes = 0;
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t allocatedBytes = 0;
+    double allocationsPerSecond = 0;
+};
+
+// Counters per tag. Allocation counts and rates cover the time since the
+// last reset; live bytes are what is held now, whenever it was allocated.
+class AllocRegistry {
+public:
+    static void recordAllocation(AllocTag tag, size_t bytes);
+    static void recordDeallocation(AllocTag tag, size_t bytes);
+
+    static std::vector<AllocReport> getReport();
+    static void reset();
+
+    static bool isEnabled();
+    static std::string toJson();
+};
+
+// Attributes operator new calls on this thread to tag until the scope
+// ends, for strings that cross subsystem boundaries as std::string. Each
+// block remembers its tag, so it is uncounted on delete wherever that
+// happens. A no-op unless built with PULSE_BROKER_ALLOC_STATS.
+class AllocScope {
+public:
+#ifdef PULSE_BROKER_ALLOC_STATS
+    explicit AllocScope(AllocTag tag);
+    ~AllocScope();
+#else
+    explicit AllocScope(AllocTag) {}
+#endif
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+#ifdef PULSE_BROKER_ALLOC_STATS
+    AllocTag previous_;
+#endif
+};
+
+// std::allocator that counts what it hands out under Tag.
+template <typename T, AllocTag Tag>
+class CountingAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = CountingAllocator<U, Tag>;
+    };
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U, Tag>&) {}
+
+    T* allocate(size_t count) {
+        T* block;
+        {
+            AllocScope untagged(AllocTag::NONE);
+            block = static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+        AllocRegistry::recordAllocation(Tag, count * sizeof(T));
+        return block;
+    }
+
+    void deallocate(T* block, size_t count) {
+        AllocRegistry::recordDeallocation(Tag, count * sizeof(T));
+        ::operator delete(block);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U, Tag>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U, Tag>&) const { return false; }
+};
+
+// Containers private to a subsystem take their allocator from here, so a
+// build with PULSE_BROKER_ALLOC_STATS counts them per tag; otherwise they
+// use std::allocator.
+#ifdef PULSE_BROKER_ALLOC_STATS
+template <typename T, AllocTag Tag>
+using BrokerAllocator = CountingAllocator<T, Tag>;
+#else
+template <typename T, AllocTag Tag>
+using BrokerAllocator = std::allocator<T>;
+#endif
+
+template <AllocTag Tag>
+using BrokerString = std::basic_string<char, std::char_traits<char>, BrokerAllocator<char, Tag>>;
+
+} // namespace pulse_broker
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+// Length-prefixed framing for clients that would rather not scan text,
+// turned on by "binary":true in CONNECT. Everything after that CONNECT, in
+// both directions, is a frame:
+//   uint32 body size, uint8 type, 3 zero bytes, body
+// PUB and MSG bodies hold one or more records:
+//   uint32 id, uint32 payload size, uint16 reply size, 2 zero bytes,
+//   reply subject, payload
+// All integers are little-endian. A PUB record's id is a subject ID the
+// client registered earlier with SUBJECT (uint32 ID, then the subject); a
+// MSG record's id is the sid of the subscription it matched. SUB carries a
+// uint32 sid and a uint32 subject ID, UNSUB the uint32 sid, ERR and INFO
+// their text; PING, PONG and OK have empty bodies.
+enum class FrameType : uint8_t {
+    PING = 1,
+    PONG,
+    OK,
+    ERR,
+    INFO,
+    SUBJECT,
+    SUB,
+    UNSUB,
+    PUB,
+    MSG
+};
+
+struct BinaryFrame {
+    FrameType type = FrameType::PING;
+    const char* body = nullptr;
+    size_t size = 0;
+};
+
+struct BinaryRecord {
+    uint32_t id = 0;
+    const char* replyTo = nullptr;
+    size_t replySize = 0;
+    const char* payload = nullptr;
+    size_t payloadSize = 0;
+};
+
+// Per-connection state, used only by the connection's IoLoop thread.
+struct BinarySession {
+    std::unordered_map<uint32_t, std::string> subjects;
+
+    // Records of the PUB frame at the head of the input already published
+    // before a rate limit held the rest back.
+    size_t resumeRecord = 0;
+};
+
+class BinaryProtocol {
+public:
+    static const size_t FRAME_HEADER_SIZE = 8;
+    static const size_t RECORD_HEADER_SIZE = 12;
+
+    // Returns the size of the frame at data, or 0 until all of it has
+    // arrived. frame.size is set as soon as the header has.
+    static size_t parseFrame(const char* data, size_t size, BinaryFrame& frame);
+
+    // Reads the record at offset in a PUB or MSG body and moves offset past
+    // it. False if the record runs past the end of the body.
+    static bool readRecord(const BinaryFrame& frame, size_t& offset, BinaryRecord& record);
+
+    static void appendFrameHeader(std::string& out, FrameType type, size_t bodySize);
+    static void appendRecordHeader(std::string& out, uint32_t id, const std::string& replyTo, size_t payloadSize);
+    static size_t getRecordSize(const std::string& replyTo, size_t payloadSize) {
+        return RECORD_HEADER_SIZE + replyTo.size() + payloadSize;
+    }
+
+    // A MSG frame holding one record, up to its payload.
+    static std::string generateMsgHeader(uint32_t sid, const std::string& replyTo, size_t payloadSize);
+
+    static std::string generateFrame(FrameType type, const std::string& body = std::string());
+    static std::string generateSubject(uint32_t subjectId, const std::string& subject);
+    static std::string generateSub(uint32_t sid, uint32_t subjectId);
+    static std::string generateUnsub(uint32_t sid);
+
+    // Re-encodes a text protocol reply (PING, PONG, +OK, -ERR, INFO).
+    static std::string fromTextControl(const std::string& line);
+
+    // Binary sids are stored as their decimal text, like text sids.
+    static bool parseSid(const std::string& sid, uint32_t& value);
+
+    static uint32_t readU32(const char* data);
+    static uint16_t readU16(const char* data);
+    static void appendU32(std::string& out, uint32_t value);
+    static void appendU16(std::string& out, uint16_t value);
+};
+
+} // namespace pulse_broker
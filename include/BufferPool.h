@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "LockStats.h"
+#include "AllocStats.h"
+
+namespace pulse_broker {
+
+using ReadBuffer = BrokerString<AllocTag::CLIENT_BUFFERS>;
+
+class BufferPool {
+public:
+    BufferPool(size_t bufferCapacity = 16 * 1024, size_t maxPooled = 256);
+    ~BufferPool() = default;
+
+    std::unique_ptr<ReadBuffer> acquire();
+    void release(std::unique_ptr<ReadBuffer> buffer);
+
+    size_t getBufferCapacity() const { return bufferCapacity_; }
+    size_t getPooledCount() const;
+    size_t getOutstandingCount() const;
+
+private:
+    size_t bufferCapacity_;
+    size_t maxPooled_;
+    size_t outstanding_;
+
+    std::vector<std::unique_ptr<ReadBuffer>> free_;
+
+    mutable BrokerMutex mutex_{"BufferPool::mutex_"};
+};
+
+} // namespace pulse_broker
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+enum class ScanLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+struct FieldSpan {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct HeaderScan {
+    static const size_t MAX_FIELDS = 8;
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    size_t lineEnd = NOT_FOUND;
+    size_t fieldCount = 0;
+    FieldSpan fields[MAX_FIELDS];
+};
+
+ScanLevel detectScanLevel();
+ScanLevel getScanLevel();
+void setScanLevel(ScanLevel level);
+const char* scanLevelName(ScanLevel level);
+
+// Finds the first "\r\n" and splits everything before it into whitespace
+// separated fields in a single pass. lineEnd is the offset of the '\r'.
+bool scanHeader(const char* data, size_t size, HeaderScan& scan);
+
+} // namespace pulse_broker
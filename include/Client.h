@@ -2,42 +2,195 @@
 
 #include <string>
 #include <unordered_map>
+#include <deque>
+#include <vector>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include "NATSProtocolParser.h"
+#include "LockStats.h"
+#include "AllocStats.h"
+#include "Subscription.h"
+#include "RateLimiter.h"
+#include "MemoryBudget.h"
+#include "BinaryProtocol.h"
+#include "Tls.h"
 
 namespace pulse_broker {
 
-class Subscription;
+class IoLoop;
+class Account;
 
 class Client {
 public:
+    static const size_t MAX_PENDING_DATA = 64 * 1024 * 1024;
+
     Client(int socket, const std::string& host, const std::string& ip);
     ~Client();
 
+    // Protocol replies (INFO, +OK, -ERR, PING, PONG) go through the control
+    // lane and MSG frames through the data lane. Once the socket backs up,
+    // both are queued and the owning IoLoop flushes queued control frames
+    // ahead of queued data, so heartbeats do not wait behind a data backlog.
+    bool sendControl(const std::string& message);
     bool sendMessage(const std::string& message);
-    std::string receiveMessage();
+
+    // Sends header, payload and, in text framing, the closing CRLF in one
+    // gather write. The payload is only copied if the socket cannot take all
+    // of it now.
+    bool sendMessage(const std::string& header, const char* payload, size_t payloadSize);
+
+    // Over TLS, reads as many whole records as fit, so no decrypted input
+    // is left inside OpenSSL where poll() cannot see it.
+    int receive(char* buffer, size_t size);
     
-    bool addSubscription(const std::string& subject, const std::string& sid);
-    bool removeSubscription(const std::string& sid);
-    bool hasSubscription(const std::string& subject) const;
-    std::shared_ptr<Subscription> getSubscription(const std::string& sid) const;
+    // The client only indexes its subscriptions by sid and subject; the
+    // records themselves live in the server's SubscriptionStore.
+    bool addSubscription(const std::string& sid, SubscriptionHandle handle, SubjectId subjectId);
+    SubscriptionHandle removeSubscription(const std::string& sid, SubjectId subjectId);
+    std::vector<SubscriptionHandle> takeSubscriptions();
+    bool hasSubscription(SubjectId subjectId) const;
+    SubscriptionHandle getSubscription(const std::string& sid) const;
+    std::vector<std::pair<std::string, SubscriptionHandle>> getSubscriptions() const;
+    size_t getSubscriptionCount() const;
 
+    uint64_t getId() const { return id_; }
     int getSocket() const { return socket_; }
     std::string getHost() const { return host_; }
     std::string getIP() const { return ip_; }
     bool isConnected() const { return connected_; }
+
+    // Set once the data lane overflows. Queued MSG frames are dropped, the
+    // client is told -ERR 'Slow Consumer' and the connection closes as soon
+    // as that has been written.
+    bool isSlowConsumer() const { return slowConsumer_; }
+
+    // Set by the server before the client is served, and on CONNECT by the
+    // client's own IoLoop thread.
+    Account* getAccount() const { return account_; }
+    void setAccount(Account* account) { account_ = account; }
+
+    void setConnectOptions(const ConnectOptions& options);
+    bool isVerbose() const { return verbose_; }
+    bool isPedantic() const { return pedantic_; }
+    bool isEcho() const { return echo_; }
+    bool hasReceivedConnect() const { return connectReceived_; }
+
+    // Switched on by the IoLoop thread once CONNECT asks for it; from then
+    // on control replies are re-encoded as frames and MSG frames lose their
+    // CRLF. The session is only touched by that thread.
+    bool isBinary() const { return binary_; }
+    void enableBinary();
+    BinarySession* getBinarySession() const { return binarySession_.get(); }
+
+    // Set by the server before the client is served. Output queued during
+    // the handshake is flushed once it completes; after that, writes go
+    // straight to the socket when the kernel encrypts them (kTLS) and
+    // through OpenSSL otherwise.
+    void enableTls(std::unique_ptr<TlsSession> session);
+    bool isTls() const { return tls_ != nullptr; }
+
+    void recordPingSent() { pingsOutstanding_++; }
+    void recordPong() { pingsOutstanding_ = 0; }
+    int getPingsOutstanding() const { return pingsOutstanding_; }
     
     void disconnect();
 
+    // Closes this process's handle without shutting the connection down,
+    // once another process holds a duplicate of the socket.
+    void detachSocket();
+
+    void attachIoLoop(IoLoop* loop);
+    void detachIoLoop();
+    bool flushOutbound();
+    bool hasPendingOutput() const;
+    size_t getPendingBytes() const;
+
+    // Unsent output in the order it would go out, and back again in the
+    // process that takes the connection over.
+    std::string takeOutbound();
+    void restoreOutbound(const std::string& output);
+
+    size_t getIoSlot() const { return ioSlot_; }
+    void setIoSlot(size_t slot) { ioSlot_ = slot; }
+
+    RateBuckets* getRateBuckets() const { return rateBuckets_.get(); }
+    void setRateBuckets(std::unique_ptr<RateBuckets> buckets) { rateBuckets_ = std::move(buckets); }
+
+    // Set while handling input when the rest of it has to wait for publish
+    // tokens; the owning IoLoop stops reading the socket for that long.
+    void pauseReading(int64_t nanoseconds) {
+        if (nanoseconds > readPauseNs_) {
+            readPauseNs_ = nanoseconds;
+        }
+    }
+    int64_t takeReadPause();
+
+    // Set while handling input that ends in an incomplete command of known
+    // size, so the owning IoLoop can size its read buffer once.
+    void expectInput(size_t bytes) { expectedInput_ = bytes; }
+    size_t takeExpectedInput();
+
+    // Memory held for this connection is charged to its own total and to
+    // the server's budget, once the server has set one.
+    void setMemoryBudget(MemoryBudget* budget) { memoryBudget_ = budget; }
+    void charge(MemoryUse use, int64_t bytes);
+    size_t getChargedBytes() const;
+
 private:
+    using Frame = BrokerString<AllocTag::OUTBOUND_FRAMES>;
+    using FrameQueue = std::deque<Frame, BrokerAllocator<Frame, AllocTag::OUTBOUND_FRAMES>>;
+
+    struct OutboundQueue {
+        Frame current;
+        size_t offset = 0;
+        FrameQueue control;
+        FrameQueue data;
+        size_t controlBytes = 0;
+        size_t dataBytes = 0;
+    };
+
+    uint64_t id_;
     int socket_;
     std::string host_;
     std::string ip_;
-    bool connected_;
+    std::atomic<bool> connected_;
+    std::atomic<bool> slowConsumer_;
+
+    std::atomic<bool> verbose_;
+    std::atomic<bool> pedantic_;
+    std::atomic<bool> echo_;
+    std::atomic<bool> connectReceived_;
+    std::atomic<bool> binary_;
+    std::atomic<int> pingsOutstanding_;
     
-    std::unordered_map<std::string, std::shared_ptr<Subscription>> subscriptions_;
+    std::unordered_map<std::string, SubscriptionHandle> subscriptions_;
+    std::unordered_map<SubjectId, uint32_t> subjectCounts_;
     
-    mutable std::mutex mutex_;
+    mutable BrokerMutex mutex_{"Client::mutex_"};
+    mutable BrokerMutex sendMutex_{"Client::sendMutex_"};
+
+    IoLoop* ioLoop_;
+    size_t ioSlot_;
+    std::unique_ptr<OutboundQueue> outbound_;
+
+    std::unique_ptr<RateBuckets> rateBuckets_;
+    std::unique_ptr<BinarySession> binarySession_;
+    std::unique_ptr<TlsSession> tls_;
+    int64_t readPauseNs_;
+    size_t expectedInput_;
+
+    MemoryBudget* memoryBudget_;
+    Account* account_;
+    std::atomic<int64_t> chargedBytes_;
+
+    bool enqueue(const std::string& message, bool control);
+    bool writesPlaintext() const { return !tls_ || tls_->isKernelSend(); }
+    int write(const char* data, size_t size);
+    int receiveTls(char* buffer, size_t size);
+    bool queueRemainder(const std::string& message, int sent, bool control);
+    void resetOutbound();
+    void dropSlowConsumer();
 };
 
 } // namespace pulse_broker 
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include "LockStats.h"
+
+namespace pulse_broker {
+
+// Splits a range of work items into contiguous shares and runs them on a
+// fixed set of worker threads, with the calling thread taking the first
+// share. run() returns only after every share is done, so a caller can pass
+// references to data it keeps locked, and anything sent to one receiver by
+// one run() is out before the next run() starts. Callers must not call run()
+// concurrently.
+class FanoutPool {
+public:
+    using Task = std::function<void(size_t begin, size_t end)>;
+
+    explicit FanoutPool(size_t workers);
+    ~FanoutPool();
+
+    FanoutPool(const FanoutPool&) = delete;
+    FanoutPool& operator=(const FanoutPool&) = delete;
+
+    void run(size_t count, const Task& task);
+
+    size_t getWorkerCount() const { return workers_.size(); }
+
+private:
+    std::vector<std::thread> workers_;
+
+    BrokerMutex mutex_{"FanoutPool::mutex_"};
+    std::condition_variable_any startCondition_;
+    std::condition_variable_any doneCondition_;
+
+    const Task* task_;
+    size_t count_;
+    size_t shares_;
+    size_t pending_;
+    uint64_t generation_;
+    bool stopping_;
+
+    void work(size_t share);
+    void runShare(size_t share);
+};
+
+} // namespace pulse_broker
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "NATSProtocolParser.h"
+#include "WorkQueue.h"
+#include "MessageHistory.h"
+
+namespace pulse_broker {
+
+struct HandoffClient {
+    std::string socketInfo;
+    std::string ip;
+    std::string account;
+    bool connectReceived = false;
+    ConnectOptions connectOptions;
+    std::vector<std::pair<std::string, std::string>> subscriptions;
+    std::vector<std::pair<uint32_t, std::string>> binarySubjects;
+    uint32_t resumeRecord = 0;
+    std::string pendingInput;
+    std::string pendingOutput;
+
+    // Filled in by the receiving process; not part of the encoding.
+    int socket = -1;
+};
+
+struct HandoffAccount {
+    std::string name;
+    WorkQueueState workQueues;
+    MessageHistoryState history;
+};
+
+struct HandoffState {
+    std::string tcpListener;
+    std::string unixListener;
+    std::string unixSocketPath;
+    std::vector<HandoffClient> clients;
+    std::vector<HandoffAccount> accounts;
+};
+
+// Wire format and socket plumbing for hot restart. The running broker hands
+// its listening and client sockets to a new process with WSADuplicateSocket,
+// which is the Winsock counterpart of passing descriptors with SCM_RIGHTS:
+// the duplicate is described by a WSAPROTOCOL_INFO blob that the target
+// process turns back into a socket. Blobs and per-client state travel as one
+// length-prefixed frame over the handoff Unix domain socket.
+class Handoff {
+public:
+    static std::string encode(const HandoffState& state);
+    static bool decode(const std::string& data, HandoffState& state);
+
+    static bool sendFrame(int socket, const std::string& frame);
+    static bool receiveFrame(int socket, std::string& frame);
+
+    // The requester names the process that receives the duplicates. Only
+    // the process on the other end of socket, running this executable as
+    // this user, is given them; otherwise any local process that can reach
+    // the handoff path could collect every client connection.
+    static bool isTrustedPeer(int socket, uint32_t processId);
+
+    static uint32_t currentProcessId();
+    static bool duplicateSocket(int socket, uint32_t processId, std::string& info);
+    static int openSocket(const std::string& info);
+};
+
+} // namespace pulse_broker
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "BufferPool.h"
+#include "TimingWheel.h"
+#include "LockStats.h"
+
+struct pollfd;
+
+namespace pulse_broker {
+
+class Client;
+
+struct KeepaliveOptions {
+    int pingIntervalMs = 120000;
+    int maxPingsOutstanding = 2;
+    int connectTimeoutMs = 10000;
+    int timerResolutionMs = 50;
+};
+
+// Owns a set of client sockets and services them from one thread with
+// WSAPoll. Connections hold a read buffer only while a partial command is
+// pending; the buffer comes from the loop's pool and goes back once drained.
+// Keepalive PINGs and connect deadlines run off the loop's timing wheel.
+// Client sockets are non-blocking; a client whose output backs up asks the
+// loop to poll it for writability and flush its queues. A client held back
+// by publish rate limits stops being read until its tokens refill.
+class IoLoop {
+public:
+    using ReadHandler = std::function<size_t(const std::shared_ptr<Client>&, const char*, size_t)>;
+    using CloseHandler = std::function<void(const std::shared_ptr<Client>&)>;
+
+    static const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+    struct DetachedClient {
+        std::shared_ptr<Client> client;
+        std::string pendingInput;
+    };
+
+    IoLoop(ReadHandler onRead, CloseHandler onClose, const KeepaliveOptions& keepalive = KeepaliveOptions());
+    ~IoLoop();
+
+    bool start();
+    void stop();
+
+    // Stops the loop without closing its connections and returns them with
+    // any input read but not yet consumed.
+    std::vector<DetachedClient> detach();
+
+    void addClient(std::shared_ptr<Client> client, std::string pendingInput = std::string());
+    void requestWrite(Client* client);
+
+    size_t getClientCount() const { return clientCount_; }
+    size_t getBufferedCount() const { return bufferedCount_; }
+    size_t getEvictedCount() const { return evictedCount_; }
+    const BufferPool& getBufferPool() const { return bufferPool_; }
+
+    static size_t getSlotSize();
+
+private:
+    struct ConnectionTimer : TimingWheel::Timer {
+        size_t slot = 0;
+        bool awaitingConnect = false;
+        bool resumeRead = false;
+    };
+
+    struct Connection {
+        std::shared_ptr<Client> client;
+        std::unique_ptr<ReadBuffer> readBuffer;
+        std::unique_ptr<ConnectionTimer> keepalive;
+        std::unique_ptr<ConnectionTimer> readPause;
+        size_t readCharge = 0;
+    };
+
+    ReadHandler onRead_;
+    CloseHandler onClose_;
+    KeepaliveOptions keepaliveOptions_;
+    TimingWheel timerWheel_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    int wakeSocket_;
+
+    std::vector<pollfd> pollFds_;
+    std::vector<Connection> connections_;
+    std::vector<char, BrokerAllocator<char, AllocTag::CLIENT_BUFFERS>> readChunk_;
+    BufferPool bufferPool_;
+
+    std::vector<DetachedClient> pending_;
+    std::vector<Client*> writeRequests_;
+    BrokerMutex pendingMutex_{"IoLoop::pendingMutex_"};
+
+    std::atomic<size_t> clientCount_;
+    std::atomic<size_t> bufferedCount_;
+    std::atomic<size_t> evictedCount_;
+
+    void stopThread();
+    void releaseResources();
+    bool createWakeSocket();
+    void wake();
+    void drainWakeSocket();
+    void adoptPending();
+    void run();
+    bool handleReadable(Connection& connection);
+    void dispatchBuffered(Connection& connection);
+    void reserveExpected(Connection& connection);
+    void chargeReadBuffer(Connection& connection);
+    void applyReadPause(Connection& connection);
+    void resumeReading(size_t index);
+    void closeConnection(size_t index);
+    void handleTimer(ConnectionTimer& timer);
+    void evictConnection(size_t index, const std::string& reason);
+};
+
+} // namespace pulse_broker
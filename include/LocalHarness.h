@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "NATSServer.h"
+
+namespace pulse_broker {
+
+// A scripted publish/subscribe run. Subscriber i subscribes to subject
+// i % subjects, and every message goes to a subject drawn from a generator
+// seeded with seed, so the same workload always produces the same traffic.
+struct Workload {
+    size_t subjects = 16;
+    size_t subscribersPerSubject = 4;
+    size_t messages = 100000;
+    size_t payloadSize = 64;
+    size_t batchSize = 256;
+    uint32_t seed = 1;
+    int timeoutMs = 10000;
+};
+
+struct WorkloadResult {
+    bool complete = false;
+    uint64_t published = 0;
+    uint64_t delivered = 0;
+    uint64_t deliveredBytes = 0;
+    uint64_t expectedDeliveries = 0;
+    double elapsedSeconds = 0;
+};
+
+// Runs a broker in the current process without a TCP listener and attaches
+// clients to it through connected socket pairs, so tests and benchmarks
+// exercise parsing, matching and delivery without the network stack.
+class LocalHarness {
+public:
+    explicit LocalHarness(ServerOptions options = ServerOptions());
+    ~LocalHarness();
+
+    LocalHarness(const LocalHarness&) = delete;
+    LocalHarness& operator=(const LocalHarness&) = delete;
+
+    bool start();
+    void stop();
+
+    NATSServer& getServer() { return *server_; }
+
+    // Attaches a new client and returns its index, or -1. The server's INFO
+    // is consumed before returning.
+    int connect();
+    void close(int client);
+
+    bool send(int client, const std::string& data);
+
+    // Returns whatever arrives within timeoutMs, waiting for at least one byte.
+    std::string receive(int client, int timeoutMs = 1000);
+
+    // Reads until exactly size bytes have arrived; false on timeout or EOF.
+    bool receiveExactly(int client, size_t size, std::string& data, int timeoutMs = 1000);
+
+    WorkloadResult run(const Workload& workload);
+
+    // Connected stream sockets. Winsock has no socketpair(), so this pairs
+    // two AF_UNIX sockets through a short-lived listener.
+    static bool socketPair(int sockets[2]);
+
+private:
+    std::unique_ptr<NATSServer> server_;
+    std::vector<int> clients_;
+
+    bool waitReadable(int socket, int timeoutMs);
+    bool drain(int client, size_t frames, std::string& partial, WorkloadResult& result, int timeoutMs);
+};
+
+} // namespace pulse_broker
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+// Log2 histogram of nanosecond durations: bucket i counts samples in
+// [2^i, 2^(i+1)) ns, the last bucket also takes everything above.
+class LockHistogram {
+public:
+    static const size_t BUCKETS = 32;
+
+    LockHistogram();
+
+    void record(uint64_t nanoseconds);
+    std::vector<uint64_t> getCounts() const;
+    void reset();
+
+    static size_t bucketFor(uint64_t nanoseconds);
+
+private:
+    std::atomic<uint64_t> counts_[BUCKETS];
+};
+
+// Counters shared by every mutex registered under the same name, so the
+// per-client locks show up as one entry.
+struct LockStats {
+    explicit LockStats(const std::string& lockName);
+
+    std::string name;
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contentions;
+    std::atomic<uint64_t> waitTotalNs;
+    std::atomic<uint64_t> waitMaxNs;
+    std::atomic<uint64_t> holdTotalNs;
+    std::atomic<uint64_t> holdMaxNs;
+    LockHistogram waitHistogram;
+    LockHistogram holdHistogram;
+
+    void recordWait(uint64_t nanoseconds, bool contended);
+    void recordHold(uint64_t nanoseconds);
+    void reset();
+};
+
+struct LockReport {
+    std::string name;
+    uint64_t acquisitions = 0;
+    uint64_t contentions = 0;
+    uint64_t waitTotalNs = 0;
+    uint64_t waitMaxNs = 0;
+    uint64_t waitP99Ns = 0;
+    uint64_t holdTotalNs = 0;
+    uint64_t holdMaxNs = 0;
+    uint64_t holdP99Ns = 0;
+    std::vector<uint64_t> waitHistogram;
+    std::vector<uint64_t> holdHistogram;
+};
+
+class LockRegistry {
+public:
+    static LockStats& get(const std::string& name);
+    static std::vector<LockReport> getReport();
+    static void reset();
+
+    static bool isEnabled();
+    static std::string toJson();
+};
+
+// std::mutex that records how long callers wait for it and how long it is
+// held. Uncontended acquisitions cost one try_lock plus two clock reads.
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(const char* name);
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    const LockStats& getStats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex mutex_;
+    LockStats& stats_;
+    Clock::time_point acquiredAt_;
+};
+
+class PlainMutex : public std::mutex {
+public:
+    explicit PlainMutex(const char*) {}
+};
+
+// Broker locks are named so a build with PULSE_BROKER_LOCK_STATS can report
+// contention per lock; otherwise they are plain std::mutex.
+#ifdef PULSE_BROKER_LOCK_STATS
+using BrokerMutex = InstrumentedMutex;
+#else
+using BrokerMutex = PlainMutex;
+#endif
+
+} // namespace pulse_broker
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+enum class MemoryUse {
+    CONNECTIONS,
+    READ_BUFFERS,
+    OUTBOUND,
+    SUBSCRIPTIONS,
+    HISTORY,
+    WORK_QUEUES,
+    COUNT
+};
+
+struct ConnectionMemory {
+    uint64_t clientId = 0;
+    std::string ip;
+    size_t bytes = 0;
+};
+
+struct MemoryBudgetReport {
+    size_t limit = 0;
+    size_t used = 0;
+    size_t usage[static_cast<size_t>(MemoryUse::COUNT)] = {};
+    uint64_t refusedConnections = 0;
+    uint64_t throttledReads = 0;
+    uint64_t slowConsumers = 0;
+    std::vector<ConnectionMemory> connections;
+};
+
+// Bytes held by the broker, charged by the subsystem that allocates them.
+// A limit of 0 only accounts. Over the limit, new connections are refused
+// and reads are throttled until enough output has drained. Charges are
+// relaxed atomic adds, so the figures are estimates of live memory rather
+// than allocator totals.
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit = 0);
+
+    void charge(MemoryUse use, int64_t bytes);
+
+    size_t getLimit() const { return limit_; }
+    size_t getUsed() const;
+    size_t getUsed(MemoryUse use) const;
+    bool isExceeded() const { return limit_ > 0 && getUsed() > limit_; }
+
+    void recordRefusedConnection() { refusedConnections_++; }
+    void recordThrottledRead() { throttledReads_++; }
+    void recordSlowConsumer() { slowConsumers_++; }
+
+    void reset();
+
+    // The connections list is left for the caller to fill in.
+    MemoryBudgetReport getReport() const;
+
+    static const char* getName(MemoryUse use);
+    static std::string toJson(const MemoryBudgetReport& report);
+
+private:
+    size_t limit_;
+    std::atomic<int64_t> used_;
+    std::atomic<int64_t> usage_[static_cast<size_t>(MemoryUse::COUNT)];
+    std::atomic<uint64_t> refusedConnections_;
+    std::atomic<uint64_t> throttledReads_;
+    std::atomic<uint64_t> slowConsumers_;
+};
+
+} // namespace pulse_broker
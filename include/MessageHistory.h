@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include "SubjectTable.h"
+
+namespace pulse_broker {
+
+// Subjects starting with prefix keep their last depth messages. A depth of 1
+// keeps the last value.
+struct SubjectHistoryLimit {
+    std::string prefix;
+    size_t depth = 1;
+};
+
+// The payload is stored once and shared by every replay of it.
+struct RetainedMessage {
+    std::string replyTo;
+    std::shared_ptr<const std::string> payload;
+};
+
+// Retained messages carried across a hot restart, each subject's oldest
+// first.
+struct MessageHistoryState {
+    struct Message {
+        std::string subject;
+        RetainedMessage message;
+    };
+
+    std::vector<Message> messages;
+};
+
+// Last-N message rings for the subjects matched by the configured prefixes,
+// keyed by interned subject ID like the subscription store. The first
+// matching prefix applies. Not thread-safe: the owning account's mutex
+// (Account::getMutex) serializes access, so a new subscriber gets the
+// history and then live traffic with nothing lost or repeated in between.
+class MessageHistory {
+public:
+    MessageHistory(SubjectTable& subjects, const std::vector<SubjectHistoryLimit>& limits);
+    ~MessageHistory();
+
+    MessageHistory(const MessageHistory&) = delete;
+    MessageHistory& operator=(const MessageHistory&) = delete;
+
+    bool isEnabled() const { return !limits_.empty(); }
+
+    void record(const std::string& subject, const std::string& replyTo, const char* payload, size_t payloadSize);
+
+    // Retained messages for subject, oldest first, or nullptr if there are
+    // none. The pointer is valid until the history is next modified.
+    const std::deque<RetainedMessage>* find(const std::string& subject) const;
+
+    void clear();
+
+    // restore records through the current limits, so subjects that are no
+    // longer configured are dropped and shallower rings keep the newest.
+    void save(MessageHistoryState& state) const;
+    void restore(const MessageHistoryState& state);
+
+    size_t size() const { return messages_; }
+    size_t getSubjectCount() const { return rings_.size(); }
+    size_t getMemoryUsage() const { return bytes_; }
+
+private:
+    SubjectTable& subjects_;
+    std::vector<SubjectHistoryLimit> limits_;
+    std::unordered_map<SubjectId, std::deque<RetainedMessage>> rings_;
+    size_t messages_;
+    size_t bytes_;
+
+    size_t depthFor(const std::string& subject) const;
+    static size_t footprint(const RetainedMessage& message);
+};
+
+} // namespace pulse_broker
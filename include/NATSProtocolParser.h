@@ -1,14 +1,15 @@
 #pragma once
 
 #include <string>
-#include <vector>
 #include <unordered_map>
 #include <memory>
 
 namespace pulse_broker {
 
 class Client;
-class Subscription;
+struct Subscription;
+struct FieldSpan;
+struct HeaderScan;
 
 enum class CommandType {
     UNKNOWN,
@@ -23,40 +24,79 @@ enum class CommandType {
     OK
 };
 
+struct ConnectOptions {
+    bool verbose = true;
+    bool pedantic = false;
+    bool echo = true;
+    bool binary = false;
+    std::string user;
+};
+
 struct Command {
     CommandType type = CommandType::UNKNOWN;
     std::string subject;
     std::string sid;
     std::string replyTo;
     std::string payload;
+    const char* payloadData = nullptr;
     size_t payloadSize = 0;
+    ConnectOptions connectOptions;
     std::unordered_map<std::string, std::string> options;
 };
 
 class NATSProtocolParser {
 public:
+    static const size_t DEFAULT_MAX_PAYLOAD = 1024 * 1024;
+    static const size_t MAX_CONTROL_LINE = 4096;
+
     NATSProtocolParser() = default;
     ~NATSProtocolParser() = default;
 
+    // payloadData points at a PUB body inside the parsed input. While the
+    // body has not fully arrived, parse returns false with consumed 0 and
+    // payloadData and payloadSize describing the body still expected. A PUB
+    // announcing more than the maximum payload is returned as soon as its
+    // header line is complete, without a body, so the caller can reject it
+    // before buffering anything.
     bool parse(const std::string& buffer, Command& command);
+    bool parse(const char* data, size_t size, Command& command, size_t& consumed);
+
+    void setMaxPayload(size_t maxPayload) { maxPayload_ = maxPayload; }
+    size_t getMaxPayload() const { return maxPayload_; }
+
+    // When off, PUB bodies are only available through payloadData and are
+    // not copied into payload.
+    void setPayloadCopy(bool copy) { copyPayload_ = copy; }
 
     std::string generateMessage(const Command& command);
     
-    std::string generateInfoMessage(const std::string& host, int port, const std::string& clientIP);
+    std::string generateInfoMessage(const std::string& host, int port, const std::string& clientIP,
+                                    size_t maxPayload = DEFAULT_MAX_PAYLOAD, bool tlsRequired = false);
     std::string generateOkMessage();
+    std::string generateErrMessage(const std::string& error);
+    std::string generatePingMessage();
     std::string generatePongMessage();
     std::string generateMsgMessage(const std::string& subject, const std::string& sid, 
                                  const std::string& replyTo, const std::string& payload);
+    std::string generateMsgHeader(const std::string& subject, const std::string& sid,
+                                  const std::string& replyTo, size_t payloadSize);
+
+    static bool isValidSubject(const std::string& subject, bool allowWildcards);
 
 private:
-    bool parseConnect(const std::vector<std::string>& tokens, Command& command);
-    bool parsePing(const std::vector<std::string>& tokens, Command& command);
-    bool parsePong(const std::vector<std::string>& tokens, Command& command);
-    bool parseSub(const std::vector<std::string>& tokens, Command& command);
-    bool parsePub(const std::vector<std::string>& tokens, const std::string& buffer, size_t headerEnd, Command& command);
-    bool parseUnsub(const std::vector<std::string>& tokens, Command& command);
+    size_t maxPayload_ = DEFAULT_MAX_PAYLOAD;
+    bool copyPayload_ = true;
+
+    bool parseConnect(const char* data, const HeaderScan& scan, Command& command);
+    bool parsePing(const char* data, const HeaderScan& scan, Command& command);
+    bool parsePong(const char* data, const HeaderScan& scan, Command& command);
+    bool parseSub(const char* data, const HeaderScan& scan, Command& command);
+    bool parsePub(const char* data, size_t size, const HeaderScan& scan, Command& command, size_t& consumed);
+    bool parseUnsub(const char* data, const HeaderScan& scan, Command& command);
     
-    std::vector<std::string> tokenize(const std::string& line);
+    static void resetCommand(Command& command);
+    static bool fieldEquals(const char* data, const FieldSpan& field, const char* literal);
+    static bool parseSize(const char* data, const FieldSpan& field, size_t& value);
 };
 
 } // namespace pulse_broker 
\ No newline at end of file
@@ -9,15 +9,82 @@
 #include <atomic>
 #include <condition_variable>
 #include "NATSProtocolParser.h"
+#include "SharedMemoryRing.h"
+#include "IoLoop.h"
+#include "TrafficStats.h"
+#include "LockStats.h"
+#include "SubjectTable.h"
+#include "Subscription.h"
+#include "FanoutPool.h"
+#include "RateLimiter.h"
+#include "Handoff.h"
+#include "MessageHistory.h"
+#include "MemoryBudget.h"
+#include "SubjectMapping.h"
+#include "Account.h"
+#include "BinaryProtocol.h"
+#include "Tls.h"
 
 namespace pulse_broker {
 
 class Client;
-class Subscription;
+
+struct ServerOptions {
+    std::string host = "0.0.0.0";
+    int port = 4222;
+    std::string unixSocketPath;
+    bool tcpListener = true;
+    size_t maxPayload = NATSProtocolParser::DEFAULT_MAX_PAYLOAD;
+    int ioThreads = 0;
+    int pingIntervalMs = 120000;
+    int maxPingsOutstanding = 2;
+    int connectTimeoutMs = 10000;
+    bool trafficStats = true;
+    int trafficWindowMs = 60000;
+    size_t trafficTopK = 10;
+    size_t fanoutThreshold = 1024;
+    int fanoutThreads = 0;
+    RateLimit clientRateLimit;
+    std::vector<SubjectRateLimit> subjectRateLimits;
+    RateLimitAction rateLimitAction = RateLimitAction::BACKPRESSURE;
+    std::vector<SubjectHistoryLimit> subjectHistory;
+    std::vector<WorkQueueConfig> workQueues;
+    std::vector<SubjectMappingRule> subjectMappings;
+    std::vector<AccountConfig> accounts;
+    size_t memoryBudget = 0;
+    std::string handoffPath;
+    std::string takeoverPath;
+
+    // Connections to the TCP listener are TLS when set; the Unix socket and
+    // attached connections stay plaintext.
+    std::shared_ptr<TlsContext> tls;
+};
+
+struct MemoryReport {
+    size_t connections = 0;
+    size_t bufferedConnections = 0;
+    size_t pooledBuffers = 0;
+    size_t bufferCapacity = 0;
+    size_t accounts = 0;
+    size_t subscriptions = 0;
+    size_t subscriptionBytes = 0;
+    size_t subjects = 0;
+    size_t subjectTableBytes = 0;
+    size_t bytesPerIdleConnection = 0;
+    size_t idleConnectionBytes = 0;
+    size_t bufferBytes = 0;
+    size_t queuedConnections = 0;
+    size_t outboundBytes = 0;
+    size_t historyMessages = 0;
+    size_t historyBytes = 0;
+    size_t workQueueMessages = 0;
+    size_t workQueueBytes = 0;
+};
 
 class NATSServer {
 public:
-    NATSServer(const std::string& host = "0.0.0.0", int port = 4222);
+    NATSServer(const std::string& host = "0.0.0.0", int port = 4222, const std::string& unixSocketPath = "");
+    explicit NATSServer(const ServerOptions& options);
     ~NATSServer();
 
     bool start();
@@ -27,34 +94,120 @@ public:
     bool subscribe(std::shared_ptr<Client> client, const std::string& subject, const std::string& sid);
     bool unsubscribe(std::shared_ptr<Client> client, const std::string& sid);
     
-    bool publish(const std::string& subject, const std::string& message, const std::string& replyTo = "");
+    // Returns false if the message was for a work queue that is full.
+    // Traffic stats attribute the message to publisher if given, otherwise
+    // to the origin client or "local".
+    bool publish(const std::string& subject, const std::string& message, const std::string& replyTo = "",
+                 std::shared_ptr<Client> origin = nullptr);
+    bool publish(const std::string& subject, const char* payload, size_t payloadSize, const std::string& replyTo,
+                 std::shared_ptr<Client> origin, const std::string& publisher = std::string());
+
+    // Serves an already connected stream socket as if it had been accepted.
+    // The socket is closed if the server refuses it. Must not be called
+    // concurrently with stop().
+    bool attachConnection(int socket, const std::string& clientIP = "127.0.0.1");
+
+    bool addSharedMemoryRing(const std::string& name, size_t capacity = SharedMemoryRing::DEFAULT_CAPACITY);
     
     void addClient(std::shared_ptr<Client> client);
     void removeClient(std::shared_ptr<Client> client);
 
+    MemoryReport getMemoryReport();
+    static size_t getIdleConnectionFootprint();
+
+    TrafficReport getTrafficReport();
+    RateLimitReport getRateLimitReport();
+
+    // Budget usage by subsystem, with the connections holding the most.
+    MemoryBudgetReport getMemoryBudgetReport(size_t topConnections = 10);
+
+    const SubjectTable& getSubjectTable() const { return subjects_; }
+
 private:
     std::string host_;
     int port_;
     int serverSocket_;
+    std::string unixSocketPath_;
+    bool tcpListener_;
+    size_t maxPayload_;
+    int ioThreads_;
+    KeepaliveOptions keepalive_;
+    std::unique_ptr<TrafficStats> trafficStats_;
+    size_t fanoutThreshold_;
+    int fanoutThreads_;
+    std::unique_ptr<RateLimiter> rateLimiter_;
+    std::unique_ptr<SubjectMapper> subjectMapper_;
+    MemoryBudget memoryBudget_;
+    std::string handoffPath_;
+    std::string takeoverPath_;
+    std::shared_ptr<TlsContext> tls_;
+    int handoffSocket_;
+    int unixSocket_;
     std::atomic<bool> running_;
     
     NATSProtocolParser parser_;
     
+    SubjectTable subjects_;
+
     std::vector<std::shared_ptr<Client>> clients_;
-    std::mutex clientsMutex_;
+    BrokerMutex clientsMutex_{"NATSServer::clientsMutex_"};
     
-    std::unordered_map<std::string, std::vector<std::shared_ptr<Subscription>>> subscriptions_;
-    std::mutex subscriptionsMutex_;
+    std::unique_ptr<Accounts> accounts_;
+    std::unique_ptr<FanoutPool> fanoutPool_;
+    BrokerMutex fanoutMutex_{"NATSServer::fanoutMutex_"};
     
     std::thread acceptThread_;
-    std::vector<std::thread> clientThreads_;
-    std::mutex threadsMutex_;
+    std::thread unixAcceptThread_;
+    std::thread handoffThread_;
+
+    std::vector<std::unique_ptr<IoLoop>> ioLoops_;
+    std::atomic<size_t> nextIoLoop_;
+
+    std::vector<std::unique_ptr<SharedMemoryRing>> sharedMemoryRings_;
+    std::vector<std::thread> ringThreads_;
+
+    std::thread workQueueThread_;
     
+    bool startTcpListener();
+    bool startUnixListener();
+    bool startHandoffListener();
+    bool takeOver(HandoffState& state);
+    void restoreAccounts(const HandoffState& state);
+    void restoreClients(HandoffState& state);
+    void serveHandoff();
+    bool handOff(int peer, uint32_t processId);
+    void teardown();
     void acceptConnections();
-    void handleClient(std::shared_ptr<Client> client);
-    void processCommand(std::shared_ptr<Client> client, const Command& command);
+    void acceptUnixConnections();
+    bool registerClient(int clientSocket, const std::string& clientIP, bool secure = false);
+    size_t handleClientData(const std::shared_ptr<Client>& client, const char* data, size_t size);
+    size_t handleBinaryData(const std::shared_ptr<Client>& client, const char* data, size_t size);
+    bool processFrame(const std::shared_ptr<Client>& client, const BinaryFrame& frame);
+    bool processPubFrame(const std::shared_ptr<Client>& client, const BinaryFrame& frame);
+    std::string generateMsgHeader(const Client& client, const std::string& subject, const std::string& sid,
+                                  const std::string& replyTo, size_t payloadSize);
+    void handleClientClosed(const std::shared_ptr<Client>& client);
+    void removeClientSubscriptions(const std::shared_ptr<Client>& client);
+    Account& accountFor(const Client* client);
+    void recordHistory(Account& account, const std::string& subject, const std::string& replyTo, const char* payload,
+                       size_t payloadSize);
+    void drainSharedMemoryRing(SharedMemoryRing* ring);
+    void runWorkQueueTimers();
+    bool handleWorkQueueRequest(Account& account, const Command& command);
+    void sendWorkBatches(Account& account, size_t bytesBefore, std::vector<WorkBatch>& ready);
+    bool processCommand(std::shared_ptr<Client> client, const Command& command);
+    bool handleSystemRequest(Account& account, const std::string& subject, const std::string& replyTo);
     
-    void deliverMessageToSubscribers(const std::string& subject, const std::string& payload, const std::string& replyTo = "");
+    // Delivers in account and in every account importing subject from it.
+    // Returns false if account's work queue for subject is full.
+    bool deliverMessageToSubscribers(Account& account, const std::string& subject, const char* payload,
+                                     size_t payloadSize, const std::string& replyTo = "",
+                                     const Client* origin = nullptr);
+    void deliverMessageToSubscribers(Account& account, const std::string& subject, const std::string& payload) {
+        deliverMessageToSubscribers(account, subject, payload.data(), payload.size());
+    }
+    bool deliverToAccount(Account& account, const std::string& subject, const char* payload, size_t payloadSize,
+                          const std::string& replyTo, const Client* origin);
 };
 
 } // namespace pulse_broker 
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+// USDT tracepoints for perf and bpftrace, in the pulse_broker provider. A
+// build with PULSE_BROKER_USDT turns each into a single nop described in an
+// ELF note, which a tracer can attach to in a running broker; otherwise they
+// compile to nothing. Arguments must be integers or pointers.
+//
+// The broker itself only builds on Windows, where there is no sys/sdt.h, so
+// the probes are compiled out there and CMake refuses PULSE_BROKER_USDT.
+//
+//   connection__accept(cid, ip)
+//   connection__close(cid)
+//   command__parsed(cid, type, subject)        type is the CommandType value
+//   publish__matched(subject, subscribers, payload_size)
+//   publish__delivered(subject, subscribers)   after the fan-out returns
+//   message__enqueued(cid, bytes)              a frame handed to a client
+//   message__flushed(cid, bytes)               bytes written to its socket
+
+#ifdef PULSE_BROKER_USDT
+#ifdef _WIN32
+#error "PULSE_BROKER_USDT needs sys/sdt.h, which Windows does not have"
+#endif
+#include <sys/sdt.h>
+
+#define PULSE_PROBE1(name, a) DTRACE_PROBE1(pulse_broker, name, a)
+#define PULSE_PROBE2(name, a, b) DTRACE_PROBE2(pulse_broker, name, a, b)
+#define PULSE_PROBE3(name, a, b, c) DTRACE_PROBE3(pulse_broker, name, a, b, c)
+#else
+// sizeof keeps the arguments unevaluated but counts them as used.
+#define PULSE_PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define PULSE_PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define PULSE_PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+// A rate of 0 means unlimited. Buckets hold one second's worth of tokens,
+// so a publisher may burst up to the rate before it is held back.
+struct RateLimit {
+    double messagesPerSecond = 0;
+    double bytesPerSecond = 0;
+
+    bool isEnabled() const { return messagesPerSecond > 0 || bytesPerSecond > 0; }
+};
+
+struct SubjectRateLimit {
+    std::string prefix;
+    RateLimit limit;
+};
+
+enum class RateLimitAction {
+    BACKPRESSURE,
+    REJECT
+};
+
+// Token bucket kept as a single theoretical arrival time (GCRA), so taking
+// tokens is one compare-and-swap and the bucket needs no lock. A cost larger
+// than the burst is admitted whenever the bucket is full.
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TokenBucket(double ratePerSecond);
+
+    // Takes cost tokens and returns 0, or returns the nanoseconds until they
+    // will be available and takes nothing.
+    int64_t take(double cost, int64_t now);
+    void refund(double cost);
+
+    bool isUnlimited() const { return nanosPerToken_ <= 0; }
+
+    static int64_t now();
+
+private:
+    double nanosPerToken_;
+    int64_t burstNs_;
+    std::atomic<int64_t> arrival_;
+};
+
+class RateBuckets {
+public:
+    explicit RateBuckets(const RateLimit& limit);
+
+    int64_t take(size_t bytes, int64_t now);
+    void refund(size_t bytes);
+
+private:
+    TokenBucket messages_;
+    TokenBucket bytes_;
+};
+
+struct SubjectRateReport {
+    std::string prefix;
+    uint64_t hits = 0;
+};
+
+struct RateLimitReport {
+    RateLimitAction action = RateLimitAction::BACKPRESSURE;
+    uint64_t clientHits = 0;
+    std::vector<SubjectRateReport> subjects;
+};
+
+// Publish admission for one server. Each connection owns its RateBuckets;
+// every subject prefix has one set shared by all publishers, and the first
+// configured prefix that matches a subject applies.
+class RateLimiter {
+public:
+    RateLimiter(const RateLimit& clientLimit, const std::vector<SubjectRateLimit>& subjectLimits,
+                RateLimitAction action);
+
+    bool isEnabled() const { return clientLimit_.isEnabled() || !subjects_.empty(); }
+    RateLimitAction getAction() const { return action_; }
+
+    // nullptr when connections are not limited.
+    std::unique_ptr<RateBuckets> createClientBuckets() const;
+
+    // Returns 0 if the publish is admitted, otherwise the nanoseconds until
+    // it would be. A refused publish takes no tokens and counts as a hit.
+    int64_t admit(RateBuckets* clientBuckets, const std::string& subject, size_t bytes);
+
+    RateLimitReport getReport() const;
+    static std::string toJson(const RateLimitReport& report);
+
+private:
+    struct SubjectRule {
+        std::string prefix;
+        RateBuckets buckets;
+        std::atomic<uint64_t> hits;
+
+        SubjectRule(const SubjectRateLimit& limit);
+    };
+
+    RateLimit clientLimit_;
+    RateLimitAction action_;
+    std::vector<std::unique_ptr<SubjectRule>> subjects_;
+    std::atomic<uint64_t> clientHits_;
+};
+
+} // namespace pulse_broker
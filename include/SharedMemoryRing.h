@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+struct SharedMemoryRingHeader;
+
+// Single-producer/single-consumer ring of PUB frames in a named shared memory
+// section. The producer only signals the wake event when the consumer has
+// drained the ring and gone to sleep, so a busy ring costs no kernel calls.
+class SharedMemoryRing {
+public:
+    using FrameHandler = std::function<void(const char* subject, size_t subjectSize,
+                                            const char* replyTo, size_t replyToSize,
+                                            const char* payload, size_t payloadSize)>;
+
+    static const size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+    static std::unique_ptr<SharedMemoryRing> create(const std::string& name, size_t capacity = DEFAULT_CAPACITY);
+    static std::unique_ptr<SharedMemoryRing> attach(const std::string& name);
+
+    ~SharedMemoryRing();
+
+    SharedMemoryRing(const SharedMemoryRing&) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+    bool tryPublish(const std::string& subject, const std::string& payload, const std::string& replyTo = "");
+    bool publish(const std::string& subject, const std::string& payload, const std::string& replyTo = "");
+
+    size_t drain(const FrameHandler& handler);
+    void waitForFrames(int timeoutMs);
+    void wake();
+
+    const std::string& getName() const { return name_; }
+    size_t getCapacity() const;
+
+private:
+    SharedMemoryRing(const std::string& name, void* mapping, void* event, SharedMemoryRingHeader* header, char* data);
+
+    static std::string mappingName(const std::string& name);
+    static std::string eventName(const std::string& name);
+
+    std::string name_;
+    void* mapping_;
+    void* event_;
+    SharedMemoryRingHeader* header_;
+    char* data_;
+};
+
+} // namespace pulse_broker
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+// Rewrites published subjects that match source. In the source, * matches
+// one token and a trailing > the rest. The destination is made of literal
+// tokens and:
+//   *                          the next source wildcard, in order
+//   {{wildcard(n)}}            the n-th source wildcard, from 1
+//   {{partition(count,n,...)}} a partition in [0, count) hashed from the
+//                              listed wildcards
+//   >                          whatever the source > matched
+// For example orders.* -> orders.{{partition(16,1)}} sends each customer's
+// messages to one of 16 subjects, always the same one.
+struct SubjectMappingRule {
+    std::string source;
+    std::string destination;
+};
+
+// Rules are compiled once and applied in order; the first matching source
+// wins. Compiled rules are read-only, so map() needs no lock.
+class SubjectMapper {
+public:
+    static const size_t MAX_TOKENS = 32;
+
+    explicit SubjectMapper(const std::vector<SubjectMappingRule>& rules);
+
+    bool isEnabled() const { return !rules_.empty(); }
+
+    // Sets mapped and returns true if a rule matched subject.
+    bool map(const std::string& subject, std::string& mapped) const;
+
+    // Checks one rule, describing the first problem in error.
+    static bool validate(const SubjectMappingRule& rule, std::string& error);
+
+    // FNV-1a over the tokens, so partitions stay stable across builds and
+    // platforms.
+    static uint32_t partition(const std::vector<std::string>& tokens, uint32_t count);
+
+private:
+    struct Token {
+        enum Kind { LITERAL, WILDCARD, PARTITION, REST };
+
+        Kind kind = LITERAL;
+        std::string literal;
+        std::vector<size_t> wildcards;
+        uint32_t partitions = 0;
+    };
+
+    struct CompiledRule {
+        std::vector<std::string> source;
+        bool rest = false;
+        std::vector<Token> destination;
+    };
+
+    std::vector<CompiledRule> rules_;
+
+    static bool compile(const SubjectMappingRule& rule, CompiledRule& compiled, std::string& error);
+};
+
+} // namespace pulse_broker
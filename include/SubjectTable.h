@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "LockStats.h"
+
+namespace pulse_broker {
+
+using SubjectId = uint32_t;
+
+// Interns subjects to compact integer IDs so subscriptions store and compare
+// a 4-byte ID instead of their own copy of the subject. Entries are
+// reference counted and their IDs are reused once the last holder releases
+// them. Lookups by ID take no lock; interning locks one of SHARDS shards.
+class SubjectTable {
+public:
+    static const SubjectId INVALID_ID = 0;
+    static const size_t SHARDS = 16;
+
+    SubjectTable();
+    ~SubjectTable();
+
+    SubjectTable(const SubjectTable&) = delete;
+    SubjectTable& operator=(const SubjectTable&) = delete;
+
+    // Returns the subject's ID with one reference owned by the caller.
+    SubjectId intern(const std::string& subject);
+
+    // Returns the ID without taking a reference, or INVALID_ID if the
+    // subject is not interned.
+    SubjectId find(const std::string& subject) const;
+
+    void retain(SubjectId id);
+    void release(SubjectId id);
+
+    const std::string& getSubject(SubjectId id) const;
+    uint32_t getReferenceCount(SubjectId id) const;
+
+    size_t size() const { return size_; }
+    size_t getMemoryUsage() const;
+
+private:
+    static const size_t CHUNK_BITS = 12;
+    static const size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static const size_t MAX_CHUNKS = 4096;
+
+    struct Entry {
+        std::string subject;
+        uint64_t hash = 0;
+        std::atomic<uint32_t> references{0};
+    };
+
+    struct Key {
+        const char* data;
+        size_t size;
+        uint64_t hash;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.hash); }
+    };
+
+    struct Shard {
+        BrokerMutex mutex{"SubjectTable::Shard::mutex"};
+        std::unordered_map<Key, SubjectId, KeyHash> ids;
+    };
+
+    mutable Shard shards_[SHARDS];
+    std::atomic<Entry*> chunks_[MAX_CHUNKS];
+
+    mutable BrokerMutex allocationMutex_{"SubjectTable::allocationMutex_"};
+    std::vector<SubjectId> freeIds_;
+    SubjectId nextId_;
+    size_t chunkCount_;
+    std::atomic<size_t> size_;
+    std::atomic<size_t> subjectBytes_;
+
+    Entry& entryAt(SubjectId id) const;
+    SubjectId allocateId();
+    void freeId(SubjectId id);
+    static uint64_t hash(const char* data, size_t size);
+    Shard& shardFor(uint64_t hash) const;
+};
+
+} // namespace pulse_broker
@@ -1,28 +1,70 @@
 #pragma once
 
 #include <string>
-#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "SubjectTable.h"
+#include "AllocStats.h"
 
 namespace pulse_broker {
 
 class Client;
 
-class Subscription {
+using SubscriptionHandle = uint32_t;
+
+// One record per SUB. Records for a subject sit next to each other so
+// fan-out walks a single vector.
+struct Subscription {
+    Client* client;
+    SubscriptionHandle handle;
+    std::string sid;
+};
+
+using SubscriptionList = std::vector<Subscription, BrokerAllocator<Subscription, AllocTag::SUBSCRIPTIONS>>;
+
+// Owns every subscription in one account. Handles index a slab of slots
+// that locate a record inside its subject's vector; removal swaps the last
+// record of that vector into the hole, so both add and remove are O(1). Not
+// thread-safe: the owning account's mutex (Account::getMutex) serializes
+// access.
+class SubscriptionStore {
 public:
-    Subscription(std::weak_ptr<Client> client, const std::string& subject, const std::string& sid);
-    ~Subscription() = default;
+    static const SubscriptionHandle INVALID_HANDLE = UINT32_MAX;
+
+    explicit SubscriptionStore(SubjectTable& subjects);
+    ~SubscriptionStore();
 
-    std::string getSubject() const { return subject_; }
-    std::string getSID() const { return sid_; }
-    std::weak_ptr<Client> getClient() const { return client_; }
-    
-    bool deliverMessage(const std::string& subject, const std::string& sid, 
-                       const std::string& replyTo, const std::string& payload);
+    SubscriptionStore(const SubscriptionStore&) = delete;
+    SubscriptionStore& operator=(const SubscriptionStore&) = delete;
+
+    SubscriptionHandle add(Client* client, const std::string& subject, const std::string& sid);
+    void remove(SubscriptionHandle handle);
+    void clear();
+
+    // Subscriptions for subject, or nullptr if there are none. The pointer
+    // is valid until the store is next modified.
+    const SubscriptionList* find(const std::string& subject) const;
+
+    SubjectId getSubjectId(SubscriptionHandle handle) const { return slots_[handle].subjectId; }
+
+    size_t size() const { return size_; }
+    size_t getSubjectCount() const { return subscriptions_.size(); }
+    size_t getMemoryUsage() const;
 
 private:
-    std::weak_ptr<Client> client_;
-    std::string subject_;
-    std::string sid_;
+    struct Slot {
+        SubjectId subjectId;
+        uint32_t position;
+    };
+
+    SubjectTable& subjects_;
+    std::vector<Slot, BrokerAllocator<Slot, AllocTag::SUBSCRIPTIONS>> slots_;
+    std::vector<SubscriptionHandle, BrokerAllocator<SubscriptionHandle, AllocTag::SUBSCRIPTIONS>> freeHandles_;
+    std::unordered_map<SubjectId, SubscriptionList, std::hash<SubjectId>, std::equal_to<SubjectId>,
+                       BrokerAllocator<std::pair<const SubjectId, SubscriptionList>, AllocTag::SUBSCRIPTIONS>>
+        subscriptions_;
+    size_t size_;
 };
 
-} // namespace pulse_broker 
\ No newline at end of file
+} // namespace pulse_broker
\ No newline at end of file
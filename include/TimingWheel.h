@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+// Hierarchical timing wheel: LEVELS wheels of SLOTS buckets each, with
+// intrusive timer nodes so schedule and cancel are O(1). Timers in the
+// outer wheels cascade inward as the inner wheel wraps.
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        uint64_t deadline = 0;
+
+        bool isScheduled() const { return prev != nullptr; }
+    };
+
+    using Handler = std::function<void(Timer&)>;
+
+    static const unsigned SLOT_BITS = 6;
+    static const unsigned SLOTS = 1u << SLOT_BITS;
+    static const unsigned LEVELS = 4;
+
+    TimingWheel(std::chrono::milliseconds resolution, Handler handler, Clock::time_point start = Clock::now());
+    ~TimingWheel();
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    void schedule(Timer& timer, std::chrono::milliseconds delay);
+    void cancel(Timer& timer);
+
+    size_t advance(Clock::time_point now);
+    int getPollTimeout(Clock::time_point now) const;
+
+    size_t size() const { return count_; }
+    uint64_t getCurrentTick() const { return currentTick_; }
+
+private:
+    std::chrono::milliseconds resolution_;
+    Handler handler_;
+    Clock::time_point start_;
+    uint64_t currentTick_;
+    size_t count_;
+
+    Timer slots_[LEVELS][SLOTS];
+
+    void insert(Timer& timer);
+    void cascade(unsigned level);
+    static void link(Timer& head, Timer& timer);
+    static void unlink(Timer& timer);
+};
+
+} // namespace pulse_broker
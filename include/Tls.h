@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstddef>
+
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace pulse_broker {
+
+class TlsSession;
+
+// OpenSSL settings shared by the connections of one listener, or on the
+// client side by the connections of a test or benchmark. TLS is compiled in
+// only with PULSE_BROKER_TLS; without it every factory fails and says so.
+//
+// With kernelOffload the session asks OpenSSL to hand the record layer to
+// the kernel (Linux kTLS) once the handshake is done. Winsock has no kernel
+// TLS, so on Windows the option has no effect and the kernel send path in
+// Client never runs; isKernelOffloadAvailable says so. Where it is
+// available, whether it worked depends on the kernel and the negotiated
+// cipher, so it is reported per session.
+class TlsContext {
+public:
+    ~TlsContext();
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    static bool isAvailable();
+    static bool isKernelOffloadAvailable();
+
+    static std::shared_ptr<TlsContext> createServer(const std::string& certFile, const std::string& keyFile,
+                                                    bool kernelOffload, std::string& error);
+
+    // A server with a throwaway self-signed certificate for localhost.
+    static std::shared_ptr<TlsContext> createSelfSigned(bool kernelOffload, std::string& error);
+
+    // Accepts any server certificate; only meant for loopback tests and
+    // benchmarks.
+    static std::shared_ptr<TlsContext> createClient(bool kernelOffload, std::string& error);
+
+    std::unique_ptr<TlsSession> createSession(int socket) const;
+
+private:
+    TlsContext(ssl_ctx_st* context, bool server);
+
+    ssl_ctx_st* context_;
+    bool server_;
+};
+
+// One connection's TLS state. Not thread-safe: Client calls it only with
+// its send mutex held. read and write behave like recv and send on a
+// non-blocking socket, returning SOCKET_ERROR with WSAEWOULDBLOCK while
+// OpenSSL waits for the socket, and moving whole records at a time.
+class TlsSession {
+public:
+    // The most plaintext one TLS record carries.
+    static const size_t MAX_RECORD_SIZE = 16 * 1024;
+
+    ~TlsSession();
+
+    bool isEstablished() const;
+
+    // Once established, whether the kernel encrypts outgoing records, in
+    // which case plaintext may be written straight to the socket.
+    bool isKernelSend() const;
+    bool isKernelReceive() const;
+
+    // Client side, on a blocking socket.
+    bool connect();
+
+    int read(char* buffer, size_t size);
+    int write(const char* data, size_t size);
+
+private:
+    friend class TlsContext;
+    explicit TlsSession(ssl_st* ssl);
+
+    ssl_st* ssl_;
+
+    int result(int returned);
+};
+
+} // namespace pulse_broker
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace pulse_broker {
+
+struct TrafficCounts {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+};
+
+// Count-min sketch over (messages, bytes) pairs. Estimates never undercount;
+// with DEPTH rows of width cells the overcount is within e/width of the
+// total with probability 1 - e^-DEPTH.
+class CountMinSketch {
+public:
+    static const size_t DEPTH = 4;
+
+    explicit CountMinSketch(size_t width);
+
+    void add(uint64_t hash, uint64_t messages, uint64_t bytes);
+    TrafficCounts estimate(uint64_t hash) const;
+    void merge(const CountMinSketch& other);
+    void clear();
+
+    size_t getWidth() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        uint64_t messages;
+        uint64_t bytes;
+    };
+
+    size_t mask_;
+    std::vector<Cell> cells_;
+
+    size_t index(uint64_t hash, size_t row) const;
+};
+
+// Fixed-size candidate list for the heaviest keys by a single score. A new
+// key only displaces the current minimum, so memory stays at capacity.
+class HeavyHitters {
+public:
+    explicit HeavyHitters(size_t capacity);
+
+    void offer(uint64_t hash, const char* key, size_t keySize, uint64_t score);
+    void clear();
+
+    struct Candidate {
+        uint64_t hash;
+        std::string key;
+        uint64_t score;
+    };
+
+    const std::vector<Candidate>& getCandidates() const { return candidates_; }
+
+private:
+    size_t capacity_;
+    uint64_t minScore_;
+    std::vector<Candidate> candidates_;
+
+    void updateMinScore();
+};
+
+struct TrafficEntry {
+    std::string key;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+};
+
+struct TrafficWindowReport {
+    bool complete = false;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    std::vector<TrafficEntry> subjectsByMessages;
+    std::vector<TrafficEntry> subjectsByBytes;
+    std::vector<TrafficEntry> publishersByMessages;
+    std::vector<TrafficEntry> publishersByBytes;
+};
+
+struct TrafficReport {
+    uint64_t windowMs = 0;
+    TrafficWindowReport current;
+    TrafficWindowReport previous;
+};
+
+// Constant-memory per-subject and per-publisher traffic counters for the
+// publish path. Counts are kept for the current window and the one before
+// it; windows rotate lazily on the first record or report after they end.
+// Publishing threads are spread across SHARDS independently locked shards.
+class TrafficStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static const size_t SHARDS = 4;
+
+    TrafficStats(std::chrono::milliseconds window = std::chrono::milliseconds(60000), size_t topK = 10,
+                 size_t sketchWidth = 512, Clock::time_point start = Clock::now());
+    ~TrafficStats();
+
+    TrafficStats(const TrafficStats&) = delete;
+    TrafficStats& operator=(const TrafficStats&) = delete;
+
+    void record(const std::string& subject, const char* publisher, size_t publisherSize, size_t bytes,
+                Clock::time_point now = Clock::now());
+
+    TrafficReport getReport(Clock::time_point now = Clock::now());
+
+    size_t getMemoryUsage() const;
+
+    static std::string toJson(const TrafficReport& report);
+
+private:
+    struct Dimension;
+    struct Window;
+    struct Shard;
+
+    std::chrono::milliseconds window_;
+    size_t topK_;
+    size_t sketchWidth_;
+    Clock::time_point start_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    uint64_t epochAt(Clock::time_point now) const;
+    Shard& currentShard();
+    void rotate(Shard& shard, uint64_t epoch);
+    TrafficWindowReport buildReport(const std::vector<const Window*>& windows, bool complete) const;
+};
+
+} // namespace pulse_broker
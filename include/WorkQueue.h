@@ -0,0 +1,173 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "TimingWheel.h"
+
+namespace pulse_broker {
+
+// Subjects starting with prefix are queued in the broker instead of pushed
+// to subscribers. Each subject holds at most maxMessages, counting those
+// delivered but not yet acknowledged; a message not acknowledged within
+// ackWaitMs goes back to the head of its queue.
+struct WorkQueueConfig {
+    std::string prefix;
+    size_t maxMessages = 10000;
+    int ackWaitMs = 30000;
+};
+
+// Up to batch messages; if none are queued, wait up to expiresMs for them.
+struct FetchRequest {
+    size_t batch = 1;
+    int expiresMs = 0;
+};
+
+struct WorkMessage {
+    uint64_t sequence = 0;
+    uint32_t deliveries = 0;
+    std::shared_ptr<const std::string> payload;
+};
+
+// Messages handed to one fetch, to be written to its inbox together. An
+// empty batch tells the worker its fetch expired with nothing queued.
+struct WorkBatch {
+    std::string subject;
+    std::string inbox;
+    std::vector<WorkMessage> messages;
+};
+
+// Queue contents carried across a hot restart. A message with ackWaitMs of
+// -1 is still queued; otherwise it has been delivered and goes back to its
+// queue if ackWaitMs passes without an ack. Fetches keep waiting for the
+// expiresMs they have left.
+struct WorkQueueState {
+    struct Message {
+        std::string subject;
+        WorkMessage message;
+        int ackWaitMs = -1;
+    };
+
+    struct Fetch {
+        std::string subject;
+        std::string inbox;
+        size_t batch = 1;
+        int expiresMs = 0;
+    };
+
+    uint64_t nextSequence = 1;
+    std::vector<Message> messages;
+    std::vector<Fetch> fetches;
+};
+
+// Bounded pull queues for the subjects matched by the configured prefixes,
+// one per subject, with per-message ack deadlines and fetch expiries on a
+// timing wheel. The first matching prefix applies. Not thread-safe: the
+// server serializes access with the owning account's lock. Operations that
+// hand out messages append the batches to write to ready.
+class WorkQueues {
+public:
+    using Clock = TimingWheel::Clock;
+
+    static const int RESOLUTION_MS = 10;
+
+    WorkQueues(const std::vector<WorkQueueConfig>& configs, Clock::time_point start = Clock::now());
+    ~WorkQueues();
+
+    WorkQueues(const WorkQueues&) = delete;
+    WorkQueues& operator=(const WorkQueues&) = delete;
+
+    bool isEnabled() const { return !configs_.empty(); }
+    bool matches(const std::string& subject) const { return configFor(subject) != nullptr; }
+
+    // False if subject's queue is full.
+    bool push(const std::string& subject, const char* payload, size_t payloadSize, std::vector<WorkBatch>& ready);
+
+    // False if subject is not a work-queue subject.
+    bool fetch(const std::string& subject, const std::string& inbox, const FetchRequest& request,
+               std::vector<WorkBatch>& ready);
+
+    // Removes a delivered message for good. Unknown sequences, such as a
+    // late ack for a message already redelivered, return false.
+    bool ack(uint64_t sequence);
+
+    // Puts a delivered message back at the head of its queue now.
+    bool nak(uint64_t sequence, std::vector<WorkBatch>& ready);
+
+    // Redelivers messages past their ack deadline and ends expired fetches.
+    void advance(Clock::time_point now, std::vector<WorkBatch>& ready);
+
+    void clear();
+
+    // Queued messages come out in queue order. restore expects an empty
+    // instance and drops subjects that are no longer configured.
+    void save(WorkQueueState& state) const;
+    void restore(const WorkQueueState& state);
+
+    size_t getPendingCount() const { return pending_; }
+    size_t getInFlightCount() const { return inFlight_.size(); }
+    size_t getWaitingCount() const { return waiting_; }
+    size_t getMemoryUsage() const { return bytes_; }
+
+    // {"batch":n,"expires":ms}, either field optional; an empty payload
+    // fetches one message without waiting.
+    static bool parseFetchRequest(const char* payload, size_t payloadSize, FetchRequest& request);
+
+private:
+    struct Queue;
+
+    struct Deadline : TimingWheel::Timer {
+        enum Kind { ACK, FETCH };
+
+        Kind kind;
+        Queue* queue;
+
+        Deadline(Kind deadlineKind, Queue* owner) : kind(deadlineKind), queue(owner) {}
+    };
+
+    struct InFlight : Deadline {
+        WorkMessage message;
+
+        InFlight(Queue* owner, WorkMessage delivered) : Deadline(ACK, owner), message(std::move(delivered)) {}
+    };
+
+    struct Waiting : Deadline {
+        std::string inbox;
+        size_t batch;
+
+        Waiting(Queue* owner, const std::string& fetchInbox, size_t fetchBatch)
+            : Deadline(FETCH, owner), inbox(fetchInbox), batch(fetchBatch) {}
+    };
+
+    struct Queue {
+        std::string subject;
+        const WorkQueueConfig* config;
+        std::deque<WorkMessage> pending;
+        size_t inFlight = 0;
+        std::list<Waiting> waiting;
+    };
+
+    std::vector<WorkQueueConfig> configs_;
+    TimingWheel timers_;
+    std::vector<Deadline*> expired_;
+    std::unordered_map<std::string, std::unique_ptr<Queue>> queues_;
+    std::unordered_map<uint64_t, std::unique_ptr<InFlight>> inFlight_;
+    uint64_t nextSequence_;
+    size_t pending_;
+    size_t waiting_;
+    size_t bytes_;
+
+    const WorkQueueConfig* configFor(const std::string& subject) const;
+    Queue* queueFor(const std::string& subject);
+    int remainingMs(const TimingWheel::Timer& timer) const;
+    void serve(Queue& queue, std::vector<WorkBatch>& ready);
+    void requeue(InFlight& delivered);
+    static size_t footprint(const WorkMessage& message);
+};
+
+} // namespace pulse_broker
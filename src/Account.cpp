@@ -0,0 +1,128 @@
+#include "../include/Account.h"
+#include <iostream>
+
+namespace pulse_broker {
+
+const char* const Accounts::GLOBAL = "$G";
+
+namespace {
+
+bool startsWith(const std::string& subject, const std::string& prefix) {
+    return subject.compare(0, prefix.size(), prefix) == 0;
+}
+
+const AccountConfig* findConfig(const std::vector<AccountConfig>& configs, const std::string& name) {
+    for (const auto& config : configs) {
+        if (config.name == name) {
+            return &config;
+        }
+    }
+    return nullptr;
+}
+
+bool checkImport(const std::vector<AccountConfig>& configs, const AccountConfig& config,
+                 const AccountImport& import, std::string& error) {
+    const AccountConfig* source = findConfig(configs, import.account);
+    if (source == nullptr || source == &config) {
+        error = "account " + config.name + " imports from unknown account " + import.account;
+        return false;
+    }
+
+    for (const auto& prefix : source->exports) {
+        if (startsWith(import.prefix, prefix)) {
+            return true;
+        }
+    }
+    error = "account " + import.account + " does not export " + import.prefix;
+    return false;
+}
+
+} // namespace
+
+Account::Account(const std::string& name, SubjectTable& subjects, const std::vector<SubjectHistoryLimit>& history,
+                 const std::vector<WorkQueueConfig>& workQueues)
+    : name_(name), subscriptions_(subjects) {
+    history_.reset(new MessageHistory(subjects, history));
+    if (!history_->isEnabled()) {
+        history_.reset();
+    }
+    workQueues_.reset(new WorkQueues(workQueues));
+    if (!workQueues_->isEnabled()) {
+        workQueues_.reset();
+    }
+}
+
+Accounts::Accounts(SubjectTable& subjects, const std::vector<AccountConfig>& configs,
+                   const std::vector<SubjectHistoryLimit>& history, const std::vector<WorkQueueConfig>& workQueues) {
+    accounts_.emplace_back(new Account(GLOBAL, subjects, history, workQueues));
+    byName_[GLOBAL] = accounts_.back().get();
+
+    for (const auto& config : configs) {
+        if (config.name.empty() || byName_.count(config.name) > 0) {
+            std::cerr << "Ignoring duplicate account " << config.name << std::endl;
+            continue;
+        }
+
+        accounts_.emplace_back(new Account(config.name, subjects, history, workQueues));
+        Account* account = accounts_.back().get();
+        byName_[config.name] = account;
+        for (const auto& user : config.users) {
+            byUser_.emplace(user, account);
+        }
+    }
+
+    for (const auto& config : configs) {
+        Account* importer = byName_[config.name];
+        for (const auto& import : config.imports) {
+            std::string error;
+            if (!checkImport(configs, config, import, error)) {
+                std::cerr << "Ignoring import: " << error << std::endl;
+                continue;
+            }
+            byName_[import.account]->importers_.push_back(Account::Importer{importer, import.prefix});
+        }
+    }
+}
+
+Account& Accounts::findByUser(const std::string& user) {
+    auto it = byUser_.find(user);
+    return it != byUser_.end() ? *it->second : getGlobal();
+}
+
+Account* Accounts::find(const std::string& name) {
+    auto it = byName_.find(name);
+    return it != byName_.end() ? it->second : nullptr;
+}
+
+bool Accounts::validate(const std::vector<AccountConfig>& configs, std::string& error) {
+    std::unordered_map<std::string, std::string> users;
+    for (size_t i = 0; i < configs.size(); i++) {
+        const AccountConfig& config = configs[i];
+        if (config.name.empty() || config.name == GLOBAL || findConfig(configs, config.name) != &config) {
+            error = "invalid or duplicate account name " + config.name;
+            return false;
+        }
+
+        for (const auto& user : config.users) {
+            if (user.empty()) {
+                error = "empty user in account " + config.name;
+                return false;
+            }
+            if (!users.emplace(user, config.name).second) {
+                error = "user " + user + " is in accounts " + users[user] + " and " + config.name;
+                return false;
+            }
+        }
+    }
+
+    for (const auto& config : configs) {
+        for (const auto& import : config.imports) {
+            if (!checkImport(configs, config, import, error)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace pulse_broker
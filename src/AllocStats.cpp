@@ -0,0 +1,220 @@
+#include "../include/AllocStats.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+namespace pulse_broker {
+
+namespace {
+
+const size_t TAGS = static_cast<size_t>(AllocTag::COUNT);
+
+// Plain arrays of atomics, so they are usable from operator new before any
+// constructor has run.
+std::atomic<uint64_t> allocations[TAGS];
+std::atomic<uint64_t> deallocations[TAGS];
+std::atomic<uint64_t> allocatedBytes[TAGS];
+std::atomic<int64_t> liveBytes[TAGS];
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::atomic<int64_t> resetAtNs(nowNs());
+
+} // namespace
+
+const char* allocTagName(AllocTag tag) {
+    switch (tag) {
+        case AllocTag::PARSER:
+            return "parser";
+        case AllocTag::SUBSCRIPTIONS:
+            return "subscriptions";
+        case AllocTag::CLIENT_BUFFERS:
+            return "client_buffers";
+        case AllocTag::OUTBOUND_FRAMES:
+            return "outbound_frames";
+        default:
+            return "none";
+    }
+}
+
+void AllocRegistry::recordAllocation(AllocTag tag, size_t bytes) {
+    size_t index = static_cast<size_t>(tag);
+    allocations[index].fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes[index].fetch_add(bytes, std::memory_order_relaxed);
+    liveBytes[index].fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+}
+
+void AllocRegistry::recordDeallocation(AllocTag tag, size_t bytes) {
+    size_t index = static_cast<size_t>(tag);
+    deallocations[index].fetch_add(1, std::memory_order_relaxed);
+    liveBytes[index].fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+}
+
+std::vector<AllocReport> AllocRegistry::getReport() {
+    int64_t since = resetAtNs.load(std::memory_order_relaxed);
+    double seconds = static_cast<double>(nowNs() - since) / 1e9;
+
+    std::vector<AllocReport> reports;
+    for (size_t index = static_cast<size_t>(AllocTag::NONE) + 1; index < TAGS; index++) {
+        AllocReport report;
+        report.tag = allocTagName(static_cast<AllocTag>(index));
+        int64_t live = liveBytes[index].load(std::memory_order_relaxed);
+        report.liveBytes = live > 0 ? static_cast<uint64_t>(live) : 0;
+        report.allocations = allocations[index].load(std::memory_order_relaxed);
+        report.deallocations = deallocations[index].load(std::memory_order_relaxed);
+        report.allocatedBytes = allocatedBytes[index].load(std::memory_order_relaxed);
+        report.allocationsPerSecond = seconds > 0 ? report.allocations / seconds : 0;
+        reports.push_back(report);
+    }
+    return reports;
+}
+
+// Live bytes are kept: blocks allocated before the reset are still
+// uncounted when freed.
+void AllocRegistry::reset() {
+    for (size_t index = 0; index < TAGS; index++) {
+        allocations[index].store(0, std::memory_order_relaxed);
+        deallocations[index].store(0, std::memory_order_relaxed);
+        allocatedBytes[index].store(0, std::memory_order_relaxed);
+    }
+    resetAtNs.store(nowNs(), std::memory_order_relaxed);
+}
+
+bool AllocRegistry::isEnabled() {
+#ifdef PULSE_BROKER_ALLOC_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string AllocRegistry::toJson() {
+    std::ostringstream out;
+    out << "{\"enabled\":" << (isEnabled() ? "true" : "false") << ",\"tags\":[";
+
+    auto reports = getReport();
+    for (size_t i = 0; i < reports.size(); i++) {
+        const AllocReport& report = reports[i];
+        if (i > 0) {
+            out << ',';
+        }
+        out << "{\"tag\":\"" << report.tag << "\""
+            << ",\"live_bytes\":" << report.liveBytes
+            << ",\"allocations\":" << report.allocations
+            << ",\"deallocations\":" << report.deallocations
+            << ",\"allocated_bytes\":" << report.allocatedBytes
+            << ",\"allocations_per_sec\":" << static_cast<uint64_t>(report.allocationsPerSecond) << '}';
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+#ifdef PULSE_BROKER_ALLOC_STATS
+
+namespace {
+thread_local AllocTag currentTag = AllocTag::NONE;
+}
+
+AllocScope::AllocScope(AllocTag tag) : previous_(currentTag) {
+    currentTag = tag;
+}
+
+AllocScope::~AllocScope() {
+    currentTag = previous_;
+}
+
+#endif
+
+} // namespace pulse_broker
+
+#ifdef PULSE_BROKER_ALLOC_STATS
+
+// Every block carries its size and the tag it was allocated under, so
+// delete can uncount it without knowing where it came from.
+namespace {
+
+struct alignas(alignof(std::max_align_t)) BlockHeader {
+    size_t size;
+    pulse_broker::AllocTag tag;
+};
+
+void* allocateBlock(size_t size) {
+    void* memory = std::malloc(sizeof(BlockHeader) + size);
+    if (memory == nullptr) {
+        return nullptr;
+    }
+
+    BlockHeader* header = static_cast<BlockHeader*>(memory);
+    header->size = size;
+    header->tag = pulse_broker::currentTag;
+    if (header->tag != pulse_broker::AllocTag::NONE) {
+        pulse_broker::AllocRegistry::recordAllocation(header->tag, size);
+    }
+    return header + 1;
+}
+
+void freeBlock(void* block) {
+    if (block == nullptr) {
+        return;
+    }
+
+    BlockHeader* header = static_cast<BlockHeader*>(block) - 1;
+    if (header->tag != pulse_broker::AllocTag::NONE) {
+        pulse_broker::AllocRegistry::recordDeallocation(header->tag, header->size);
+    }
+    std::free(header);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* block = allocateBlock(size);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocateBlock(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocateBlock(size);
+}
+
+void operator delete(void* block) noexcept {
+    freeBlock(block);
+}
+
+void operator delete[](void* block) noexcept {
+    freeBlock(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    freeBlock(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    freeBlock(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+    freeBlock(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+    freeBlock(block);
+}
+
+#endif
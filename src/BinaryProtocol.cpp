@@ -0,0 +1,154 @@
+#include "../include/BinaryProtocol.h"
+
+namespace pulse_broker {
+
+uint32_t BinaryProtocol::readU32(const char* data) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+uint16_t BinaryProtocol::readU16(const char* data) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+void BinaryProtocol::appendU32(std::string& out, uint32_t value) {
+    char bytes[4] = {static_cast<char>(value & 0xff), static_cast<char>((value >> 8) & 0xff),
+                     static_cast<char>((value >> 16) & 0xff), static_cast<char>((value >> 24) & 0xff)};
+    out.append(bytes, sizeof(bytes));
+}
+
+void BinaryProtocol::appendU16(std::string& out, uint16_t value) {
+    char bytes[2] = {static_cast<char>(value & 0xff), static_cast<char>((value >> 8) & 0xff)};
+    out.append(bytes, sizeof(bytes));
+}
+
+size_t BinaryProtocol::parseFrame(const char* data, size_t size, BinaryFrame& frame) {
+    if (size < FRAME_HEADER_SIZE) {
+        frame.size = 0;
+        return 0;
+    }
+
+    frame.size = readU32(data);
+    frame.type = static_cast<FrameType>(static_cast<unsigned char>(data[4]));
+    if (size - FRAME_HEADER_SIZE < frame.size) {
+        return 0;
+    }
+
+    frame.body = data + FRAME_HEADER_SIZE;
+    return FRAME_HEADER_SIZE + frame.size;
+}
+
+bool BinaryProtocol::readRecord(const BinaryFrame& frame, size_t& offset, BinaryRecord& record) {
+    if (frame.size - offset < RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    const char* header = frame.body + offset;
+    record.id = readU32(header);
+    record.payloadSize = readU32(header + 4);
+    record.replySize = readU16(header + 8);
+    if (frame.size - offset - RECORD_HEADER_SIZE < record.replySize + record.payloadSize) {
+        return false;
+    }
+
+    record.replyTo = header + RECORD_HEADER_SIZE;
+    record.payload = record.replyTo + record.replySize;
+    offset += RECORD_HEADER_SIZE + record.replySize + record.payloadSize;
+    return true;
+}
+
+void BinaryProtocol::appendFrameHeader(std::string& out, FrameType type, size_t bodySize) {
+    appendU32(out, static_cast<uint32_t>(bodySize));
+    out += static_cast<char>(type);
+    out.append(3, '\0');
+}
+
+void BinaryProtocol::appendRecordHeader(std::string& out, uint32_t id, const std::string& replyTo,
+                                        size_t payloadSize) {
+    appendU32(out, id);
+    appendU32(out, static_cast<uint32_t>(payloadSize));
+    appendU16(out, static_cast<uint16_t>(replyTo.size()));
+    out.append(2, '\0');
+    out += replyTo;
+}
+
+std::string BinaryProtocol::generateMsgHeader(uint32_t sid, const std::string& replyTo, size_t payloadSize) {
+    std::string header;
+    header.reserve(FRAME_HEADER_SIZE + RECORD_HEADER_SIZE + replyTo.size());
+    appendFrameHeader(header, FrameType::MSG, getRecordSize(replyTo, payloadSize));
+    appendRecordHeader(header, sid, replyTo, payloadSize);
+    return header;
+}
+
+std::string BinaryProtocol::generateFrame(FrameType type, const std::string& body) {
+    std::string frame;
+    frame.reserve(FRAME_HEADER_SIZE + body.size());
+    appendFrameHeader(frame, type, body.size());
+    frame += body;
+    return frame;
+}
+
+std::string BinaryProtocol::generateSubject(uint32_t subjectId, const std::string& subject) {
+    std::string body;
+    appendU32(body, subjectId);
+    body += subject;
+    return generateFrame(FrameType::SUBJECT, body);
+}
+
+std::string BinaryProtocol::generateSub(uint32_t sid, uint32_t subjectId) {
+    std::string body;
+    appendU32(body, sid);
+    appendU32(body, subjectId);
+    return generateFrame(FrameType::SUB, body);
+}
+
+std::string BinaryProtocol::generateUnsub(uint32_t sid) {
+    std::string body;
+    appendU32(body, sid);
+    return generateFrame(FrameType::UNSUB, body);
+}
+
+std::string BinaryProtocol::fromTextControl(const std::string& line) {
+    size_t end = line.size() >= 2 && line.compare(line.size() - 2, 2, "\r\n") == 0 ? line.size() - 2 : line.size();
+
+    if (line.compare(0, end, "PING") == 0) {
+        return generateFrame(FrameType::PING);
+    }
+    if (line.compare(0, end, "PONG") == 0) {
+        return generateFrame(FrameType::PONG);
+    }
+    if (line.compare(0, end, "+OK") == 0) {
+        return generateFrame(FrameType::OK);
+    }
+    if (line.compare(0, 6, "-ERR '") == 0 && end > 6 && line[end - 1] == '\'') {
+        return generateFrame(FrameType::ERR, line.substr(6, end - 7));
+    }
+    if (line.compare(0, 5, "INFO ") == 0) {
+        return generateFrame(FrameType::INFO, line.substr(5, end - 5));
+    }
+    return generateFrame(FrameType::ERR, line.substr(0, end));
+}
+
+bool BinaryProtocol::parseSid(const std::string& sid, uint32_t& value) {
+    if (sid.empty() || sid.size() > 10) {
+        return false;
+    }
+
+    uint64_t result = 0;
+    for (char c : sid) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        result = result * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (result > UINT32_MAX) {
+        return false;
+    }
+
+    value = static_cast<uint32_t>(result);
+    return true;
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,53 @@
+#include "../include/BufferPool.h"
+
+namespace pulse_broker {
+
+BufferPool::BufferPool(size_t bufferCapacity, size_t maxPooled)
+    : bufferCapacity_(bufferCapacity), maxPooled_(maxPooled), outstanding_(0) {
+}
+
+std::unique_ptr<ReadBuffer> BufferPool::acquire() {
+    std::unique_ptr<ReadBuffer> buffer;
+
+    {
+        std::lock_guard<BrokerMutex> lock(mutex_);
+        outstanding_++;
+
+        if (!free_.empty()) {
+            buffer = std::move(free_.back());
+            free_.pop_back();
+            return buffer;
+        }
+    }
+
+    buffer.reset(new ReadBuffer());
+    buffer->reserve(bufferCapacity_);
+    return buffer;
+}
+
+void BufferPool::release(std::unique_ptr<ReadBuffer> buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    buffer->clear();
+
+    std::lock_guard<BrokerMutex> lock(mutex_);
+    outstanding_--;
+
+    if (free_.size() < maxPooled_ && buffer->capacity() <= bufferCapacity_ * 4) {
+        free_.push_back(std::move(buffer));
+    }
+}
+
+size_t BufferPool::getPooledCount() const {
+    std::lock_guard<BrokerMutex> lock(mutex_);
+    return free_.size();
+}
+
+size_t BufferPool::getOutstandingCount() const {
+    std::lock_guard<BrokerMutex> lock(mutex_);
+    return outstanding_;
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,281 @@
+#include "../include/ByteScan.h"
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PULSE_BROKER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define PULSE_BROKER_TARGET_AVX2
+#else
+#define PULSE_BROKER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace pulse_broker {
+
+namespace {
+
+using ScanFunction = bool (*)(const char*, size_t, HeaderScan&);
+
+struct ScanState {
+    bool inField = false;
+    size_t fieldStart = 0;
+};
+
+inline unsigned countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline void addField(HeaderScan& scan, size_t start, size_t end) {
+    if (scan.fieldCount < HeaderScan::MAX_FIELDS) {
+        scan.fields[scan.fieldCount].offset = static_cast<uint32_t>(start);
+        scan.fields[scan.fieldCount].size = static_cast<uint32_t>(end - start);
+        scan.fieldCount++;
+    }
+}
+
+inline bool finish(HeaderScan& scan, ScanState& state, size_t lineEnd) {
+    if (state.inField) {
+        addField(scan, state.fieldStart, lineEnd);
+        state.inField = false;
+    }
+    scan.lineEnd = lineEnd;
+    return true;
+}
+
+// Walks the bits where a block switches between field and whitespace bytes.
+// lanes is the number of valid low bits in nonWhitespace.
+inline void consumeBlock(size_t base, uint32_t nonWhitespace, unsigned lanes, ScanState& state, HeaderScan& scan) {
+    uint32_t valid = lanes >= 32 ? 0xFFFFFFFFu : ((1u << lanes) - 1);
+    nonWhitespace &= valid;
+
+    uint32_t previous = (nonWhitespace << 1) | (state.inField ? 1u : 0u);
+    uint32_t transitions = (nonWhitespace ^ previous) & valid;
+
+    while (transitions != 0) {
+        size_t position = base + countTrailingZeros(transitions);
+        transitions &= transitions - 1;
+
+        if (state.inField) {
+            addField(scan, state.fieldStart, position);
+            state.inField = false;
+        } else {
+            state.fieldStart = position;
+            state.inField = true;
+        }
+    }
+}
+
+// Returns the offset of the '\r' that terminates the line if one of the
+// newline bits in the block is preceded by a carriage return.
+inline size_t findTerminator(const char* data, size_t base, uint32_t newlines) {
+    while (newlines != 0) {
+        size_t position = base + countTrailingZeros(newlines);
+        newlines &= newlines - 1;
+
+        if (position > 0 && data[position - 1] == '\r') {
+            return position - 1;
+        }
+    }
+    return HeaderScan::NOT_FOUND;
+}
+
+inline bool scanTail(const char* data, size_t size, size_t position, ScanState& state, HeaderScan& scan) {
+    for (; position < size; position++) {
+        char c = data[position];
+
+        if (c == '\n' && position > 0 && data[position - 1] == '\r') {
+            return finish(scan, state, position - 1);
+        }
+
+        if (isWhitespace(c)) {
+            if (state.inField) {
+                addField(scan, state.fieldStart, position);
+                state.inField = false;
+            }
+        } else if (!state.inField) {
+            state.fieldStart = position;
+            state.inField = true;
+        }
+    }
+    return false;
+}
+
+inline bool finishBlock(const char* data, size_t base, unsigned lanes, uint32_t newlines, uint32_t nonWhitespace,
+                        ScanState& state, HeaderScan& scan) {
+    if (newlines != 0) {
+        size_t lineEnd = findTerminator(data, base, newlines);
+        if (lineEnd != HeaderScan::NOT_FOUND) {
+            if (lineEnd > base) {
+                consumeBlock(base, nonWhitespace, static_cast<unsigned>(lineEnd - base), state, scan);
+            }
+            return finish(scan, state, lineEnd);
+        }
+    }
+
+    consumeBlock(base, nonWhitespace, lanes, state, scan);
+    return false;
+}
+
+bool scanHeaderScalar(const char* data, size_t size, HeaderScan& scan) {
+    ScanState state;
+    return scanTail(data, size, 0, state, scan);
+}
+
+#ifdef PULSE_BROKER_X86
+
+bool scanHeaderSSE2(const char* data, size_t size, HeaderScan& scan) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    ScanState state;
+    size_t position = 0;
+
+    for (; position + 16 <= size; position += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        __m128i isNewline = _mm_cmpeq_epi8(block, newline);
+        __m128i isWhitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, carriageReturn), isNewline));
+
+        uint32_t newlines = static_cast<uint32_t>(_mm_movemask_epi8(isNewline));
+        uint32_t nonWhitespace = ~static_cast<uint32_t>(_mm_movemask_epi8(isWhitespace)) & 0xFFFFu;
+
+        if (finishBlock(data, position, 16, newlines, nonWhitespace, state, scan)) {
+            return true;
+        }
+    }
+
+    return scanTail(data, size, position, state, scan);
+}
+
+PULSE_BROKER_TARGET_AVX2
+bool scanHeaderAVX2(const char* data, size_t size, HeaderScan& scan) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriageReturn = _mm256_set1_epi8('\r');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+
+    ScanState state;
+    size_t position = 0;
+
+    for (; position + 32 <= size; position += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+        __m256i isNewline = _mm256_cmpeq_epi8(block, newline);
+        __m256i isWhitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, carriageReturn), isNewline));
+
+        uint32_t newlines = static_cast<uint32_t>(_mm256_movemask_epi8(isNewline));
+        uint32_t nonWhitespace = ~static_cast<uint32_t>(_mm256_movemask_epi8(isWhitespace));
+
+        if (finishBlock(data, position, 32, newlines, nonWhitespace, state, scan)) {
+            return true;
+        }
+    }
+
+    return scanTail(data, size, position, state, scan);
+}
+
+bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+ScanLevel detectLevel() {
+#ifdef PULSE_BROKER_X86
+    return cpuSupportsAVX2() ? ScanLevel::AVX2 : ScanLevel::SSE2;
+#else
+    return ScanLevel::SCALAR;
+#endif
+}
+
+ScanFunction functionFor(ScanLevel level) {
+    switch (level) {
+#ifdef PULSE_BROKER_X86
+        case ScanLevel::AVX2:
+            return scanHeaderAVX2;
+        case ScanLevel::SSE2:
+            return scanHeaderSSE2;
+#endif
+        default:
+            return scanHeaderScalar;
+    }
+}
+
+std::atomic<int> activeLevel(static_cast<int>(detectLevel()));
+std::atomic<ScanFunction> activeScan(functionFor(detectLevel()));
+
+} // namespace
+
+ScanLevel detectScanLevel() {
+    static const ScanLevel detected = detectLevel();
+    return detected;
+}
+
+ScanLevel getScanLevel() {
+    return static_cast<ScanLevel>(activeLevel.load(std::memory_order_relaxed));
+}
+
+void setScanLevel(ScanLevel level) {
+    if (static_cast<int>(level) > static_cast<int>(detectScanLevel())) {
+        level = detectScanLevel();
+    }
+
+    activeLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+    activeScan.store(functionFor(level), std::memory_order_relaxed);
+}
+
+const char* scanLevelName(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::AVX2:
+            return "avx2";
+        case ScanLevel::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+bool scanHeader(const char* data, size_t size, HeaderScan& scan) {
+    scan.lineEnd = HeaderScan::NOT_FOUND;
+    scan.fieldCount = 0;
+    return activeScan.load(std::memory_order_relaxed)(data, size, scan);
+}
+
+} // namespace pulse_broker
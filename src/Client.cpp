@@ -1,5 +1,6 @@
 #include "../include/Client.h"
-#include "../include/Subscription.h"
+#include "../include/IoLoop.h"
+#include "../include/Probes.h"
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <iostream>
@@ -8,95 +9,463 @@
 
 namespace pulse_broker {
 
+namespace {
+std::atomic<uint64_t> nextClientId(1);
+}
+
 Client::Client(int socket, const std::string& host, const std::string& ip)
-    : socket_(socket), host_(host), ip_(ip), connected_(true) {
+    : id_(nextClientId++), socket_(socket), host_(host), ip_(ip), connected_(true), slowConsumer_(false),
+      verbose_(true), pedantic_(false), echo_(true), connectReceived_(false), binary_(false), pingsOutstanding_(0),
+      ioLoop_(nullptr), ioSlot_(0), readPauseNs_(0), expectedInput_(0),
+      memoryBudget_(nullptr), account_(nullptr), chargedBytes_(0) {
 }
 
 Client::~Client() {
     disconnect();
 }
 
+bool Client::sendControl(const std::string& message) {
+    if (binary_) {
+        return enqueue(BinaryProtocol::fromTextControl(message), true);
+    }
+    return enqueue(message, true);
+}
+
 bool Client::sendMessage(const std::string& message) {
+    return enqueue(message, false);
+}
+
+bool Client::sendMessage(const std::string& header, const char* payload, size_t payloadSize) {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+
+    if (!connected_ || slowConsumer_) {
+        return false;
+    }
+
+    size_t trailerSize = binary_ ? 0 : 2;
+    size_t frameSize = header.size() + payloadSize + trailerSize;
+    PULSE_PROBE2(message__enqueued, id_, frameSize);
+
+    int sent = 0;
+    if (!outbound_ && writesPlaintext()) {
+        WSABUF buffers[3];
+        buffers[0].buf = const_cast<char*>(header.data());
+        buffers[0].len = static_cast<u_long>(header.size());
+        buffers[1].buf = const_cast<char*>(payload);
+        buffers[1].len = static_cast<u_long>(payloadSize);
+        buffers[2].buf = const_cast<char*>("\r\n");
+        buffers[2].len = static_cast<u_long>(trailerSize);
+
+        DWORD written = 0;
+        if (WSASend(socket_, buffers, trailerSize > 0 ? 3 : 2, &written, 0, nullptr, nullptr) == SOCKET_ERROR) {
+            if (WSAGetLastError() != WSAEWOULDBLOCK) {
+                return false;
+            }
+            written = 0;
+        }
+        if (written > 0) {
+            PULSE_PROBE2(message__flushed, id_, written);
+        }
+        if (written == frameSize) {
+            return true;
+        }
+        sent = static_cast<int>(written);
+    }
+
+    AllocScope scope(AllocTag::OUTBOUND_FRAMES);
+    std::string frame;
+    frame.reserve(frameSize);
+    frame.append(header).append(payload, payloadSize).append("\r\n", trailerSize);
+
+    // OpenSSL encrypts from one buffer, so user-space TLS pays the copy.
+    if (!outbound_ && !writesPlaintext()) {
+        sent = write(frame.data(), frame.size());
+        if (sent > 0) {
+            PULSE_PROBE2(message__flushed, id_, sent);
+        }
+        if (sent == static_cast<int>(frame.size())) {
+            return true;
+        }
+        if (sent == SOCKET_ERROR) {
+            if (WSAGetLastError() != WSAEWOULDBLOCK) {
+                return false;
+            }
+            sent = 0;
+        }
+    }
+    return queueRemainder(frame, sent, false);
+}
+
+bool Client::enqueue(const std::string& message, bool control) {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+
+    if (!connected_ || slowConsumer_) {
+        return false;
+    }
+
+    PULSE_PROBE2(message__enqueued, id_, message.size());
+
+    int sent = 0;
+    if (!outbound_) {
+        sent = write(message.data(), message.size());
+        if (sent > 0) {
+            PULSE_PROBE2(message__flushed, id_, sent);
+        }
+        if (sent == static_cast<int>(message.size())) {
+            return true;
+        }
+        if (sent == SOCKET_ERROR) {
+            if (WSAGetLastError() != WSAEWOULDBLOCK) {
+                return false;
+            }
+            sent = 0;
+        }
+    }
+
+    return queueRemainder(message, sent, control);
+}
+
+// Called with sendMutex_ held. The first sent bytes of message have already
+// been written, which only happens while nothing is queued.
+bool Client::queueRemainder(const std::string& message, int sent, bool control) {
+    if (!outbound_) {
+        // Only sockets attached to a loop are non-blocking and can get here.
+        if (!ioLoop_) {
+            return false;
+        }
+
+        outbound_.reset(new OutboundQueue());
+        if (!tls_ || tls_->isEstablished()) {
+            ioLoop_->requestWrite(this);
+        }
+
+        // A partly written frame has to finish before anything else,
+        // including control frames.
+        if (sent > 0) {
+            outbound_->current.assign(message.data() + sent, message.size() - sent);
+            charge(MemoryUse::OUTBOUND, static_cast<int64_t>(outbound_->current.size()));
+            return true;
+        }
+    }
+
+    OutboundQueue& queue = *outbound_;
+    if (control) {
+        queue.control.emplace_back(message.data(), message.size());
+        queue.controlBytes += message.size();
+        charge(MemoryUse::OUTBOUND, static_cast<int64_t>(message.size()));
+    } else {
+        if (queue.dataBytes + message.size() > MAX_PENDING_DATA) {
+            dropSlowConsumer();
+            return false;
+        }
+        queue.data.emplace_back(message.data(), message.size());
+        queue.dataBytes += message.size();
+        charge(MemoryUse::OUTBOUND, static_cast<int64_t>(message.size()));
+    }
+    return true;
+}
+
+// Called with sendMutex_ held, so the connection is left for flushOutbound()
+// to close rather than disconnected from here.
+void Client::dropSlowConsumer() {
+    slowConsumer_ = true;
+
+    OutboundQueue& queue = *outbound_;
+    charge(MemoryUse::OUTBOUND, -static_cast<int64_t>(queue.dataBytes));
+    queue.data.clear();
+    queue.dataBytes = 0;
+
+    std::string message = "-ERR 'Slow Consumer'\r\n";
+    if (binary_) {
+        message = BinaryProtocol::fromTextControl(message);
+    }
+    queue.control.emplace_back(message.data(), message.size());
+    queue.controlBytes += message.size();
+    charge(MemoryUse::OUTBOUND, static_cast<int64_t>(message.size()));
+}
+
+// Called with sendMutex_ held. Every queued frame was charged in full when
+// it was queued, including the part of current already written.
+void Client::resetOutbound() {
+    if (!outbound_) {
+        return;
+    }
+
+    const OutboundQueue& queue = *outbound_;
+    charge(MemoryUse::OUTBOUND, -static_cast<int64_t>(queue.current.size() + queue.controlBytes + queue.dataBytes));
+    outbound_.reset();
+}
+
+void Client::charge(MemoryUse use, int64_t bytes) {
+    chargedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+    if (memoryBudget_) {
+        memoryBudget_->charge(use, bytes);
+    }
+}
+
+size_t Client::getChargedBytes() const {
+    int64_t bytes = chargedBytes_.load(std::memory_order_relaxed);
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
+
+int64_t Client::takeReadPause() {
+    int64_t pause = readPauseNs_;
+    readPauseNs_ = 0;
+    return pause;
+}
+
+size_t Client::takeExpectedInput() {
+    size_t bytes = expectedInput_;
+    expectedInput_ = 0;
+    return bytes;
+}
+
+void Client::attachIoLoop(IoLoop* loop) {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+
+    u_long nonBlocking = 1;
+    ioctlsocket(socket_, FIONBIO, &nonBlocking);
+    ioLoop_ = loop;
+}
+
+void Client::detachIoLoop() {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+    ioLoop_ = nullptr;
+}
+
+std::string Client::takeOutbound() {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+
+    std::string output;
+    if (!outbound_) {
+        return output;
+    }
+
+    OutboundQueue& queue = *outbound_;
+    output.reserve(queue.current.size() - queue.offset + queue.controlBytes + queue.dataBytes);
+    output.append(queue.current.data() + queue.offset, queue.current.size() - queue.offset);
+    for (const auto& frame : queue.control) {
+        output.append(frame.data(), frame.size());
+    }
+    for (const auto& frame : queue.data) {
+        output.append(frame.data(), frame.size());
+    }
+
+    resetOutbound();
+    return output;
+}
+
+void Client::restoreOutbound(const std::string& output) {
+    if (output.empty()) {
+        return;
+    }
+
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+    outbound_.reset(new OutboundQueue());
+    outbound_->current.assign(output.data(), output.size());
+    charge(MemoryUse::OUTBOUND, static_cast<int64_t>(output.size()));
+}
+
+bool Client::flushOutbound() {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+
     if (!connected_) {
         return false;
     }
 
-    int result = send(socket_, message.c_str(), static_cast<int>(message.size()), 0);
-    return result != SOCKET_ERROR;
+    while (outbound_) {
+        OutboundQueue& queue = *outbound_;
+
+        if (queue.offset == queue.current.size()) {
+            charge(MemoryUse::OUTBOUND, -static_cast<int64_t>(queue.current.size()));
+            queue.current.clear();
+            if (!queue.control.empty()) {
+                queue.current.swap(queue.control.front());
+                queue.control.pop_front();
+                queue.controlBytes -= queue.current.size();
+            } else if (!queue.data.empty()) {
+                queue.current.swap(queue.data.front());
+                queue.data.pop_front();
+                queue.dataBytes -= queue.current.size();
+            } else {
+                resetOutbound();
+                return !slowConsumer_;
+            }
+            queue.offset = 0;
+        }
+
+        int sent = write(queue.current.data() + queue.offset, queue.current.size() - queue.offset);
+        if (sent == SOCKET_ERROR) {
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+        }
+        queue.offset += sent;
+        PULSE_PROBE2(message__flushed, id_, sent);
+    }
+
+    return true;
+}
+
+bool Client::hasPendingOutput() const {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+    return outbound_ != nullptr;
+}
+
+size_t Client::getPendingBytes() const {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+
+    if (!outbound_) {
+        return 0;
+    }
+    return outbound_->current.size() - outbound_->offset + outbound_->controlBytes + outbound_->dataBytes;
+}
+
+void Client::enableBinary() {
+    if (!binarySession_) {
+        binarySession_.reset(new BinarySession());
+    }
+    binary_ = true;
+}
+
+void Client::enableTls(std::unique_ptr<TlsSession> session) {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+    tls_ = std::move(session);
+}
+
+// Called with sendMutex_ held.
+int Client::write(const char* data, size_t size) {
+    if (writesPlaintext()) {
+        return send(socket_, data, static_cast<int>(size), 0);
+    }
+    return tls_->write(data, size);
 }
 
-std::string Client::receiveMessage() {
+void Client::setConnectOptions(const ConnectOptions& options) {
+    verbose_ = options.verbose;
+    pedantic_ = options.pedantic;
+    echo_ = options.echo;
+    connectReceived_ = true;
+}
+
+int Client::receive(char* buffer, size_t size) {
     if (!connected_) {
-        return "";
+        return 0;
+    }
+    if (tls_) {
+        return receiveTls(buffer, size);
     }
 
-    char buffer[4096];
-    int bytesReceived = recv(socket_, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytesReceived <= 0) {
-        disconnect();
-        return "";
+    return recv(socket_, buffer, static_cast<int>(size), 0);
+}
+
+int Client::receiveTls(char* buffer, size_t size) {
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+
+    bool established = tls_->isEstablished();
+    size_t total = 0;
+    int received = 0;
+    while ((total == 0 || size - total >= TlsSession::MAX_RECORD_SIZE) &&
+           (received = tls_->read(buffer + total, size - total)) > 0) {
+        total += static_cast<size_t>(received);
     }
-    
-    buffer[bytesReceived] = '\0';
-    return std::string(buffer, bytesReceived);
+    int error = WSAGetLastError();
+
+    if (!established && tls_->isEstablished() && outbound_ && ioLoop_) {
+        ioLoop_->requestWrite(this);
+    }
+
+    if (total > 0) {
+        return static_cast<int>(total);
+    }
+    WSASetLastError(error);
+    return received;
 }
 
-bool Client::addSubscription(const std::string& subject, const std::string& sid) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool Client::addSubscription(const std::string& sid, SubscriptionHandle handle, SubjectId subjectId) {
+    std::lock_guard<BrokerMutex> lock(mutex_);
+    AllocScope scope(AllocTag::SUBSCRIPTIONS);
     
-    if (subscriptions_.find(sid) != subscriptions_.end()) {
+    if (!subscriptions_.emplace(sid, handle).second) {
         return false;
     }
     
-    auto subscription = std::make_shared<Subscription>(
-        std::weak_ptr<Client>{}, subject, sid);
-    
-    subscriptions_[sid] = subscription;
-    
+    subjectCounts_[subjectId]++;
     return true;
 }
 
-bool Client::removeSubscription(const std::string& sid) {
-    std::lock_guard<std::mutex> lock(mutex_);
+SubscriptionHandle Client::removeSubscription(const std::string& sid, SubjectId subjectId) {
+    std::lock_guard<BrokerMutex> lock(mutex_);
     
     auto it = subscriptions_.find(sid);
     if (it == subscriptions_.end()) {
-        return false;
+        return SubscriptionStore::INVALID_HANDLE;
     }
     
+    SubscriptionHandle handle = it->second;
     subscriptions_.erase(it);
-    return true;
+
+    auto count = subjectCounts_.find(subjectId);
+    if (count != subjectCounts_.end() && --count->second == 0) {
+        subjectCounts_.erase(count);
+    }
+    return handle;
 }
 
-bool Client::hasSubscription(const std::string& subject) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+std::vector<SubscriptionHandle> Client::takeSubscriptions() {
+    std::lock_guard<BrokerMutex> lock(mutex_);
+
+    std::vector<SubscriptionHandle> handles;
+    handles.reserve(subscriptions_.size());
     for (const auto& pair : subscriptions_) {
-        if (pair.second->getSubject() == subject) {
-            return true;
-        }
+        handles.push_back(pair.second);
     }
-    
-    return false;
+
+    subscriptions_.clear();
+    subjectCounts_.clear();
+    return handles;
+}
+
+bool Client::hasSubscription(SubjectId subjectId) const {
+    std::lock_guard<BrokerMutex> lock(mutex_);
+    return subjectCounts_.find(subjectId) != subjectCounts_.end();
 }
 
-std::shared_ptr<Subscription> Client::getSubscription(const std::string& sid) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+SubscriptionHandle Client::getSubscription(const std::string& sid) const {
+    std::lock_guard<BrokerMutex> lock(mutex_);
     
     auto it = subscriptions_.find(sid);
-    if (it != subscriptions_.end()) {
-        return it->second;
+    return it != subscriptions_.end() ? it->second : SubscriptionStore::INVALID_HANDLE;
+}
+
+std::vector<std::pair<std::string, SubscriptionHandle>> Client::getSubscriptions() const {
+    std::lock_guard<BrokerMutex> lock(mutex_);
+    return std::vector<std::pair<std::string, SubscriptionHandle>>(subscriptions_.begin(), subscriptions_.end());
+}
+
+size_t Client::getSubscriptionCount() const {
+    std::lock_guard<BrokerMutex> lock(mutex_);
+    return subscriptions_.size();
+}
+
+void Client::detachSocket() {
+    if (!connected_.exchange(false)) {
+        return;
     }
-    
-    return nullptr;
+
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+    closesocket(socket_);
+    resetOutbound();
 }
 
 void Client::disconnect() {
-    if (connected_) {
-        connected_ = false;
-        closesocket(socket_);
+    if (!connected_.exchange(false)) {
+        return;
     }
+
+    shutdown(socket_, SD_BOTH);
+
+    std::lock_guard<BrokerMutex> lock(sendMutex_);
+    closesocket(socket_);
+    resetOutbound();
 }
 
 } // namespace pulse_broker 
\ No newline at end of file
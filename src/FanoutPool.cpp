@@ -0,0 +1,84 @@
+#include "../include/FanoutPool.h"
+#include <algorithm>
+
+namespace pulse_broker {
+
+FanoutPool::FanoutPool(size_t workers)
+    : task_(nullptr), count_(0), shares_(0), pending_(0), generation_(0), stopping_(false) {
+    for (size_t i = 0; i < workers; i++) {
+        workers_.emplace_back(&FanoutPool::work, this, i + 1);
+    }
+}
+
+FanoutPool::~FanoutPool() {
+    {
+        std::lock_guard<BrokerMutex> lock(mutex_);
+        stopping_ = true;
+    }
+    startCondition_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void FanoutPool::run(size_t count, const Task& task) {
+    size_t shares = std::min(workers_.size() + 1, count);
+    if (shares <= 1) {
+        task(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<BrokerMutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        shares_ = shares;
+        pending_ = shares - 1;
+        generation_++;
+    }
+    startCondition_.notify_all();
+
+    runShare(0);
+
+    std::unique_lock<BrokerMutex> lock(mutex_);
+    doneCondition_.wait(lock, [this]() { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void FanoutPool::runShare(size_t share) {
+    size_t begin = share * count_ / shares_;
+    size_t end = (share + 1) * count_ / shares_;
+    (*task_)(begin, end);
+}
+
+void FanoutPool::work(size_t share) {
+    uint64_t seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<BrokerMutex> lock(mutex_);
+            startCondition_.wait(lock, [this, seen]() { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+            if (share >= shares_) {
+                continue;
+            }
+        }
+
+        runShare(share);
+
+        bool last;
+        {
+            std::lock_guard<BrokerMutex> lock(mutex_);
+            last = --pending_ == 0;
+        }
+        if (last) {
+            doneCondition_.notify_one();
+        }
+    }
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,409 @@
+#include "../include/Handoff.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <afunix.h>
+#include <cstring>
+#include <vector>
+
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Advapi32.lib")
+
+#ifndef SIO_AF_UNIX_GETPEERPID
+#define SIO_AF_UNIX_GETPEERPID _WSAIOR(IOC_VENDOR, 256)
+#endif
+
+namespace pulse_broker {
+
+namespace {
+
+const char MAGIC[4] = {'P', 'B', 'H', '5'};
+const uint32_t MAX_FRAME_SIZE = 1u << 30;
+
+void appendU32(std::string& out, uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+    out.append(bytes, 4);
+}
+
+void appendU64(std::string& out, uint64_t value) {
+    appendU32(out, static_cast<uint32_t>(value));
+    appendU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void appendString(std::string& out, const std::string& value) {
+    appendU32(out, static_cast<uint32_t>(value.size()));
+    out += value;
+}
+
+class Reader {
+public:
+    explicit Reader(const std::string& data) : data_(data), offset_(0) {
+    }
+
+    bool readU32(uint32_t& value) {
+        if (data_.size() - offset_ < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(data_[offset_ + i])) << (8 * i);
+        }
+        offset_ += 4;
+        return true;
+    }
+
+    bool readU64(uint64_t& value) {
+        uint32_t low;
+        uint32_t high;
+        if (!readU32(low) || !readU32(high)) {
+            return false;
+        }
+        value = static_cast<uint64_t>(high) << 32 | low;
+        return true;
+    }
+
+    bool readString(std::string& value) {
+        uint32_t size;
+        if (!readU32(size) || data_.size() - offset_ < size) {
+            return false;
+        }
+        value.assign(data_, offset_, size);
+        offset_ += size;
+        return true;
+    }
+
+    bool atEnd() const { return offset_ == data_.size(); }
+
+private:
+    const std::string& data_;
+    size_t offset_;
+};
+
+bool sendAll(int socket, const char* data, size_t size) {
+    while (size > 0) {
+        int sent = send(socket, data, static_cast<int>(size), 0);
+        if (sent == SOCKET_ERROR || sent == 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool receiveAll(int socket, char* data, size_t size) {
+    while (size > 0) {
+        int received = recv(socket, data, static_cast<int>(size), 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+} // namespace
+
+std::string Handoff::encode(const HandoffState& state) {
+    std::string out(MAGIC, sizeof(MAGIC));
+    appendString(out, state.tcpListener);
+    appendString(out, state.unixListener);
+    appendString(out, state.unixSocketPath);
+
+    appendU32(out, static_cast<uint32_t>(state.clients.size()));
+    for (const auto& client : state.clients) {
+        uint32_t flags = (client.connectReceived ? 1u : 0u) | (client.connectOptions.verbose ? 2u : 0u) |
+                         (client.connectOptions.pedantic ? 4u : 0u) | (client.connectOptions.echo ? 8u : 0u) |
+                         (client.connectOptions.binary ? 16u : 0u);
+
+        appendString(out, client.socketInfo);
+        appendString(out, client.ip);
+        appendString(out, client.account);
+        appendU32(out, flags);
+
+        appendU32(out, static_cast<uint32_t>(client.subscriptions.size()));
+        for (const auto& subscription : client.subscriptions) {
+            appendString(out, subscription.first);
+            appendString(out, subscription.second);
+        }
+
+        appendU32(out, static_cast<uint32_t>(client.binarySubjects.size()));
+        for (const auto& subject : client.binarySubjects) {
+            appendU32(out, subject.first);
+            appendString(out, subject.second);
+        }
+        appendU32(out, client.resumeRecord);
+
+        appendString(out, client.pendingInput);
+        appendString(out, client.pendingOutput);
+    }
+
+    appendU32(out, static_cast<uint32_t>(state.accounts.size()));
+    for (const auto& account : state.accounts) {
+        appendString(out, account.name);
+
+        const WorkQueueState& queues = account.workQueues;
+        appendU64(out, queues.nextSequence);
+        appendU32(out, static_cast<uint32_t>(queues.messages.size()));
+        for (const auto& entry : queues.messages) {
+            appendString(out, entry.subject);
+            appendU64(out, entry.message.sequence);
+            appendU32(out, entry.message.deliveries);
+            appendString(out, entry.message.payload ? *entry.message.payload : std::string());
+            appendU32(out, static_cast<uint32_t>(entry.ackWaitMs));
+        }
+        appendU32(out, static_cast<uint32_t>(queues.fetches.size()));
+        for (const auto& fetch : queues.fetches) {
+            appendString(out, fetch.subject);
+            appendString(out, fetch.inbox);
+            appendU32(out, static_cast<uint32_t>(fetch.batch));
+            appendU32(out, static_cast<uint32_t>(fetch.expiresMs));
+        }
+
+        appendU32(out, static_cast<uint32_t>(account.history.messages.size()));
+        for (const auto& entry : account.history.messages) {
+            appendString(out, entry.subject);
+            appendString(out, entry.message.replyTo);
+            appendString(out, entry.message.payload ? *entry.message.payload : std::string());
+        }
+    }
+    return out;
+}
+
+bool Handoff::decode(const std::string& data, HandoffState& state) {
+    if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    std::string body = data.substr(sizeof(MAGIC));
+    Reader reader(body);
+
+    uint32_t clientCount;
+    if (!reader.readString(state.tcpListener) || !reader.readString(state.unixListener) ||
+        !reader.readString(state.unixSocketPath) || !reader.readU32(clientCount)) {
+        return false;
+    }
+
+    state.clients.clear();
+    for (uint32_t i = 0; i < clientCount; i++) {
+        HandoffClient client;
+        uint32_t flags;
+        uint32_t subscriptionCount;
+
+        if (!reader.readString(client.socketInfo) || !reader.readString(client.ip) ||
+            !reader.readString(client.account) || !reader.readU32(flags) || !reader.readU32(subscriptionCount)) {
+            return false;
+        }
+
+        client.connectReceived = (flags & 1u) != 0;
+        client.connectOptions.verbose = (flags & 2u) != 0;
+        client.connectOptions.pedantic = (flags & 4u) != 0;
+        client.connectOptions.echo = (flags & 8u) != 0;
+        client.connectOptions.binary = (flags & 16u) != 0;
+
+        for (uint32_t j = 0; j < subscriptionCount; j++) {
+            std::pair<std::string, std::string> subscription;
+            if (!reader.readString(subscription.first) || !reader.readString(subscription.second)) {
+                return false;
+            }
+            client.subscriptions.push_back(std::move(subscription));
+        }
+
+        uint32_t subjectCount;
+        if (!reader.readU32(subjectCount)) {
+            return false;
+        }
+        for (uint32_t j = 0; j < subjectCount; j++) {
+            std::pair<uint32_t, std::string> subject;
+            if (!reader.readU32(subject.first) || !reader.readString(subject.second)) {
+                return false;
+            }
+            client.binarySubjects.push_back(std::move(subject));
+        }
+        if (!reader.readU32(client.resumeRecord)) {
+            return false;
+        }
+
+        if (!reader.readString(client.pendingInput) || !reader.readString(client.pendingOutput)) {
+            return false;
+        }
+        state.clients.push_back(std::move(client));
+    }
+
+    uint32_t accountCount;
+    if (!reader.readU32(accountCount)) {
+        return false;
+    }
+
+    state.accounts.clear();
+    for (uint32_t i = 0; i < accountCount; i++) {
+        HandoffAccount account;
+        WorkQueueState& queues = account.workQueues;
+        uint32_t messageCount;
+        if (!reader.readString(account.name) || !reader.readU64(queues.nextSequence) ||
+            !reader.readU32(messageCount)) {
+            return false;
+        }
+
+        for (uint32_t j = 0; j < messageCount; j++) {
+            WorkQueueState::Message entry;
+            std::string payload;
+            uint32_t ackWaitMs;
+            if (!reader.readString(entry.subject) || !reader.readU64(entry.message.sequence) ||
+                !reader.readU32(entry.message.deliveries) || !reader.readString(payload) ||
+                !reader.readU32(ackWaitMs)) {
+                return false;
+            }
+            entry.message.payload = std::make_shared<const std::string>(std::move(payload));
+            entry.ackWaitMs = static_cast<int>(ackWaitMs);
+            queues.messages.push_back(std::move(entry));
+        }
+
+        uint32_t fetchCount;
+        if (!reader.readU32(fetchCount)) {
+            return false;
+        }
+        for (uint32_t j = 0; j < fetchCount; j++) {
+            WorkQueueState::Fetch fetch;
+            uint32_t batch;
+            uint32_t expiresMs;
+            if (!reader.readString(fetch.subject) || !reader.readString(fetch.inbox) || !reader.readU32(batch) ||
+                !reader.readU32(expiresMs)) {
+                return false;
+            }
+            fetch.batch = batch;
+            fetch.expiresMs = static_cast<int>(expiresMs);
+            queues.fetches.push_back(std::move(fetch));
+        }
+
+        uint32_t historyCount;
+        if (!reader.readU32(historyCount)) {
+            return false;
+        }
+        for (uint32_t j = 0; j < historyCount; j++) {
+            MessageHistoryState::Message entry;
+            std::string payload;
+            if (!reader.readString(entry.subject) || !reader.readString(entry.message.replyTo) ||
+                !reader.readString(payload)) {
+                return false;
+            }
+            entry.message.payload = std::make_shared<const std::string>(std::move(payload));
+            account.history.messages.push_back(std::move(entry));
+        }
+        state.accounts.push_back(std::move(account));
+    }
+
+    return reader.atEnd();
+}
+
+bool Handoff::sendFrame(int socket, const std::string& frame) {
+    std::string header;
+    appendU32(header, static_cast<uint32_t>(frame.size()));
+    return sendAll(socket, header.data(), header.size()) && sendAll(socket, frame.data(), frame.size());
+}
+
+bool Handoff::receiveFrame(int socket, std::string& frame) {
+    std::string header(4, '\0');
+    if (!receiveAll(socket, &header[0], header.size())) {
+        return false;
+    }
+
+    uint32_t size;
+    Reader reader(header);
+    if (!reader.readU32(size) || size > MAX_FRAME_SIZE) {
+        return false;
+    }
+
+    frame.resize(size);
+    return size == 0 || receiveAll(socket, &frame[0], size);
+}
+
+namespace {
+
+// The TOKEN_USER of process, or an empty buffer.
+std::vector<char> tokenUser(HANDLE process) {
+    HANDLE token;
+    if (!OpenProcessToken(process, TOKEN_QUERY, &token)) {
+        return std::vector<char>();
+    }
+
+    DWORD size = 0;
+    GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+    std::vector<char> user(size);
+    if (size == 0 || !GetTokenInformation(token, TokenUser, user.data(), size, &size)) {
+        user.clear();
+    }
+    CloseHandle(token);
+    return user;
+}
+
+std::wstring imagePath(HANDLE process) {
+    std::wstring path(32768, L'\0');
+    DWORD size = static_cast<DWORD>(path.size());
+    if (!QueryFullProcessImageNameW(process, 0, &path[0], &size)) {
+        return std::wstring();
+    }
+    path.resize(size);
+    return path;
+}
+
+}
+
+bool Handoff::isTrustedPeer(int socket, uint32_t processId) {
+    ULONG peerId = 0;
+    DWORD returned = 0;
+    if (WSAIoctl(socket, SIO_AF_UNIX_GETPEERPID, nullptr, 0, &peerId, sizeof(peerId), &returned, nullptr,
+                 nullptr) == SOCKET_ERROR || peerId != processId) {
+        return false;
+    }
+
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (process == nullptr) {
+        return false;
+    }
+
+    std::vector<char> peerUser = tokenUser(process);
+    std::vector<char> ownUser = tokenUser(GetCurrentProcess());
+    std::wstring peerImage = imagePath(process);
+    std::wstring ownImage = imagePath(GetCurrentProcess());
+    CloseHandle(process);
+
+    if (peerUser.empty() || ownUser.empty() ||
+        !EqualSid(reinterpret_cast<TOKEN_USER*>(peerUser.data())->User.Sid,
+                  reinterpret_cast<TOKEN_USER*>(ownUser.data())->User.Sid)) {
+        return false;
+    }
+    return !peerImage.empty() &&
+           CompareStringOrdinal(peerImage.c_str(), -1, ownImage.c_str(), -1, TRUE) == CSTR_EQUAL;
+}
+
+uint32_t Handoff::currentProcessId() {
+    return static_cast<uint32_t>(GetCurrentProcessId());
+}
+
+bool Handoff::duplicateSocket(int socket, uint32_t processId, std::string& info) {
+    WSAPROTOCOL_INFOW protocolInfo;
+    if (WSADuplicateSocketW(socket, processId, &protocolInfo) == SOCKET_ERROR) {
+        return false;
+    }
+
+    info.assign(reinterpret_cast<const char*>(&protocolInfo), sizeof(protocolInfo));
+    return true;
+}
+
+int Handoff::openSocket(const std::string& info) {
+    if (info.size() != sizeof(WSAPROTOCOL_INFOW)) {
+        return static_cast<int>(INVALID_SOCKET);
+    }
+
+    WSAPROTOCOL_INFOW protocolInfo;
+    std::memcpy(&protocolInfo, info.data(), sizeof(protocolInfo));
+    return static_cast<int>(WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO,
+                                       &protocolInfo, 0, 0));
+}
+
+} // namespace pulse_broker
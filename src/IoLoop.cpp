@@ -0,0 +1,477 @@
+#include "../include/IoLoop.h"
+#include "../include/Client.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iostream>
+#include <algorithm>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+namespace pulse_broker {
+
+IoLoop::IoLoop(ReadHandler onRead, CloseHandler onClose, const KeepaliveOptions& keepalive)
+    : onRead_(onRead), onClose_(onClose), keepaliveOptions_(keepalive),
+      timerWheel_(std::chrono::milliseconds(keepalive.timerResolutionMs),
+                  [this](TimingWheel::Timer& timer) { handleTimer(static_cast<ConnectionTimer&>(timer)); }),
+      running_(false), wakeSocket_(INVALID_SOCKET),
+      clientCount_(0), bufferedCount_(0), evictedCount_(0) {
+}
+
+IoLoop::~IoLoop() {
+    stop();
+}
+
+bool IoLoop::start() {
+    if (running_) {
+        return true;
+    }
+
+    if (!createWakeSocket()) {
+        return false;
+    }
+
+    readChunk_.resize(READ_CHUNK_SIZE);
+
+    pollfd wakeFd = {};
+    wakeFd.fd = wakeSocket_;
+    wakeFd.events = POLLRDNORM;
+    pollFds_.push_back(wakeFd);
+    connections_.emplace_back();
+
+    running_ = true;
+    thread_ = std::thread(&IoLoop::run, this);
+    return true;
+}
+
+void IoLoop::stop() {
+    if (!running_) {
+        return;
+    }
+
+    stopThread();
+
+    while (connections_.size() > 1) {
+        closeConnection(connections_.size() - 1);
+    }
+
+    std::vector<DetachedClient> pending;
+    {
+        std::lock_guard<BrokerMutex> lock(pendingMutex_);
+        pending.swap(pending_);
+        writeRequests_.clear();
+    }
+    for (auto& entry : pending) {
+        entry.client->disconnect();
+    }
+
+    releaseResources();
+}
+
+std::vector<IoLoop::DetachedClient> IoLoop::detach() {
+    std::vector<DetachedClient> detached;
+    if (!running_) {
+        return detached;
+    }
+
+    stopThread();
+
+    for (size_t i = 1; i < connections_.size(); i++) {
+        Connection& connection = connections_[i];
+
+        timerWheel_.cancel(*connection.keepalive);
+        if (connection.readPause) {
+            timerWheel_.cancel(*connection.readPause);
+        }
+
+        DetachedClient entry;
+        entry.client = connection.client;
+        if (connection.readBuffer) {
+            entry.pendingInput.assign(connection.readBuffer->data(), connection.readBuffer->size());
+            bufferPool_.release(std::move(connection.readBuffer));
+            bufferedCount_--;
+            chargeReadBuffer(connection);
+        }
+        detached.push_back(std::move(entry));
+    }
+
+    {
+        std::lock_guard<BrokerMutex> lock(pendingMutex_);
+        for (auto& entry : pending_) {
+            detached.push_back(std::move(entry));
+        }
+        pending_.clear();
+        writeRequests_.clear();
+    }
+
+    for (auto& entry : detached) {
+        entry.client->detachIoLoop();
+    }
+    clientCount_ = 0;
+
+    releaseResources();
+    return detached;
+}
+
+void IoLoop::stopThread() {
+    running_ = false;
+    wake();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void IoLoop::releaseResources() {
+    pollFds_.clear();
+    connections_.clear();
+    readChunk_.clear();
+    readChunk_.shrink_to_fit();
+
+    closesocket(wakeSocket_);
+    wakeSocket_ = INVALID_SOCKET;
+}
+
+void IoLoop::addClient(std::shared_ptr<Client> client, std::string pendingInput) {
+    client->attachIoLoop(this);
+    bool pendingOutput = client->hasPendingOutput();
+
+    {
+        std::lock_guard<BrokerMutex> lock(pendingMutex_);
+        if (pendingOutput) {
+            writeRequests_.push_back(client.get());
+        }
+
+        DetachedClient entry;
+        entry.client = std::move(client);
+        entry.pendingInput = std::move(pendingInput);
+        pending_.push_back(std::move(entry));
+    }
+    clientCount_++;
+    wake();
+}
+
+// Called with the client's send lock held, so the client cannot be closed
+// before the request is queued.
+void IoLoop::requestWrite(Client* client) {
+    {
+        std::lock_guard<BrokerMutex> lock(pendingMutex_);
+        writeRequests_.push_back(client);
+    }
+    wake();
+}
+
+size_t IoLoop::getSlotSize() {
+    return sizeof(pollfd) + sizeof(Connection) + sizeof(ConnectionTimer);
+}
+
+bool IoLoop::createWakeSocket() {
+    wakeSocket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wakeSocket_ == INVALID_SOCKET) {
+        std::cerr << "Wake socket creation failed: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    sockaddr_in wakeAddr = {};
+    wakeAddr.sin_family = AF_INET;
+    wakeAddr.sin_port = 0;
+    inet_pton(AF_INET, "127.0.0.1", &(wakeAddr.sin_addr));
+
+    int wakeAddrSize = sizeof(wakeAddr);
+    if (bind(wakeSocket_, (sockaddr*)&wakeAddr, sizeof(wakeAddr)) == SOCKET_ERROR ||
+        getsockname(wakeSocket_, (sockaddr*)&wakeAddr, (socklen_t*)&wakeAddrSize) == SOCKET_ERROR ||
+        connect(wakeSocket_, (sockaddr*)&wakeAddr, sizeof(wakeAddr)) == SOCKET_ERROR) {
+        std::cerr << "Wake socket setup failed: " << WSAGetLastError() << std::endl;
+        closesocket(wakeSocket_);
+        wakeSocket_ = INVALID_SOCKET;
+        return false;
+    }
+
+    u_long nonBlocking = 1;
+    ioctlsocket(wakeSocket_, FIONBIO, &nonBlocking);
+    return true;
+}
+
+void IoLoop::wake() {
+    char signal = 0;
+    send(wakeSocket_, &signal, 1, 0);
+}
+
+void IoLoop::drainWakeSocket() {
+    char signals[64];
+    while (recv(wakeSocket_, signals, sizeof(signals), 0) > 0) {
+    }
+}
+
+void IoLoop::adoptPending() {
+    std::vector<DetachedClient> adopted;
+    std::vector<Client*> writers;
+    std::vector<Client*> restored;
+    {
+        std::lock_guard<BrokerMutex> lock(pendingMutex_);
+        adopted.swap(pending_);
+        writers.swap(writeRequests_);
+    }
+
+    for (auto& entry : adopted) {
+        auto& client = entry.client;
+
+        pollfd clientFd = {};
+        clientFd.fd = client->getSocket();
+        clientFd.events = POLLRDNORM;
+        pollFds_.push_back(clientFd);
+
+        Connection connection;
+        client->setIoSlot(connections_.size());
+        connection.client = std::move(client);
+        connection.keepalive.reset(new ConnectionTimer());
+        connection.keepalive->slot = connections_.size();
+
+        if (keepaliveOptions_.connectTimeoutMs > 0) {
+            connection.keepalive->awaitingConnect = true;
+            timerWheel_.schedule(*connection.keepalive, std::chrono::milliseconds(keepaliveOptions_.connectTimeoutMs));
+        } else if (keepaliveOptions_.pingIntervalMs > 0) {
+            timerWheel_.schedule(*connection.keepalive, std::chrono::milliseconds(keepaliveOptions_.pingIntervalMs));
+        }
+
+        if (!entry.pendingInput.empty()) {
+            connection.readBuffer = bufferPool_.acquire();
+            connection.readBuffer->assign(entry.pendingInput.data(), entry.pendingInput.size());
+            bufferedCount_++;
+            restored.push_back(connection.client.get());
+        }
+
+        connections_.push_back(std::move(connection));
+    }
+
+    for (Client* client : writers) {
+        pollFds_[client->getIoSlot()].events |= POLLWRNORM;
+    }
+
+    // Input carried over from another process may already hold complete
+    // commands, so it is parsed now rather than on the next read.
+    for (Client* client : restored) {
+        size_t slot = client->getIoSlot();
+        dispatchBuffered(connections_[slot]);
+        applyReadPause(connections_[slot]);
+        if (!client->isConnected()) {
+            closeConnection(slot);
+        }
+    }
+}
+
+void IoLoop::run() {
+    while (running_) {
+        adoptPending();
+
+        int timeout = timerWheel_.getPollTimeout(TimingWheel::Clock::now());
+        int ready = WSAPoll(pollFds_.data(), static_cast<unsigned long>(pollFds_.size()), timeout);
+        if (ready == SOCKET_ERROR) {
+            std::cerr << "WSAPoll failed: " << WSAGetLastError() << std::endl;
+            break;
+        }
+
+        // The wheel may have slept through many ticks; bring it up to date
+        // before handlers arm timers relative to its current tick.
+        timerWheel_.advance(TimingWheel::Clock::now());
+
+        if (pollFds_[0].revents != 0) {
+            drainWakeSocket();
+        }
+
+        for (size_t i = pollFds_.size() - 1; i > 0; i--) {
+            short revents = pollFds_[i].revents;
+            if (revents == 0) {
+                continue;
+            }
+
+            if (revents & POLLWRNORM) {
+                const auto& client = connections_[i].client;
+                if (!client->flushOutbound()) {
+                    closeConnection(i);
+                    continue;
+                }
+                if (!client->hasPendingOutput()) {
+                    pollFds_[i].events &= ~POLLWRNORM;
+                }
+            }
+
+            if ((revents & ~POLLWRNORM) != 0 && !handleReadable(connections_[i])) {
+                closeConnection(i);
+            }
+        }
+    }
+}
+
+bool IoLoop::handleReadable(Connection& connection) {
+    const auto& client = connection.client;
+
+    int bytesReceived = client->receive(readChunk_.data(), readChunk_.size());
+    if (bytesReceived == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+        return true;
+    }
+    if (bytesReceived <= 0) {
+        return false;
+    }
+
+    if (connection.readBuffer) {
+        connection.readBuffer->append(readChunk_.data(), bytesReceived);
+        dispatchBuffered(connection);
+    } else {
+        size_t size = static_cast<size_t>(bytesReceived);
+        size_t consumed = onRead_(client, readChunk_.data(), size);
+        if (consumed < size) {
+            connection.readBuffer = bufferPool_.acquire();
+            reserveExpected(connection);
+            connection.readBuffer->assign(readChunk_.data() + consumed, size - consumed);
+            bufferedCount_++;
+            chargeReadBuffer(connection);
+        }
+    }
+
+    applyReadPause(connection);
+    return client->isConnected();
+}
+
+void IoLoop::dispatchBuffered(Connection& connection) {
+    ReadBuffer& pending = *connection.readBuffer;
+
+    size_t consumed = onRead_(connection.client, pending.data(), pending.size());
+    if (consumed == pending.size()) {
+        bufferPool_.release(std::move(connection.readBuffer));
+        bufferedCount_--;
+    } else {
+        pending.erase(0, consumed);
+        reserveExpected(connection);
+    }
+    chargeReadBuffer(connection);
+}
+
+// A large PUB body is appended into a buffer sized for the whole command
+// once its header is known, instead of regrowing on every read.
+void IoLoop::reserveExpected(Connection& connection) {
+    size_t expected = connection.client->takeExpectedInput();
+    if (expected > connection.readBuffer->capacity()) {
+        connection.readBuffer->reserve(expected);
+    }
+}
+
+// Read buffers are charged by capacity, since that is what they hold on to.
+void IoLoop::chargeReadBuffer(Connection& connection) {
+    size_t capacity = connection.readBuffer ? connection.readBuffer->capacity() : 0;
+    if (capacity != connection.readCharge) {
+        connection.client->charge(MemoryUse::READ_BUFFERS,
+                                  static_cast<int64_t>(capacity) - static_cast<int64_t>(connection.readCharge));
+        connection.readCharge = capacity;
+    }
+}
+
+void IoLoop::applyReadPause(Connection& connection) {
+    int64_t pause = connection.client->takeReadPause();
+    if (pause <= 0) {
+        return;
+    }
+
+    if (!connection.readPause) {
+        connection.readPause.reset(new ConnectionTimer());
+        connection.readPause->resumeRead = true;
+    }
+    connection.readPause->slot = connection.keepalive->slot;
+
+    // Unread input stays in the kernel buffers, which pushes back on the
+    // publisher through TCP flow control.
+    pollFds_[connection.readPause->slot].events &= ~POLLRDNORM;
+    timerWheel_.schedule(*connection.readPause, std::chrono::milliseconds((pause + 999999) / 1000000));
+}
+
+void IoLoop::resumeReading(size_t index) {
+    Connection& connection = connections_[index];
+    pollFds_[index].events |= POLLRDNORM;
+
+    if (connection.readBuffer) {
+        dispatchBuffered(connection);
+        applyReadPause(connection);
+    }
+
+    if (!connection.client->isConnected()) {
+        closeConnection(index);
+    }
+}
+
+void IoLoop::closeConnection(size_t index) {
+    Connection connection = std::move(connections_[index]);
+
+    if (index != connections_.size() - 1) {
+        connections_[index] = std::move(connections_.back());
+        connections_[index].keepalive->slot = index;
+        if (connections_[index].readPause) {
+            connections_[index].readPause->slot = index;
+        }
+        connections_[index].client->setIoSlot(index);
+        pollFds_[index] = pollFds_.back();
+    }
+    connections_.pop_back();
+    pollFds_.pop_back();
+
+    timerWheel_.cancel(*connection.keepalive);
+    if (connection.readPause) {
+        timerWheel_.cancel(*connection.readPause);
+    }
+
+    if (connection.readBuffer) {
+        bufferPool_.release(std::move(connection.readBuffer));
+        bufferedCount_--;
+        chargeReadBuffer(connection);
+    }
+
+    connection.client->disconnect();
+    {
+        std::lock_guard<BrokerMutex> lock(pendingMutex_);
+        writeRequests_.erase(std::remove(writeRequests_.begin(), writeRequests_.end(), connection.client.get()),
+                             writeRequests_.end());
+    }
+    clientCount_--;
+    onClose_(connection.client);
+}
+
+void IoLoop::handleTimer(ConnectionTimer& timer) {
+    if (timer.resumeRead) {
+        resumeReading(timer.slot);
+        return;
+    }
+
+    const auto& client = connections_[timer.slot].client;
+
+    if (timer.awaitingConnect) {
+        if (!client->hasReceivedConnect()) {
+            evictConnection(timer.slot, "Authentication Timeout");
+            return;
+        }
+
+        timer.awaitingConnect = false;
+        if (keepaliveOptions_.pingIntervalMs > 0) {
+            timerWheel_.schedule(timer, std::chrono::milliseconds(keepaliveOptions_.pingIntervalMs));
+        }
+        return;
+    }
+
+    if (client->getPingsOutstanding() >= keepaliveOptions_.maxPingsOutstanding) {
+        evictConnection(timer.slot, "Stale Connection");
+        return;
+    }
+
+    NATSProtocolParser parser;
+    client->sendControl(parser.generatePingMessage());
+    client->recordPingSent();
+
+    timerWheel_.schedule(timer, std::chrono::milliseconds(keepaliveOptions_.pingIntervalMs));
+}
+
+void IoLoop::evictConnection(size_t index, const std::string& reason) {
+    NATSProtocolParser parser;
+    connections_[index].client->sendControl(parser.generateErrMessage(reason));
+
+    evictedCount_++;
+    closeConnection(index);
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,285 @@
+#include "../include/LocalHarness.h"
+#include "../include/Handoff.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+namespace pulse_broker {
+
+namespace {
+
+std::atomic<uint32_t> pairCounter(0);
+
+// Length of the complete MSG frame at the start of data, or 0 if it has not
+// fully arrived yet.
+size_t frameLength(const std::string& data, size_t offset) {
+    size_t lineEnd = data.find("\r\n", offset);
+    if (lineEnd == std::string::npos) {
+        return 0;
+    }
+
+    size_t sizeStart = data.rfind(' ', lineEnd);
+    if (sizeStart == std::string::npos || sizeStart < offset) {
+        return 0;
+    }
+
+    size_t payloadSize = std::strtoul(data.c_str() + sizeStart + 1, nullptr, 10);
+    size_t length = lineEnd + 2 - offset + payloadSize + 2;
+    return data.size() - offset >= length ? length : 0;
+}
+
+} // namespace
+
+LocalHarness::LocalHarness(ServerOptions options) {
+    options.tcpListener = false;
+    options.unixSocketPath.clear();
+    options.handoffPath.clear();
+    options.takeoverPath.clear();
+    server_.reset(new NATSServer(options));
+}
+
+LocalHarness::~LocalHarness() {
+    stop();
+}
+
+bool LocalHarness::start() {
+    return server_->start();
+}
+
+void LocalHarness::stop() {
+    for (size_t i = 0; i < clients_.size(); i++) {
+        close(static_cast<int>(i));
+    }
+    clients_.clear();
+    server_->stop();
+}
+
+bool LocalHarness::socketPair(int sockets[2]) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::snprintf(address.sun_path, sizeof(address.sun_path), "pulse_broker_pair_%u_%u.sock",
+                  Handoff::currentProcessId(), pairCounter++);
+
+    SOCKET listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET) {
+        return false;
+    }
+
+    std::remove(address.sun_path);
+
+    SOCKET first = INVALID_SOCKET;
+    SOCKET second = INVALID_SOCKET;
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != SOCKET_ERROR &&
+        listen(listener, 1) != SOCKET_ERROR) {
+        first = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (first != INVALID_SOCKET && ::connect(first, (sockaddr*)&address, sizeof(address)) != SOCKET_ERROR) {
+            second = accept(listener, nullptr, nullptr);
+        }
+    }
+
+    closesocket(listener);
+    std::remove(address.sun_path);
+
+    if (second == INVALID_SOCKET) {
+        if (first != INVALID_SOCKET) {
+            closesocket(first);
+        }
+        return false;
+    }
+
+    sockets[0] = first;
+    sockets[1] = second;
+    return true;
+}
+
+int LocalHarness::connect() {
+    int sockets[2];
+    if (!socketPair(sockets)) {
+        return -1;
+    }
+
+    if (!server_->attachConnection(sockets[1])) {
+        closesocket(sockets[0]);
+        return -1;
+    }
+
+    int client = static_cast<int>(clients_.size());
+    clients_.push_back(sockets[0]);
+
+    std::string info = receive(client);
+    if (info.compare(0, 5, "INFO ") != 0) {
+        close(client);
+        return -1;
+    }
+    return client;
+}
+
+void LocalHarness::close(int client) {
+    if (clients_[client] != INVALID_SOCKET) {
+        closesocket(clients_[client]);
+        clients_[client] = INVALID_SOCKET;
+    }
+}
+
+bool LocalHarness::send(int client, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int result = ::send(clients_[client], data.data() + sent, static_cast<int>(data.size() - sent), 0);
+        if (result == SOCKET_ERROR) {
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+bool LocalHarness::waitReadable(int socket, int timeoutMs) {
+    WSAPOLLFD descriptor = {};
+    descriptor.fd = socket;
+    descriptor.events = POLLRDNORM;
+    return WSAPoll(&descriptor, 1, timeoutMs) > 0;
+}
+
+std::string LocalHarness::receive(int client, int timeoutMs) {
+    if (!waitReadable(clients_[client], timeoutMs)) {
+        return "";
+    }
+
+    char buffer[65536];
+    int received = recv(clients_[client], buffer, sizeof(buffer), 0);
+    return received > 0 ? std::string(buffer, received) : std::string();
+}
+
+bool LocalHarness::receiveExactly(int client, size_t size, std::string& data, int timeoutMs) {
+    data.clear();
+    while (data.size() < size) {
+        if (!waitReadable(clients_[client], timeoutMs)) {
+            return false;
+        }
+
+        char buffer[65536];
+        size_t wanted = size - data.size() < sizeof(buffer) ? size - data.size() : sizeof(buffer);
+        int received = recv(clients_[client], buffer, static_cast<int>(wanted), 0);
+        if (received <= 0) {
+            return false;
+        }
+        data.append(buffer, received);
+    }
+    return true;
+}
+
+bool LocalHarness::drain(int client, size_t frames, std::string& partial, WorkloadResult& result, int timeoutMs) {
+    size_t offset = 0;
+    while (frames > 0) {
+        size_t length = frameLength(partial, offset);
+        if (length > 0) {
+            offset += length;
+            result.delivered++;
+            result.deliveredBytes += length;
+            frames--;
+            continue;
+        }
+
+        partial.erase(0, offset);
+        offset = 0;
+
+        if (!waitReadable(clients_[client], timeoutMs)) {
+            return false;
+        }
+
+        char buffer[65536];
+        int received = recv(clients_[client], buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return false;
+        }
+        partial.append(buffer, received);
+    }
+
+    partial.erase(0, offset);
+    return true;
+}
+
+WorkloadResult LocalHarness::run(const Workload& workload) {
+    WorkloadResult result;
+    if (workload.subjects == 0) {
+        return result;
+    }
+
+    int publisher = connect();
+    if (publisher < 0 || !send(publisher, "CONNECT {\"verbose\":false}\r\n")) {
+        return result;
+    }
+
+    std::vector<std::string> subjects;
+    for (size_t i = 0; i < workload.subjects; i++) {
+        subjects.push_back("bench." + std::to_string(i));
+    }
+
+    std::vector<int> subscribers;
+    for (size_t i = 0; i < workload.subjects * workload.subscribersPerSubject; i++) {
+        int subscriber = connect();
+        if (subscriber < 0) {
+            return result;
+        }
+
+        send(subscriber, "CONNECT {\"verbose\":false}\r\nSUB " + subjects[i % workload.subjects] + " 1\r\nPING\r\n");
+        if (receive(subscriber, workload.timeoutMs) != "PONG\r\n") {
+            return result;
+        }
+        subscribers.push_back(subscriber);
+    }
+
+    std::string payload(workload.payloadSize, 'x');
+    // mt19937 output is fixed by the standard, unlike the distributions.
+    std::mt19937 random(workload.seed);
+
+    std::vector<std::string> partial(subscribers.size());
+    std::vector<size_t> frames(subscribers.size());
+    size_t batchSize = workload.batchSize > 0 ? workload.batchSize : 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (result.published < workload.messages) {
+        std::string batch;
+        std::fill(frames.begin(), frames.end(), 0);
+
+        for (size_t i = 0; i < batchSize && result.published < workload.messages; i++) {
+            size_t subject = random() % workload.subjects;
+            batch += "PUB " + subjects[subject] + " " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+            for (size_t s = subject; s < subscribers.size(); s += workload.subjects) {
+                frames[s]++;
+            }
+            result.published++;
+            result.expectedDeliveries += workload.subscribersPerSubject;
+        }
+
+        if (!send(publisher, batch)) {
+            return result;
+        }
+
+        for (size_t s = 0; s < subscribers.size(); s++) {
+            if (frames[s] > 0 && !drain(subscribers[s], frames[s], partial[s], result, workload.timeoutMs)) {
+                return result;
+            }
+        }
+    }
+
+    result.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.complete = result.delivered == result.expectedDeliveries;
+
+    close(publisher);
+    for (int subscriber : subscribers) {
+        close(subscriber);
+    }
+    return result;
+}
+
+} // namespace pulse_broker
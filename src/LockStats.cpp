@@ -0,0 +1,246 @@
+#include "../include/LockStats.h"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <sstream>
+
+namespace pulse_broker {
+
+namespace {
+
+void updateMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t percentile(const std::vector<uint64_t>& counts, double p) {
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * static_cast<double>(total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return (uint64_t(1) << (i + 1)) - 1;
+        }
+    }
+    return UINT64_MAX;
+}
+
+void appendHistogram(std::ostringstream& out, const std::vector<uint64_t>& counts) {
+    size_t end = counts.size();
+    while (end > 0 && counts[end - 1] == 0) {
+        end--;
+    }
+
+    out << '[';
+    for (size_t i = 0; i < end; i++) {
+        if (i > 0) {
+            out << ',';
+        }
+        out << counts[i];
+    }
+    out << ']';
+}
+
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<LockStats>> locks;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+} // namespace
+
+LockHistogram::LockHistogram() {
+    reset();
+}
+
+size_t LockHistogram::bucketFor(uint64_t nanoseconds) {
+    size_t bucket = 0;
+    while (nanoseconds > 1 && bucket < BUCKETS - 1) {
+        nanoseconds >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void LockHistogram::record(uint64_t nanoseconds) {
+    counts_[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> LockHistogram::getCounts() const {
+    std::vector<uint64_t> counts(BUCKETS);
+    for (size_t i = 0; i < BUCKETS; i++) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+void LockHistogram::reset() {
+    for (size_t i = 0; i < BUCKETS; i++) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+LockStats::LockStats(const std::string& lockName)
+    : name(lockName), acquisitions(0), contentions(0), waitTotalNs(0), waitMaxNs(0),
+      holdTotalNs(0), holdMaxNs(0) {
+}
+
+void LockStats::recordWait(uint64_t nanoseconds, bool contended) {
+    acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (contended) {
+        contentions.fetch_add(1, std::memory_order_relaxed);
+    }
+    waitTotalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+    updateMax(waitMaxNs, nanoseconds);
+    waitHistogram.record(nanoseconds);
+}
+
+void LockStats::recordHold(uint64_t nanoseconds) {
+    holdTotalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+    updateMax(holdMaxNs, nanoseconds);
+    holdHistogram.record(nanoseconds);
+}
+
+void LockStats::reset() {
+    acquisitions = 0;
+    contentions = 0;
+    waitTotalNs = 0;
+    waitMaxNs = 0;
+    holdTotalNs = 0;
+    holdMaxNs = 0;
+    waitHistogram.reset();
+    holdHistogram.reset();
+}
+
+LockStats& LockRegistry::get(const std::string& name) {
+    Registry& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    auto& stats = instance.locks[name];
+    if (!stats) {
+        stats.reset(new LockStats(name));
+    }
+    return *stats;
+}
+
+std::vector<LockReport> LockRegistry::getReport() {
+    Registry& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    std::vector<LockReport> reports;
+    for (const auto& pair : instance.locks) {
+        const LockStats& stats = *pair.second;
+
+        LockReport report;
+        report.name = stats.name;
+        report.acquisitions = stats.acquisitions.load(std::memory_order_relaxed);
+        report.contentions = stats.contentions.load(std::memory_order_relaxed);
+        report.waitTotalNs = stats.waitTotalNs.load(std::memory_order_relaxed);
+        report.waitMaxNs = stats.waitMaxNs.load(std::memory_order_relaxed);
+        report.holdTotalNs = stats.holdTotalNs.load(std::memory_order_relaxed);
+        report.holdMaxNs = stats.holdMaxNs.load(std::memory_order_relaxed);
+        report.waitHistogram = stats.waitHistogram.getCounts();
+        report.holdHistogram = stats.holdHistogram.getCounts();
+        report.waitP99Ns = percentile(report.waitHistogram, 0.99);
+        report.holdP99Ns = percentile(report.holdHistogram, 0.99);
+        reports.push_back(report);
+    }
+    return reports;
+}
+
+void LockRegistry::reset() {
+    Registry& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    for (auto& pair : instance.locks) {
+        pair.second->reset();
+    }
+}
+
+bool LockRegistry::isEnabled() {
+#ifdef PULSE_BROKER_LOCK_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string LockRegistry::toJson() {
+    std::ostringstream out;
+    out << "{\"enabled\":" << (isEnabled() ? "true" : "false") << ",\"locks\":[";
+
+    auto reports = getReport();
+    for (size_t i = 0; i < reports.size(); i++) {
+        const LockReport& report = reports[i];
+        if (i > 0) {
+            out << ',';
+        }
+        out << "{\"name\":\"" << report.name << "\""
+            << ",\"acquisitions\":" << report.acquisitions
+            << ",\"contended\":" << report.contentions
+            << ",\"wait_ns_total\":" << report.waitTotalNs
+            << ",\"wait_ns_max\":" << report.waitMaxNs
+            << ",\"wait_ns_p99\":" << report.waitP99Ns
+            << ",\"hold_ns_total\":" << report.holdTotalNs
+            << ",\"hold_ns_max\":" << report.holdMaxNs
+            << ",\"hold_ns_p99\":" << report.holdP99Ns
+            << ",\"wait_hist_log2_ns\":";
+        appendHistogram(out, report.waitHistogram);
+        out << ",\"hold_hist_log2_ns\":";
+        appendHistogram(out, report.holdHistogram);
+        out << '}';
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+InstrumentedMutex::InstrumentedMutex(const char* name)
+    : stats_(LockRegistry::get(name)) {
+}
+
+void InstrumentedMutex::lock() {
+    if (mutex_.try_lock()) {
+        acquiredAt_ = Clock::now();
+        stats_.recordWait(0, false);
+        return;
+    }
+
+    Clock::time_point start = Clock::now();
+    mutex_.lock();
+    acquiredAt_ = Clock::now();
+
+    auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(acquiredAt_ - start).count();
+    stats_.recordWait(static_cast<uint64_t>(waited), true);
+}
+
+bool InstrumentedMutex::try_lock() {
+    if (!mutex_.try_lock()) {
+        return false;
+    }
+
+    acquiredAt_ = Clock::now();
+    stats_.recordWait(0, false);
+    return true;
+}
+
+void InstrumentedMutex::unlock() {
+    auto held = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - acquiredAt_).count();
+    mutex_.unlock();
+    stats_.recordHold(static_cast<uint64_t>(held));
+}
+
+} // namespace pulse_broker
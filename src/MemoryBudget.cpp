@@ -0,0 +1,96 @@
+#include "../include/MemoryBudget.h"
+#include <sstream>
+
+namespace pulse_broker {
+
+namespace {
+const size_t USE_COUNT = static_cast<size_t>(MemoryUse::COUNT);
+
+size_t clamp(int64_t bytes) {
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
+}
+
+MemoryBudget::MemoryBudget(size_t limit)
+    : limit_(limit), used_(0), refusedConnections_(0), throttledReads_(0), slowConsumers_(0) {
+    for (auto& usage : usage_) {
+        usage = 0;
+    }
+}
+
+void MemoryBudget::charge(MemoryUse use, int64_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    usage_[static_cast<size_t>(use)].fetch_add(bytes, std::memory_order_relaxed);
+    used_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::getUsed() const {
+    return clamp(used_.load(std::memory_order_relaxed));
+}
+
+size_t MemoryBudget::getUsed(MemoryUse use) const {
+    return clamp(usage_[static_cast<size_t>(use)].load(std::memory_order_relaxed));
+}
+
+void MemoryBudget::reset() {
+    for (auto& usage : usage_) {
+        usage = 0;
+    }
+    used_ = 0;
+}
+
+MemoryBudgetReport MemoryBudget::getReport() const {
+    MemoryBudgetReport report;
+    report.limit = limit_;
+    report.used = getUsed();
+    for (size_t i = 0; i < USE_COUNT; i++) {
+        report.usage[i] = getUsed(static_cast<MemoryUse>(i));
+    }
+    report.refusedConnections = refusedConnections_;
+    report.throttledReads = throttledReads_;
+    report.slowConsumers = slowConsumers_;
+    return report;
+}
+
+const char* MemoryBudget::getName(MemoryUse use) {
+    switch (use) {
+        case MemoryUse::CONNECTIONS: return "connections";
+        case MemoryUse::READ_BUFFERS: return "read_buffers";
+        case MemoryUse::OUTBOUND: return "outbound";
+        case MemoryUse::SUBSCRIPTIONS: return "subscriptions";
+        case MemoryUse::HISTORY: return "history";
+        case MemoryUse::WORK_QUEUES: return "work_queues";
+        default: return "unknown";
+    }
+}
+
+std::string MemoryBudget::toJson(const MemoryBudgetReport& report) {
+    std::ostringstream out;
+    out << "{\"limit\":" << report.limit << ",\"used\":" << report.used << ",\"usage\":{";
+
+    for (size_t i = 0; i < USE_COUNT; i++) {
+        if (i > 0) {
+            out << ',';
+        }
+        out << '"' << getName(static_cast<MemoryUse>(i)) << "\":" << report.usage[i];
+    }
+
+    out << "},\"refused_connections\":" << report.refusedConnections
+        << ",\"throttled_reads\":" << report.throttledReads
+        << ",\"slow_consumers\":" << report.slowConsumers << ",\"connections\":[";
+
+    for (size_t i = 0; i < report.connections.size(); i++) {
+        if (i > 0) {
+            out << ',';
+        }
+        out << "{\"cid\":" << report.connections[i].clientId << ",\"ip\":\"" << report.connections[i].ip
+            << "\",\"bytes\":" << report.connections[i].bytes << '}';
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,100 @@
+#include "../include/MessageHistory.h"
+
+namespace pulse_broker {
+
+MessageHistory::MessageHistory(SubjectTable& subjects, const std::vector<SubjectHistoryLimit>& limits)
+    : subjects_(subjects), messages_(0), bytes_(0) {
+    for (const auto& limit : limits) {
+        if (limit.depth > 0) {
+            limits_.push_back(limit);
+        }
+    }
+}
+
+MessageHistory::~MessageHistory() {
+    clear();
+}
+
+size_t MessageHistory::depthFor(const std::string& subject) const {
+    for (const auto& limit : limits_) {
+        if (subject.compare(0, limit.prefix.size(), limit.prefix) == 0) {
+            return limit.depth;
+        }
+    }
+    return 0;
+}
+
+size_t MessageHistory::footprint(const RetainedMessage& message) {
+    return sizeof(RetainedMessage) + message.replyTo.size() + sizeof(std::string) + message.payload->size();
+}
+
+void MessageHistory::record(const std::string& subject, const std::string& replyTo, const char* payload,
+                            size_t payloadSize) {
+    size_t depth = depthFor(subject);
+    if (depth == 0) {
+        return;
+    }
+
+    // The ring holds one reference to its subject for as long as it exists.
+    SubjectId subjectId = subjects_.find(subject);
+    auto it = subjectId != SubjectTable::INVALID_ID ? rings_.find(subjectId) : rings_.end();
+    if (it == rings_.end()) {
+        subjectId = subjects_.intern(subject);
+        it = rings_.emplace(subjectId, std::deque<RetainedMessage>()).first;
+    }
+
+    auto& ring = it->second;
+    if (ring.size() == depth) {
+        bytes_ -= footprint(ring.front());
+        ring.pop_front();
+        messages_--;
+    }
+
+    ring.push_back(RetainedMessage{replyTo, std::make_shared<const std::string>(payload, payloadSize)});
+    bytes_ += footprint(ring.back());
+    messages_++;
+}
+
+const std::deque<RetainedMessage>* MessageHistory::find(const std::string& subject) const {
+    if (rings_.empty()) {
+        return nullptr;
+    }
+
+    SubjectId subjectId = subjects_.find(subject);
+    if (subjectId == SubjectTable::INVALID_ID) {
+        return nullptr;
+    }
+
+    auto it = rings_.find(subjectId);
+    return it != rings_.end() ? &it->second : nullptr;
+}
+
+void MessageHistory::clear() {
+    for (const auto& pair : rings_) {
+        subjects_.release(pair.first);
+    }
+
+    rings_.clear();
+    messages_ = 0;
+    bytes_ = 0;
+}
+
+void MessageHistory::save(MessageHistoryState& state) const {
+    for (const auto& pair : rings_) {
+        const std::string& subject = subjects_.getSubject(pair.first);
+        for (const auto& message : pair.second) {
+            state.messages.push_back(MessageHistoryState::Message{subject, message});
+        }
+    }
+}
+
+void MessageHistory::restore(const MessageHistoryState& state) {
+    for (const auto& entry : state.messages) {
+        if (entry.message.payload) {
+            const std::string& payload = *entry.message.payload;
+            record(entry.subject, entry.message.replyTo, payload.data(), payload.size());
+        }
+    }
+}
+
+} // namespace pulse_broker
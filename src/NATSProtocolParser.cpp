@@ -1,140 +1,340 @@
 #include "../include/NATSProtocolParser.h"
+#include "../include/ByteScan.h"
+#include "../include/AllocStats.h"
 #include <sstream>
 #include <algorithm>
+#include <cstring>
 
 namespace pulse_broker {
 
-std::vector<std::string> NATSProtocolParser::tokenize(const std::string& line) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(line);
-    std::string token;
+namespace {
 
-    while (iss >> token) {
-        tokens.push_back(token);
+const char* skipWhitespace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        p++;
     }
+    return p;
+}
+
+const char* skipString(const char* p, const char* end) {
+    p++;
+    while (p < end && *p != '"') {
+        if (*p == '\\') {
+            p++;
+        }
+        p++;
+    }
+    return p < end ? p + 1 : nullptr;
+}
+
+const char* skipValue(const char* p, const char* end) {
+    if (p >= end) {
+        return nullptr;
+    }
+
+    if (*p == '"') {
+        return skipString(p, end);
+    }
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = skipString(p, end);
+                if (!p) {
+                    return nullptr;
+                }
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            } else if (*p == '}' || *p == ']') {
+                if (--depth == 0) {
+                    return p + 1;
+                }
+            }
+            p++;
+        }
+        return nullptr;
+    }
+
+    while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t') {
+        p++;
+    }
+    return p;
+}
+
+bool keyEquals(const char* key, size_t keySize, const char* literal) {
+    size_t literalSize = std::strlen(literal);
+    return keySize == literalSize && std::memcmp(key, literal, keySize) == 0;
+}
 
-    return tokens;
+bool scanBool(const char* p, const char* end, bool& value) {
+    if (end - p >= 4 && std::memcmp(p, "true", 4) == 0) {
+        value = true;
+        return true;
+    }
+    if (end - p >= 5 && std::memcmp(p, "false", 5) == 0) {
+        value = false;
+        return true;
+    }
+    return false;
 }
 
+// Takes the raw characters between the quotes; escapes are not decoded.
+bool scanString(const char* p, const char* end, std::string& value) {
+    if (p >= end || *p != '"') {
+        return false;
+    }
+
+    const char* close = skipString(p, end);
+    if (!close) {
+        return false;
+    }
+    value.assign(p + 1, close - 1);
+    return true;
+}
+
+bool scanConnectOptions(const char* p, const char* end, ConnectOptions& options) {
+    p = skipWhitespace(p, end);
+    if (p >= end || *p != '{') {
+        return false;
+    }
+    p++;
+
+    while (true) {
+        p = skipWhitespace(p, end);
+        if (p >= end) {
+            return false;
+        }
+        if (*p == '}') {
+            return true;
+        }
+        if (*p != '"') {
+            return false;
+        }
+
+        const char* key = p + 1;
+        p = skipString(p, end);
+        if (!p) {
+            return false;
+        }
+        size_t keySize = static_cast<size_t>(p - 1 - key);
+
+        p = skipWhitespace(p, end);
+        if (p >= end || *p != ':') {
+            return false;
+        }
+        p = skipWhitespace(p + 1, end);
+
+        if (keyEquals(key, keySize, "verbose")) {
+            scanBool(p, end, options.verbose);
+        } else if (keyEquals(key, keySize, "pedantic")) {
+            scanBool(p, end, options.pedantic);
+        } else if (keyEquals(key, keySize, "echo")) {
+            scanBool(p, end, options.echo);
+        } else if (keyEquals(key, keySize, "binary")) {
+            scanBool(p, end, options.binary);
+        } else if (keyEquals(key, keySize, "user")) {
+            scanString(p, end, options.user);
+        }
+
+        p = skipValue(p, end);
+        if (!p) {
+            return false;
+        }
+
+        p = skipWhitespace(p, end);
+        if (p < end && *p == ',') {
+            p++;
+        }
+    }
+}
+
+} // namespace
+
 bool NATSProtocolParser::parse(const std::string& buffer, Command& command) {
-    command.type = CommandType::UNKNOWN;
-    
-    size_t headerEnd = buffer.find("\r\n");
-    if (headerEnd == std::string::npos) {
+    size_t consumed;
+    return parse(buffer.data(), buffer.size(), command, consumed);
+}
+
+bool NATSProtocolParser::parse(const char* data, size_t size, Command& command, size_t& consumed) {
+    AllocScope scope(AllocTag::PARSER);
+    resetCommand(command);
+    consumed = 0;
+
+    HeaderScan scan;
+    if (!scanHeader(data, size, scan)) {
         return false;
     }
-    
-    std::string header = buffer.substr(0, headerEnd);
-    std::vector<std::string> tokens = tokenize(header);
-    
-    if (tokens.empty()) {
+
+    size_t lineSize = scan.lineEnd + 2;
+
+    if (scan.fieldCount == 0) {
+        consumed = lineSize;
         return false;
     }
-    
-    std::string cmdStr = tokens[0];
-    
-    if (cmdStr == "CONNECT") {
-        return parseConnect(tokens, command);
-    } else if (cmdStr == "PING") {
-        return parsePing(tokens, command);
-    } else if (cmdStr == "PONG") {
-        return parsePong(tokens, command);
-    } else if (cmdStr == "SUB") {
-        return parseSub(tokens, command);
-    } else if (cmdStr == "PUB") {
-        return parsePub(tokens, buffer, headerEnd, command);
-    } else if (cmdStr == "UNSUB") {
-        return parseUnsub(tokens, command);
+
+    const FieldSpan& op = scan.fields[0];
+
+    if (fieldEquals(data, op, "PUB")) {
+        return parsePub(data, size, scan, command, consumed);
+    }
+
+    consumed = lineSize;
+
+    if (fieldEquals(data, op, "CONNECT")) {
+        return parseConnect(data, scan, command);
+    } else if (fieldEquals(data, op, "PING")) {
+        return parsePing(data, scan, command);
+    } else if (fieldEquals(data, op, "PONG")) {
+        return parsePong(data, scan, command);
+    } else if (fieldEquals(data, op, "SUB")) {
+        return parseSub(data, scan, command);
+    } else if (fieldEquals(data, op, "UNSUB")) {
+        return parseUnsub(data, scan, command);
     }
     
     return false;
 }
 
-bool NATSProtocolParser::parseConnect(const std::vector<std::string>& tokens, Command& command) {
-    if (tokens.size() < 2) {
+void NATSProtocolParser::resetCommand(Command& command) {
+    command.type = CommandType::UNKNOWN;
+    command.subject.clear();
+    command.sid.clear();
+    command.replyTo.clear();
+    command.payload.clear();
+    command.payloadData = nullptr;
+    command.payloadSize = 0;
+    command.connectOptions = ConnectOptions();
+    if (!command.options.empty()) {
+        command.options.clear();
+    }
+}
+
+bool NATSProtocolParser::fieldEquals(const char* data, const FieldSpan& field, const char* literal) {
+    size_t literalSize = std::strlen(literal);
+    return field.size == literalSize && std::memcmp(data + field.offset, literal, literalSize) == 0;
+}
+
+bool NATSProtocolParser::parseSize(const char* data, const FieldSpan& field, size_t& value) {
+    if (field.size == 0 || field.size > 18) {
         return false;
     }
-    
+
+    value = 0;
+    for (size_t i = 0; i < field.size; i++) {
+        char c = data[field.offset + i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<size_t>(c - '0');
+    }
+
+    return true;
+}
+
+bool NATSProtocolParser::parseConnect(const char* data, const HeaderScan& scan, Command& command) {
+    if (scan.fieldCount < 2) {
+        return false;
+    }
+
+    ConnectOptions options;
+    if (!scanConnectOptions(data + scan.fields[1].offset, data + scan.lineEnd, options)) {
+        return false;
+    }
+
     command.type = CommandType::CONNECT;
-    command.options["connect"] = "{}";
-    
+    command.connectOptions = options;
+
     return true;
 }
 
-bool NATSProtocolParser::parsePing(const std::vector<std::string>& tokens, Command& command) {
+bool NATSProtocolParser::parsePing(const char* data, const HeaderScan& scan, Command& command) {
     command.type = CommandType::PING;
     return true;
 }
 
-bool NATSProtocolParser::parsePong(const std::vector<std::string>& tokens, Command& command) {
+bool NATSProtocolParser::parsePong(const char* data, const HeaderScan& scan, Command& command) {
     command.type = CommandType::PONG;
     return true;
 }
 
-bool NATSProtocolParser::parseSub(const std::vector<std::string>& tokens, Command& command) {
-    if (tokens.size() < 3) {
+bool NATSProtocolParser::parseSub(const char* data, const HeaderScan& scan, Command& command) {
+    if (scan.fieldCount < 3) {
         return false;
     }
     
     command.type = CommandType::SUB;
-    command.subject = tokens[1];
+    command.subject.assign(data + scan.fields[1].offset, scan.fields[1].size);
     
-    if (tokens.size() > 3) {
-        command.options["queue_group"] = tokens[2];
-        command.sid = tokens[3];
+    if (scan.fieldCount > 3) {
+        command.options["queue_group"].assign(data + scan.fields[2].offset, scan.fields[2].size);
+        command.sid.assign(data + scan.fields[3].offset, scan.fields[3].size);
     } else {
-        command.sid = tokens[2];
+        command.sid.assign(data + scan.fields[2].offset, scan.fields[2].size);
     }
     
     return true;
 }
 
-bool NATSProtocolParser::parsePub(const std::vector<std::string>& tokens, const std::string& buffer, size_t headerEnd, Command& command) {
-    if (tokens.size() < 3) {
+bool NATSProtocolParser::parsePub(const char* data, size_t size, const HeaderScan& scan, Command& command, size_t& consumed) {
+    size_t lineSize = scan.lineEnd + 2;
+
+    if (scan.fieldCount < 3) {
+        consumed = lineSize;
         return false;
     }
     
-    command.type = CommandType::PUB;
-    command.subject = tokens[1];
-    
     size_t payloadSize;
+    const FieldSpan& sizeField = scan.fields[scan.fieldCount > 3 ? 3 : 2];
     
-    if (tokens.size() > 3) {
-        command.replyTo = tokens[2];
-        try {
-            payloadSize = std::stoi(tokens[3]);
-        } catch (const std::exception&) {
-            return false;
-        }
-    } else {
-        try {
-            payloadSize = std::stoi(tokens[2]);
-        } catch (const std::exception&) {
-            return false;
-        }
+    if (!parseSize(data, sizeField, payloadSize)) {
+        consumed = lineSize;
+        return false;
     }
     
-    command.payloadSize = payloadSize;
-    
-    if (buffer.size() < headerEnd + 2 + payloadSize + 2) {
+    if (payloadSize > maxPayload_) {
+        command.type = CommandType::PUB;
+        command.subject.assign(data + scan.fields[1].offset, scan.fields[1].size);
+        command.payloadSize = payloadSize;
+        consumed = lineSize;
+        return true;
+    }
+
+    if (size < lineSize + payloadSize + 2) {
+        command.payloadData = data + lineSize;
+        command.payloadSize = payloadSize;
         return false;
     }
     
-    command.payload = buffer.substr(headerEnd + 2, payloadSize);
+    command.type = CommandType::PUB;
+    command.subject.assign(data + scan.fields[1].offset, scan.fields[1].size);
+    
+    if (scan.fieldCount > 3) {
+        command.replyTo.assign(data + scan.fields[2].offset, scan.fields[2].size);
+    }
+    
+    command.payloadData = data + lineSize;
+    command.payloadSize = payloadSize;
+    if (copyPayload_) {
+        command.payload.assign(data + lineSize, payloadSize);
+    }
+    consumed = lineSize + payloadSize + 2;
     
     return true;
 }
 
-bool NATSProtocolParser::parseUnsub(const std::vector<std::string>& tokens, Command& command) {
-    if (tokens.size() < 2) {
+bool NATSProtocolParser::parseUnsub(const char* data, const HeaderScan& scan, Command& command) {
+    if (scan.fieldCount < 2) {
         return false;
     }
     
     command.type = CommandType::UNSUB;
-    command.sid = tokens[1];
+    command.sid.assign(data + scan.fields[1].offset, scan.fields[1].size);
     
-    if (tokens.size() > 2) {
-        command.options["max_msgs"] = tokens[2];
+    if (scan.fieldCount > 2) {
+        command.options["max_msgs"].assign(data + scan.fields[2].offset, scan.fields[2].size);
     }
     
     return true;
@@ -155,9 +355,12 @@ std::string NATSProtocolParser::generateMessage(const Command& command) {
     }
 }
 
-std::string NATSProtocolParser::generateInfoMessage(const std::string& host, int port, const std::string& clientIP) {
+std::string NATSProtocolParser::generateInfoMessage(const std::string& host, int port, const std::string& clientIP,
+                                                    size_t maxPayload, bool tlsRequired) {
     std::ostringstream oss;
-    oss << "INFO {\"host\":\"" << host << "\",\"port\":" << port << ",\"client_ip\":\"" << clientIP << "\"}\r\n";
+    oss << "INFO {\"host\":\"" << host << "\",\"port\":" << port << ",\"client_ip\":\"" << clientIP
+        << "\",\"max_payload\":" << maxPayload << (tlsRequired ? ",\"tls_required\":true" : "")
+        << ",\"binary\":true}\r\n";
     return oss.str();
 }
 
@@ -165,6 +368,14 @@ std::string NATSProtocolParser::generateOkMessage() {
     return "+OK\r\n";
 }
 
+std::string NATSProtocolParser::generateErrMessage(const std::string& error) {
+    return "-ERR '" + error + "'\r\n";
+}
+
+std::string NATSProtocolParser::generatePingMessage() {
+    return "PING\r\n";
+}
+
 std::string NATSProtocolParser::generatePongMessage() {
     return "PONG\r\n";
 }
@@ -182,4 +393,60 @@ std::string NATSProtocolParser::generateMsgMessage(const std::string& subject, c
     return oss.str();
 }
 
+std::string NATSProtocolParser::generateMsgHeader(const std::string& subject, const std::string& sid,
+                                                  const std::string& replyTo, size_t payloadSize) {
+    std::string header;
+    header.reserve(subject.size() + sid.size() + replyTo.size() + 32);
+    header += "MSG ";
+    header += subject;
+    header += ' ';
+    header += sid;
+    if (!replyTo.empty()) {
+        header += ' ';
+        header += replyTo;
+    }
+    header += ' ';
+    header += std::to_string(payloadSize);
+    header += "\r\n";
+    return header;
+}
+
+bool NATSProtocolParser::isValidSubject(const std::string& subject, bool allowWildcards) {
+    if (subject.empty()) {
+        return false;
+    }
+
+    size_t tokenStart = 0;
+    for (size_t i = 0; i <= subject.size(); i++) {
+        if (i < subject.size() && subject[i] != '.') {
+            char c = subject[i];
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                return false;
+            }
+            continue;
+        }
+
+        size_t tokenSize = i - tokenStart;
+        if (tokenSize == 0) {
+            return false;
+        }
+
+        for (size_t j = tokenStart; j < i; j++) {
+            char c = subject[j];
+            if (c == '*' || c == '>') {
+                if (!allowWildcards || tokenSize != 1) {
+                    return false;
+                }
+                if (c == '>' && i != subject.size()) {
+                    return false;
+                }
+            }
+        }
+
+        tokenStart = i + 1;
+    }
+
+    return true;
+}
+
 } // namespace pulse_broker 
\ No newline at end of file
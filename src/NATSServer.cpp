@@ -1,17 +1,82 @@
 #include "../include/NATSServer.h"
 #include "../include/Client.h"
 #include "../include/Subscription.h"
+#include "../include/Probes.h"
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <afunix.h>
 #include <iostream>
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #pragma comment(lib, "Ws2_32.lib")
 
 namespace pulse_broker {
 
-NATSServer::NATSServer(const std::string& host, int port)
-    : host_(host), port_(port), serverSocket_(INVALID_SOCKET), running_(false) {
+namespace {
+const char* const STATS_TRAFFIC_SUBJECT = "$SYS.REQ.STATS.TRAFFIC";
+const char* const STATS_LOCKS_SUBJECT = "$SYS.REQ.STATS.LOCKS";
+const char* const STATS_RATES_SUBJECT = "$SYS.REQ.STATS.RATES";
+const char* const STATS_MEMORY_SUBJECT = "$SYS.REQ.STATS.MEMORY";
+const char* const STATS_ALLOCS_SUBJECT = "$SYS.REQ.STATS.ALLOCS";
+
+// The stats reports are broker-wide, so only the global account may ask.
+const std::string SYSTEM_REQUEST_PREFIX = "$SYS.REQ.";
+
+// PUB $WQ.FETCH.<subject> <inbox> with a FetchRequest as the payload, and
+// PUB $WQ.ACK.<sequence>.<deliveries> with an empty payload or -NAK.
+const std::string WORK_QUEUE_PREFIX = "$WQ.";
+const std::string WORK_QUEUE_FETCH_PREFIX = "$WQ.FETCH.";
+const std::string WORK_QUEUE_ACK_PREFIX = "$WQ.ACK.";
+
+// A store record, its slot and the client's sid index entry.
+const int64_t SUBSCRIPTION_COST = 128;
+
+// How long a connection stops being read while the budget is exceeded.
+const int64_t BUDGET_READ_PAUSE_NS = 20000000;
+}
+
+NATSServer::NATSServer(const std::string& host, int port, const std::string& unixSocketPath)
+    : host_(host), port_(port), serverSocket_(INVALID_SOCKET),
+      unixSocketPath_(unixSocketPath), tcpListener_(true), maxPayload_(NATSProtocolParser::DEFAULT_MAX_PAYLOAD), ioThreads_(0), trafficStats_(new TrafficStats()),
+      fanoutThreshold_(ServerOptions().fanoutThreshold), fanoutThreads_(0), handoffSocket_(INVALID_SOCKET), unixSocket_(INVALID_SOCKET), running_(false), nextIoLoop_(0) {
+    parser_.setPayloadCopy(false);
+    accounts_.reset(new Accounts(subjects_, {}, {}, {}));
+}
+
+NATSServer::NATSServer(const ServerOptions& options)
+    : host_(options.host), port_(options.port), serverSocket_(INVALID_SOCKET),
+      unixSocketPath_(options.unixSocketPath), tcpListener_(options.tcpListener), maxPayload_(options.maxPayload),
+      ioThreads_(options.ioThreads),
+      fanoutThreshold_(options.fanoutThreshold), fanoutThreads_(options.fanoutThreads),
+      memoryBudget_(options.memoryBudget), handoffPath_(options.handoffPath), takeoverPath_(options.takeoverPath), tls_(options.tls),
+      handoffSocket_(INVALID_SOCKET),
+      unixSocket_(INVALID_SOCKET),
+      running_(false), nextIoLoop_(0) {
+    parser_.setMaxPayload(maxPayload_);
+    parser_.setPayloadCopy(false);
+
+    keepalive_.pingIntervalMs = options.pingIntervalMs;
+    keepalive_.maxPingsOutstanding = options.maxPingsOutstanding;
+    keepalive_.connectTimeoutMs = options.connectTimeoutMs;
+
+    if (options.trafficStats) {
+        trafficStats_.reset(new TrafficStats(std::chrono::milliseconds(options.trafficWindowMs), options.trafficTopK));
+    }
+
+    rateLimiter_.reset(new RateLimiter(options.clientRateLimit, options.subjectRateLimits, options.rateLimitAction));
+    if (!rateLimiter_->isEnabled()) {
+        rateLimiter_.reset();
+    }
+
+    subjectMapper_.reset(new SubjectMapper(options.subjectMappings));
+    if (!subjectMapper_->isEnabled()) {
+        subjectMapper_.reset();
+    }
+
+    accounts_.reset(new Accounts(subjects_, options.accounts, options.subjectHistory, options.workQueues));
 }
 
 NATSServer::~NATSServer() {
@@ -30,10 +95,115 @@ bool NATSServer::start() {
         return false;
     }
 
+    HandoffState handoff;
+    if (!takeoverPath_.empty()) {
+        if (!takeOver(handoff)) {
+            WSACleanup();
+            return false;
+        }
+    } else {
+        if (tcpListener_ && !startTcpListener()) {
+            WSACleanup();
+            return false;
+        }
+
+        if (!unixSocketPath_.empty() && !startUnixListener()) {
+            if (serverSocket_ != INVALID_SOCKET) {
+                closesocket(serverSocket_);
+                serverSocket_ = INVALID_SOCKET;
+            }
+            WSACleanup();
+            return false;
+        }
+    }
+
+    int loopCount = ioThreads_ > 0 ? ioThreads_ : static_cast<int>(std::thread::hardware_concurrency());
+    if (loopCount <= 0) {
+        loopCount = 1;
+    }
+
+    for (int i = 0; i < loopCount; i++) {
+        std::unique_ptr<IoLoop> loop(new IoLoop(
+            [this](const std::shared_ptr<Client>& client, const char* data, size_t size) {
+                return handleClientData(client, data, size);
+            },
+            [this](const std::shared_ptr<Client>& client) {
+                handleClientClosed(client);
+            },
+            keepalive_));
+
+        if (!loop->start()) {
+            ioLoops_.clear();
+            if (serverSocket_ != INVALID_SOCKET) {
+                closesocket(serverSocket_);
+                serverSocket_ = INVALID_SOCKET;
+            }
+            if (unixSocket_ != INVALID_SOCKET) {
+                closesocket(unixSocket_);
+                unixSocket_ = INVALID_SOCKET;
+                std::remove(unixSocketPath_.c_str());
+            }
+            for (const auto& client : handoff.clients) {
+                if (client.socket != INVALID_SOCKET) {
+                    closesocket(client.socket);
+                }
+            }
+            WSACleanup();
+            return false;
+        }
+
+        ioLoops_.push_back(std::move(loop));
+    }
+
+    // The publishing thread takes one share itself, so the default leaves
+    // one core for it.
+    int fanoutWorkers = fanoutThreads_ > 0 ? fanoutThreads_ : static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    if (fanoutThreshold_ > 0 && fanoutWorkers > 0) {
+        std::lock_guard<BrokerMutex> lock(fanoutMutex_);
+        fanoutPool_.reset(new FanoutPool(fanoutWorkers));
+    }
+
+    running_ = true;
+
+    restoreAccounts(handoff);
+    restoreClients(handoff);
+
+    if (serverSocket_ != INVALID_SOCKET) {
+        acceptThread_ = std::thread(&NATSServer::acceptConnections, this);
+    }
+
+    if (unixSocket_ != INVALID_SOCKET) {
+        unixAcceptThread_ = std::thread(&NATSServer::acceptUnixConnections, this);
+    }
+
+    for (auto& ring : sharedMemoryRings_) {
+        ringThreads_.emplace_back(&NATSServer::drainSharedMemoryRing, this, ring.get());
+    }
+
+    if (accounts_->getGlobal().getWorkQueues()) {
+        workQueueThread_ = std::thread(&NATSServer::runWorkQueueTimers, this);
+    }
+
+    if (serverSocket_ != INVALID_SOCKET) {
+        std::cout << "NATS server started on " << host_ << ":" << port_ << (tls_ ? " (TLS)" : "") << std::endl;
+    } else {
+        std::cout << "NATS server started without a TCP listener" << std::endl;
+    }
+    if (unixSocket_ != INVALID_SOCKET) {
+        std::cout << "NATS server listening on unix socket " << unixSocketPath_ << std::endl;
+    }
+
+    if (!handoffPath_.empty() && startHandoffListener()) {
+        handoffThread_ = std::thread(&NATSServer::serveHandoff, this);
+        std::cout << "NATS server accepting hot restart on " << handoffPath_ << std::endl;
+    }
+    return true;
+}
+
+bool NATSServer::startTcpListener() {
     serverSocket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (serverSocket_ == INVALID_SOCKET) {
         std::cerr << "Socket creation failed: " << WSAGetLastError() << std::endl;
-        WSACleanup();
         return false;
     }
 
@@ -47,11 +217,11 @@ bool NATSServer::start() {
         inet_pton(AF_INET, host_.c_str(), &(serverAddr.sin_addr));
     }
 
-    result = bind(serverSocket_, (sockaddr*)&serverAddr, sizeof(serverAddr));
+    int result = bind(serverSocket_, (sockaddr*)&serverAddr, sizeof(serverAddr));
     if (result == SOCKET_ERROR) {
         std::cerr << "Bind failed: " << WSAGetLastError() << std::endl;
         closesocket(serverSocket_);
-        WSACleanup();
+        serverSocket_ = INVALID_SOCKET;
         return false;
     }
 
@@ -59,57 +229,452 @@ bool NATSServer::start() {
     if (result == SOCKET_ERROR) {
         std::cerr << "Listen failed: " << WSAGetLastError() << std::endl;
         closesocket(serverSocket_);
-        WSACleanup();
+        serverSocket_ = INVALID_SOCKET;
         return false;
     }
 
-    running_ = true;
+    return true;
+}
+
+bool NATSServer::startUnixListener() {
+    sockaddr_un unixAddr = {};
+    if (unixSocketPath_.size() >= sizeof(unixAddr.sun_path)) {
+        std::cerr << "Unix socket path too long: " << unixSocketPath_ << std::endl;
+        return false;
+    }
+
+    unixSocket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (unixSocket_ == INVALID_SOCKET) {
+        std::cerr << "Unix socket creation failed: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    unixAddr.sun_family = AF_UNIX;
+    unixSocketPath_.copy(unixAddr.sun_path, unixSocketPath_.size());
+
+    std::remove(unixSocketPath_.c_str());
+
+    int result = bind(unixSocket_, (sockaddr*)&unixAddr, sizeof(unixAddr));
+    if (result == SOCKET_ERROR) {
+        std::cerr << "Unix socket bind failed: " << WSAGetLastError() << std::endl;
+        closesocket(unixSocket_);
+        unixSocket_ = INVALID_SOCKET;
+        return false;
+    }
+
+    result = listen(unixSocket_, SOMAXCONN);
+    if (result == SOCKET_ERROR) {
+        std::cerr << "Unix socket listen failed: " << WSAGetLastError() << std::endl;
+        closesocket(unixSocket_);
+        unixSocket_ = INVALID_SOCKET;
+        std::remove(unixSocketPath_.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool NATSServer::startHandoffListener() {
+    sockaddr_un handoffAddr = {};
+    if (handoffPath_.size() >= sizeof(handoffAddr.sun_path)) {
+        std::cerr << "Handoff socket path too long: " << handoffPath_ << std::endl;
+        return false;
+    }
+
+    handoffSocket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (handoffSocket_ == INVALID_SOCKET) {
+        std::cerr << "Handoff socket creation failed: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    handoffAddr.sun_family = AF_UNIX;
+    handoffPath_.copy(handoffAddr.sun_path, handoffPath_.size());
+
+    std::remove(handoffPath_.c_str());
+
+    if (bind(handoffSocket_, (sockaddr*)&handoffAddr, sizeof(handoffAddr)) == SOCKET_ERROR ||
+        listen(handoffSocket_, 1) == SOCKET_ERROR) {
+        std::cerr << "Handoff socket setup failed: " << WSAGetLastError() << std::endl;
+        closesocket(handoffSocket_);
+        handoffSocket_ = INVALID_SOCKET;
+        std::remove(handoffPath_.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Asks the broker listening on takeoverPath_ for its sockets. The old process
+// keeps its handles until we acknowledge, and closes the connection once it
+// has let go of them and of the handoff path.
+bool NATSServer::takeOver(HandoffState& state) {
+    sockaddr_un takeoverAddr = {};
+    if (takeoverPath_.size() >= sizeof(takeoverAddr.sun_path)) {
+        std::cerr << "Takeover socket path too long: " << takeoverPath_ << std::endl;
+        return false;
+    }
+
+    SOCKET peer = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (peer == INVALID_SOCKET) {
+        std::cerr << "Takeover socket creation failed: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    takeoverAddr.sun_family = AF_UNIX;
+    takeoverPath_.copy(takeoverAddr.sun_path, takeoverPath_.size());
+
+    std::string frame;
+    bool received = connect(peer, (sockaddr*)&takeoverAddr, sizeof(takeoverAddr)) != SOCKET_ERROR &&
+                    Handoff::sendFrame(peer, std::to_string(Handoff::currentProcessId())) &&
+                    Handoff::receiveFrame(peer, frame) && Handoff::decode(frame, state);
+    if (!received) {
+        std::cerr << "Takeover from " << takeoverPath_ << " failed: " << WSAGetLastError() << std::endl;
+        closesocket(peer);
+        return false;
+    }
+
+    serverSocket_ = Handoff::openSocket(state.tcpListener);
+    if (!state.unixListener.empty()) {
+        unixSocket_ = Handoff::openSocket(state.unixListener);
+        unixSocketPath_ = state.unixSocketPath;
+    }
+    for (auto& client : state.clients) {
+        client.socket = Handoff::openSocket(client.socketInfo);
+    }
+
+    bool acknowledged = serverSocket_ != INVALID_SOCKET && Handoff::sendFrame(peer, "OK");
+    if (acknowledged) {
+        char byte;
+        while (recv(peer, &byte, 1, 0) > 0) {
+        }
+    }
+    closesocket(peer);
+
+    if (!acknowledged) {
+        std::cerr << "Takeover from " << takeoverPath_ << " failed: cannot open listening socket" << std::endl;
+        if (serverSocket_ != INVALID_SOCKET) {
+            closesocket(serverSocket_);
+            serverSocket_ = INVALID_SOCKET;
+        }
+        if (unixSocket_ != INVALID_SOCKET) {
+            closesocket(unixSocket_);
+            unixSocket_ = INVALID_SOCKET;
+        }
+        for (const auto& client : state.clients) {
+            if (client.socket != INVALID_SOCKET) {
+                closesocket(client.socket);
+            }
+        }
+        return false;
+    }
+
+    std::cout << "Took over " << state.clients.size() << " connections from " << takeoverPath_ << std::endl;
+    return true;
+}
+
+// Before any restored client can ack or fetch.
+void NATSServer::restoreAccounts(const HandoffState& state) {
+    for (const auto& entry : state.accounts) {
+        Account* account = accounts_->find(entry.name);
+        if (account == nullptr) {
+            continue;
+        }
+
+        std::lock_guard<BrokerMutex> lock(account->getMutex());
+        WorkQueues* workQueues = account->getWorkQueues();
+        if (workQueues != nullptr) {
+            workQueues->restore(entry.workQueues);
+            memoryBudget_.charge(MemoryUse::WORK_QUEUES, static_cast<int64_t>(workQueues->getMemoryUsage()));
+        }
+
+        MessageHistory* history = account->getHistory();
+        if (history != nullptr && history->isEnabled()) {
+            size_t before = history->getMemoryUsage();
+            history->restore(entry.history);
+            memoryBudget_.charge(MemoryUse::HISTORY,
+                                 static_cast<int64_t>(history->getMemoryUsage()) - static_cast<int64_t>(before));
+        }
+    }
+}
+
+void NATSServer::restoreClients(HandoffState& state) {
+    for (auto& entry : state.clients) {
+        if (entry.socket == INVALID_SOCKET) {
+            continue;
+        }
+
+        auto client = std::make_shared<Client>(entry.socket, host_, entry.ip);
+        Account* account = accounts_->find(entry.account);
+        client->setAccount(account != nullptr ? account : &accounts_->getGlobal());
+        if (entry.connectReceived) {
+            client->setConnectOptions(entry.connectOptions);
+        }
+        if (entry.connectOptions.binary) {
+            client->enableBinary();
+            BinarySession& session = *client->getBinarySession();
+            session.subjects.insert(entry.binarySubjects.begin(), entry.binarySubjects.end());
+            session.resumeRecord = entry.resumeRecord;
+        }
+        if (rateLimiter_) {
+            client->setRateBuckets(rateLimiter_->createClientBuckets());
+        }
+
+        addClient(client);
+        for (const auto& subscription : entry.subscriptions) {
+            subscribe(client, subscription.second, subscription.first);
+        }
 
-    acceptThread_ = std::thread(&NATSServer::acceptConnections, this);
+        client->restoreOutbound(entry.pendingOutput);
 
-    std::cout << "NATS server started on " << host_ << ":" << port_ << std::endl;
+        size_t index = nextIoLoop_++ % ioLoops_.size();
+        ioLoops_[index]->addClient(client, std::move(entry.pendingInput));
+    }
+}
+
+void NATSServer::serveHandoff() {
+    while (running_) {
+        SOCKET peer = accept(handoffSocket_, nullptr, nullptr);
+        if (peer == INVALID_SOCKET) {
+            break;
+        }
+
+        std::string request;
+        uint32_t processId = 0;
+        if (Handoff::receiveFrame(peer, request)) {
+            try {
+                processId = static_cast<uint32_t>(std::stoul(request));
+            } catch (const std::exception&) {
+            }
+        }
+
+        if (processId != 0 && !Handoff::isTrustedPeer(peer, processId)) {
+            std::cerr << "Handoff refused: process " << processId
+                      << " is not this executable running as this user" << std::endl;
+        } else if (processId != 0 && handOff(peer, processId)) {
+            return;
+        }
+        closesocket(peer);
+    }
+}
+
+// Runs on the handoff thread. Returns false, with the server still serving,
+// if the listening sockets cannot be duplicated. Past that point the server
+// stops whatever happens; if the new process never acknowledges, clients
+// are disconnected as in a plain restart.
+bool NATSServer::handOff(int peer, uint32_t processId) {
+    HandoffState state;
+    if (!Handoff::duplicateSocket(serverSocket_, processId, state.tcpListener) ||
+        (unixSocket_ != INVALID_SOCKET && !Handoff::duplicateSocket(unixSocket_, processId, state.unixListener))) {
+        std::cerr << "Handoff failed: cannot duplicate listening sockets: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+    if (!state.unixListener.empty()) {
+        state.unixSocketPath = unixSocketPath_;
+    }
+
+    if (!running_.exchange(false)) {
+        return false;
+    }
+
+    // The new process owns the listeners and the Unix socket path from here.
+    closesocket(serverSocket_);
+    serverSocket_ = INVALID_SOCKET;
+    if (unixSocket_ != INVALID_SOCKET) {
+        closesocket(unixSocket_);
+        unixSocket_ = INVALID_SOCKET;
+    }
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+    if (unixAcceptThread_.joinable()) {
+        unixAcceptThread_.join();
+    }
+
+    for (auto& ring : sharedMemoryRings_) {
+        ring->wake();
+    }
+    for (auto& thread : ringThreads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    ringThreads_.clear();
+
+    // Redeliveries and expired fetches are written to clients from here.
+    if (workQueueThread_.joinable()) {
+        workQueueThread_.join();
+    }
+
+    // With every thread that reads or writes client sockets stopped, the
+    // snapshot below is consistent.
+    std::vector<IoLoop::DetachedClient> detached;
+    for (auto& loop : ioLoops_) {
+        auto clients = loop->detach();
+        std::move(clients.begin(), clients.end(), std::back_inserter(detached));
+    }
+    ioLoops_.clear();
+
+    for (auto& entry : detached) {
+        const auto& client = entry.client;
+
+        HandoffClient handoffClient;
+        // TLS session state cannot follow the socket to another process.
+        if (!client->isConnected() || client->isTls() ||
+            !Handoff::duplicateSocket(client->getSocket(), processId, handoffClient.socketInfo)) {
+            client->disconnect();
+            continue;
+        }
+
+        handoffClient.ip = client->getIP();
+        handoffClient.account = client->getAccount()->getName();
+        handoffClient.connectReceived = client->hasReceivedConnect();
+        handoffClient.connectOptions.verbose = client->isVerbose();
+        handoffClient.connectOptions.pedantic = client->isPedantic();
+        handoffClient.connectOptions.echo = client->isEcho();
+        handoffClient.connectOptions.binary = client->isBinary();
+        if (client->isBinary()) {
+            const BinarySession& session = *client->getBinarySession();
+            handoffClient.binarySubjects.assign(session.subjects.begin(), session.subjects.end());
+            handoffClient.resumeRecord = static_cast<uint32_t>(session.resumeRecord);
+        }
+
+        {
+            Account& account = *client->getAccount();
+            std::lock_guard<BrokerMutex> lock(account.getMutex());
+            for (const auto& subscription : client->getSubscriptions()) {
+                SubjectId subjectId = account.getSubscriptions().getSubjectId(subscription.second);
+                handoffClient.subscriptions.emplace_back(subscription.first, subjects_.getSubject(subjectId));
+            }
+        }
+
+        handoffClient.pendingInput = std::move(entry.pendingInput);
+        handoffClient.pendingOutput = client->takeOutbound();
+        state.clients.push_back(std::move(handoffClient));
+    }
+
+    for (const auto& account : accounts_->getAll()) {
+        std::lock_guard<BrokerMutex> lock(account->getMutex());
+        MessageHistory* history = account->getHistory();
+        if (account->getWorkQueues() == nullptr && (history == nullptr || history->size() == 0)) {
+            continue;
+        }
+
+        HandoffAccount handoffAccount;
+        handoffAccount.name = account->getName();
+        if (account->getWorkQueues() != nullptr) {
+            account->getWorkQueues()->save(handoffAccount.workQueues);
+        }
+        if (history != nullptr) {
+            history->save(handoffAccount.history);
+        }
+        state.accounts.push_back(std::move(handoffAccount));
+    }
+
+    std::string ack;
+    if (Handoff::sendFrame(peer, Handoff::encode(state)) && Handoff::receiveFrame(peer, ack) && ack == "OK") {
+        for (auto& entry : detached) {
+            entry.client->detachSocket();
+        }
+        std::cout << "Handed off " << state.clients.size() << " connections to process " << processId << std::endl;
+    } else {
+        std::cerr << "Handoff to process " << processId << " failed, closing connections" << std::endl;
+    }
+
+    closesocket(handoffSocket_);
+    handoffSocket_ = INVALID_SOCKET;
+    std::remove(handoffPath_.c_str());
+    closesocket(peer);
+
+    teardown();
     return true;
 }
 
 void NATSServer::stop() {
-    if (!running_) {
+    if (!running_.exchange(false)) {
+        if (handoffThread_.joinable() && handoffThread_.get_id() != std::this_thread::get_id()) {
+            handoffThread_.join();
+        }
         return;
     }
 
-    running_ = false;
+    teardown();
+}
+
+void NATSServer::teardown() {
+    if (handoffSocket_ != INVALID_SOCKET) {
+        closesocket(handoffSocket_);
+        handoffSocket_ = INVALID_SOCKET;
+        std::remove(handoffPath_.c_str());
+    }
+    if (handoffThread_.joinable() && handoffThread_.get_id() != std::this_thread::get_id()) {
+        handoffThread_.join();
+    }
 
     if (serverSocket_ != INVALID_SOCKET) {
         closesocket(serverSocket_);
         serverSocket_ = INVALID_SOCKET;
     }
 
+    if (unixSocket_ != INVALID_SOCKET) {
+        closesocket(unixSocket_);
+        unixSocket_ = INVALID_SOCKET;
+        std::remove(unixSocketPath_.c_str());
+    }
+
     if (acceptThread_.joinable()) {
         acceptThread_.join();
     }
 
-    {
-        std::lock_guard<std::mutex> lock(clientsMutex_);
-        for (auto& client : clients_) {
-            client->disconnect();
+    if (unixAcceptThread_.joinable()) {
+        unixAcceptThread_.join();
+    }
+
+    for (auto& ring : sharedMemoryRings_) {
+        ring->wake();
+    }
+    for (auto& thread : ringThreads_) {
+        if (thread.joinable()) {
+            thread.join();
         }
-        clients_.clear();
     }
+    ringThreads_.clear();
 
-    {
-        std::lock_guard<std::mutex> lock(threadsMutex_);
-        for (auto& thread : clientThreads_) {
-            if (thread.joinable()) {
-                thread.join();
-            }
+    if (workQueueThread_.joinable()) {
+        workQueueThread_.join();
+    }
+
+    for (auto& loop : ioLoops_) {
+        loop->stop();
+    }
+    ioLoops_.clear();
+
+    for (const auto& account : accounts_->getAll()) {
+        std::lock_guard<BrokerMutex> lock(account->getMutex());
+        account->getSubscriptions().clear();
+        if (account->getHistory()) {
+            account->getHistory()->clear();
+        }
+        if (account->getWorkQueues()) {
+            account->getWorkQueues()->clear();
         }
-        clientThreads_.clear();
     }
 
     {
-        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
-        subscriptions_.clear();
+        std::lock_guard<BrokerMutex> lock(fanoutMutex_);
+        fanoutPool_.reset();
     }
 
+    {
+        std::lock_guard<BrokerMutex> lock(clientsMutex_);
+        for (auto& client : clients_) {
+            client->disconnect();
+            client->takeSubscriptions();
+        }
+        clients_.clear();
+    }
+
+    memoryBudget_.reset();
+
     WSACleanup();
 
     std::cout << "NATS server stopped" << std::endl;
@@ -131,138 +696,820 @@ void NATSServer::acceptConnections() {
         char clientIP[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
 
-        auto client = std::make_shared<Client>(clientSocket, host_, clientIP);
+        registerClient(clientSocket, clientIP, tls_ != nullptr);
+    }
+}
+
+void NATSServer::acceptUnixConnections() {
+    while (running_) {
+        SOCKET clientSocket = accept(unixSocket_, nullptr, nullptr);
 
-        addClient(client);
+        if (clientSocket == INVALID_SOCKET) {
+            if (running_) {
+                std::cerr << "Unix socket accept failed: " << WSAGetLastError() << std::endl;
+            }
+            break;
+        }
+
+        registerClient(clientSocket, "127.0.0.1");
+    }
+}
+
+bool NATSServer::attachConnection(int socket, const std::string& clientIP) {
+    if (!running_) {
+        closesocket(socket);
+        return false;
+    }
+
+    return registerClient(socket, clientIP);
+}
+
+// Over the memory budget a new connection gets the error in place of INFO
+// and is closed before it holds anything.
+bool NATSServer::registerClient(int clientSocket, const std::string& clientIP, bool secure) {
+    if (memoryBudget_.isExceeded()) {
+        memoryBudget_.recordRefusedConnection();
+        std::string error = parser_.generateErrMessage("Memory Budget Exceeded");
+        send(clientSocket, error.data(), static_cast<int>(error.size()), 0);
+        closesocket(clientSocket);
+        return false;
+    }
+
+    auto client = std::make_shared<Client>(clientSocket, host_, clientIP);
+    if (rateLimiter_) {
+        client->setRateBuckets(rateLimiter_->createClientBuckets());
+    }
 
-        std::string infoMessage = parser_.generateInfoMessage(host_, port_, clientIP);
-        client->sendMessage(infoMessage);
+    addClient(client);
 
-        std::lock_guard<std::mutex> lock(threadsMutex_);
-        clientThreads_.emplace_back(&NATSServer::handleClient, this, client);
+    std::string infoMessage = parser_.generateInfoMessage(host_, port_, clientIP, maxPayload_, secure);
+    client->sendControl(infoMessage);
+
+    // As in NATS, INFO goes out in the clear and the client starts the
+    // handshake once it has read it. The socket is still blocking here, so
+    // INFO is on the wire or the client is already gone.
+    if (secure) {
+        std::unique_ptr<TlsSession> session = tls_->createSession(clientSocket);
+        if (session) {
+            client->enableTls(std::move(session));
+        } else {
+            client->disconnect();
+        }
     }
+
+    size_t index = nextIoLoop_++ % ioLoops_.size();
+    ioLoops_[index]->addClient(client);
+
+    PULSE_PROBE2(connection__accept, client->getId(), clientIP.c_str());
+    return true;
 }
 
-void NATSServer::handleClient(std::shared_ptr<Client> client) {
-    while (running_ && client->isConnected()) {
-        std::string message = client->receiveMessage();
-        if (message.empty()) {
+size_t NATSServer::handleClientData(const std::shared_ptr<Client>& client, const char* data, size_t size) {
+    Command command;
+    size_t offset = 0;
+
+    while (offset < size && client->isConnected() && !client->isBinary()) {
+        size_t consumed;
+        bool parsed = parser_.parse(data + offset, size - offset, command, consumed);
+        if (consumed == 0) {
+            if (command.payloadData != nullptr) {
+                client->expectInput(static_cast<size_t>(command.payloadData - (data + offset)) + command.payloadSize + 2);
+            } else if (size - offset > NATSProtocolParser::MAX_CONTROL_LINE) {
+                client->sendControl(parser_.generateErrMessage("Maximum Control Line Exceeded"));
+                client->disconnect();
+            }
             break;
         }
 
-        Command command;
-        if (parser_.parse(message, command)) {
-            processCommand(client, command);
+        if (parsed) {
+            PULSE_PROBE3(command__parsed, client->getId(), static_cast<int>(command.type), command.subject.c_str());
         }
+        if (parsed && !processCommand(client, command)) {
+            break;
+        }
+        offset += consumed;
+    }
+
+    // The rest of the input after a CONNECT that switched framing is binary.
+    if (client->isBinary() && client->isConnected()) {
+        offset += handleBinaryData(client, data + offset, size - offset);
     }
 
+    // Reading more would only grow the backlog that put us over budget.
+    if (memoryBudget_.isExceeded() && client->isConnected()) {
+        memoryBudget_.recordThrottledRead();
+        client->pauseReading(BUDGET_READ_PAUSE_NS);
+    }
+
+    return offset;
+}
+
+size_t NATSServer::handleBinaryData(const std::shared_ptr<Client>& client, const char* data, size_t size) {
+    size_t offset = 0;
+
+    while (offset < size && client->isConnected()) {
+        BinaryFrame frame;
+        size_t frameSize = BinaryProtocol::parseFrame(data + offset, size - offset, frame);
+        if (frame.size > maxPayload_ + NATSProtocolParser::MAX_CONTROL_LINE) {
+            client->sendControl(parser_.generateErrMessage("Maximum Payload Violation"));
+            client->disconnect();
+            break;
+        }
+        if (frameSize == 0) {
+            if (size - offset >= BinaryProtocol::FRAME_HEADER_SIZE) {
+                client->expectInput(BinaryProtocol::FRAME_HEADER_SIZE + frame.size);
+            }
+            break;
+        }
+
+        if (!processFrame(client, frame)) {
+            break;
+        }
+        offset += frameSize;
+    }
+
+    return offset;
+}
+
+// Like processCommand, returns false when the frame has to be retried.
+bool NATSServer::processFrame(const std::shared_ptr<Client>& client, const BinaryFrame& frame) {
+    BinarySession& session = *client->getBinarySession();
+
+    switch (frame.type) {
+        case FrameType::PING:
+            client->sendControl(parser_.generatePongMessage());
+            break;
+
+        case FrameType::PONG:
+            client->recordPong();
+            break;
+
+        case FrameType::SUBJECT: {
+            if (frame.size <= 4) {
+                client->sendControl(parser_.generateErrMessage("Invalid Subject"));
+                break;
+            }
+            std::string subject(frame.body + 4, frame.size - 4);
+            if (client->isPedantic() && !NATSProtocolParser::isValidSubject(subject, true)) {
+                client->sendControl(parser_.generateErrMessage("Invalid Subject"));
+                break;
+            }
+            session.subjects[BinaryProtocol::readU32(frame.body)] = std::move(subject);
+            break;
+        }
+
+        case FrameType::SUB: {
+            auto it = frame.size == 8 ? session.subjects.find(BinaryProtocol::readU32(frame.body + 4))
+                                      : session.subjects.end();
+            if (it == session.subjects.end()) {
+                client->sendControl(parser_.generateErrMessage("Unknown Subject ID"));
+                break;
+            }
+            std::string sid = std::to_string(BinaryProtocol::readU32(frame.body));
+            if (subscribe(client, it->second, sid) && client->isVerbose()) {
+                client->sendControl(parser_.generateOkMessage());
+            }
+            break;
+        }
+
+        case FrameType::UNSUB:
+            if (frame.size == 4 && unsubscribe(client, std::to_string(BinaryProtocol::readU32(frame.body))) &&
+                client->isVerbose()) {
+                client->sendControl(parser_.generateOkMessage());
+            }
+            break;
+
+        case FrameType::PUB:
+            return processPubFrame(client, frame);
+
+        default:
+            client->sendControl(parser_.generateErrMessage("Unknown Protocol Operation"));
+            client->disconnect();
+            return false;
+    }
+
+    return true;
+}
+
+// Each record goes through processCommand as a PUB. If a rate limit holds
+// one back, the records before it are remembered so the retried frame does
+// not publish them twice.
+bool NATSServer::processPubFrame(const std::shared_ptr<Client>& client, const BinaryFrame& frame) {
+    BinarySession& session = *client->getBinarySession();
+    Command command;
+    command.type = CommandType::PUB;
+
+    size_t offset = 0;
+    for (size_t index = 0; offset < frame.size; index++) {
+        BinaryRecord record;
+        if (!BinaryProtocol::readRecord(frame, offset, record)) {
+            client->sendControl(parser_.generateErrMessage("Malformed Frame"));
+            client->disconnect();
+            return false;
+        }
+        if (index < session.resumeRecord) {
+            continue;
+        }
+
+        auto it = session.subjects.find(record.id);
+        if (it == session.subjects.end()) {
+            client->sendControl(parser_.generateErrMessage("Unknown Subject ID"));
+            continue;
+        }
+
+        {
+            AllocScope scope(AllocTag::PARSER);
+            command.subject = it->second;
+            command.replyTo.assign(record.replyTo, record.replySize);
+        }
+        command.payloadData = record.payload;
+        command.payloadSize = record.payloadSize;
+        PULSE_PROBE3(command__parsed, client->getId(), static_cast<int>(command.type), command.subject.c_str());
+        if (!processCommand(client, command)) {
+            session.resumeRecord = index;
+            return false;
+        }
+    }
+
+    session.resumeRecord = 0;
+    return true;
+}
+
+std::string NATSServer::generateMsgHeader(const Client& client, const std::string& subject, const std::string& sid,
+                                          const std::string& replyTo, size_t payloadSize) {
+    AllocScope scope(AllocTag::OUTBOUND_FRAMES);
+    uint32_t binarySid;
+    if (client.isBinary() && BinaryProtocol::parseSid(sid, binarySid)) {
+        return BinaryProtocol::generateMsgHeader(binarySid, replyTo, payloadSize);
+    }
+    return parser_.generateMsgHeader(subject, sid, replyTo, payloadSize);
+}
+
+void NATSServer::handleClientClosed(const std::shared_ptr<Client>& client) {
+    PULSE_PROBE1(connection__close, client->getId());
+    if (client->isSlowConsumer()) {
+        memoryBudget_.recordSlowConsumer();
+    }
+    removeClientSubscriptions(client);
     removeClient(client);
 }
 
-void NATSServer::processCommand(std::shared_ptr<Client> client, const Command& command) {
+// Returns false when the command has to wait for publish tokens; the caller
+// leaves it unconsumed and the client's IoLoop retries it later.
+bool NATSServer::processCommand(std::shared_ptr<Client> client, const Command& command) {
     switch (command.type) {
-        case CommandType::CONNECT:
-            client->sendMessage(parser_.generateOkMessage());
+        case CommandType::CONNECT: {
+            // Subscriptions live in the account's index, so a client cannot
+            // move once it has any.
+            Account& account = accounts_->findByUser(command.connectOptions.user);
+            if (&account != client->getAccount()) {
+                if (client->getSubscriptionCount() > 0) {
+                    client->sendControl(parser_.generateErrMessage("Authorization Violation"));
+                    client->disconnect();
+                    return false;
+                }
+                client->setAccount(&account);
+            }
+            // Binary sids are numbers, so text subscriptions cannot carry over.
+            if (command.connectOptions.binary && !client->isBinary()) {
+                if (client->getSubscriptionCount() > 0) {
+                    client->sendControl(parser_.generateErrMessage("Binary Framing Requires No Subscriptions"));
+                    client->disconnect();
+                    return false;
+                }
+                client->enableBinary();
+            }
+            client->setConnectOptions(command.connectOptions);
+            if (client->isVerbose()) {
+                client->sendControl(parser_.generateOkMessage());
+            }
             break;
+        }
 
         case CommandType::PING:
-            client->sendMessage(parser_.generatePongMessage());
+            client->sendControl(parser_.generatePongMessage());
             break;
 
         case CommandType::PONG:
+            client->recordPong();
             break;
 
         case CommandType::SUB:
-            if (subscribe(client, command.subject, command.sid)) {
-                client->sendMessage(parser_.generateOkMessage());
+            if (client->isPedantic() && !NATSProtocolParser::isValidSubject(command.subject, true)) {
+                client->sendControl(parser_.generateErrMessage("Invalid Subject"));
+                break;
+            }
+            if (subscribe(client, command.subject, command.sid) && client->isVerbose()) {
+                client->sendControl(parser_.generateOkMessage());
             }
             break;
 
         case CommandType::PUB:
-            if (publish(command.subject, command.payload, command.replyTo)) {
-                client->sendMessage(parser_.generateOkMessage());
+            if (command.payloadSize > maxPayload_) {
+                client->sendControl(parser_.generateErrMessage("Maximum Payload Violation"));
+                client->disconnect();
+                return false;
+            }
+            if (client->isPedantic() && !NATSProtocolParser::isValidSubject(command.subject, false)) {
+                client->sendControl(parser_.generateErrMessage("Invalid Publish Subject"));
+                break;
+            }
+            if (command.subject.compare(0, WORK_QUEUE_PREFIX.size(), WORK_QUEUE_PREFIX) == 0) {
+                if (!handleWorkQueueRequest(*client->getAccount(), command)) {
+                    client->sendControl(parser_.generateErrMessage("Invalid Work Queue Request"));
+                } else if (client->isVerbose()) {
+                    client->sendControl(parser_.generateOkMessage());
+                }
+                break;
+            }
+            if (command.subject.compare(0, SYSTEM_REQUEST_PREFIX.size(), SYSTEM_REQUEST_PREFIX) == 0 &&
+                client->getAccount() != &accounts_->getGlobal()) {
+                client->sendControl(parser_.generateErrMessage("Permissions Violation for Publish to " +
+                                                               command.subject));
+                break;
+            }
+            if (!command.replyTo.empty() &&
+                handleSystemRequest(*client->getAccount(), command.subject, command.replyTo)) {
+                if (client->isVerbose()) {
+                    client->sendControl(parser_.generateOkMessage());
+                }
+                break;
+            }
+            if (rateLimiter_) {
+                int64_t wait = rateLimiter_->admit(client->getRateBuckets(), command.subject, command.payloadSize);
+                if (wait > 0) {
+                    if (rateLimiter_->getAction() == RateLimitAction::BACKPRESSURE) {
+                        client->pauseReading(wait);
+                        return false;
+                    }
+                    client->sendControl(parser_.generateErrMessage("Rate Limit Exceeded"));
+                    break;
+                }
+            }
+            if (!publish(command.subject, command.payloadData, command.payloadSize, command.replyTo, client)) {
+                client->sendControl(parser_.generateErrMessage("Work Queue Full"));
+            } else if (client->isVerbose()) {
+                client->sendControl(parser_.generateOkMessage());
             }
             break;
 
         case CommandType::UNSUB:
-            if (unsubscribe(client, command.sid)) {
-                client->sendMessage(parser_.generateOkMessage());
+            if (unsubscribe(client, command.sid) && client->isVerbose()) {
+                client->sendControl(parser_.generateOkMessage());
             }
             break;
 
         default:
             break;
     }
+
+    return true;
 }
 
 bool NATSServer::subscribe(std::shared_ptr<Client> client, const std::string& subject, const std::string& sid) {
-    if (!client->addSubscription(subject, sid)) {
+    Account& account = accountFor(client.get());
+    std::lock_guard<BrokerMutex> lock(account.getMutex());
+
+    if (client->getSubscription(sid) != SubscriptionStore::INVALID_HANDLE) {
         return false;
     }
 
-    auto subscription = std::make_shared<Subscription>(
-        std::weak_ptr<Client>(client), subject, sid);
-
-    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
-    subscriptions_[subject].push_back(subscription);
+    SubscriptionStore& subscriptions = account.getSubscriptions();
+    SubscriptionHandle handle = subscriptions.add(client.get(), subject, sid);
+    client->addSubscription(sid, handle, subscriptions.getSubjectId(handle));
+    client->charge(MemoryUse::SUBSCRIPTIONS, SUBSCRIPTION_COST);
 
+    // Publishers deliver under the same lock, so live traffic starts right
+    // after the last retained message.
+    MessageHistory* retained = account.getHistory();
+    const std::deque<RetainedMessage>* history = retained ? retained->find(subject) : nullptr;
+    if (history != nullptr) {
+        for (const auto& message : *history) {
+            std::string header = generateMsgHeader(*client, subject, sid, message.replyTo, message.payload->size());
+            client->sendMessage(header, message.payload->data(), message.payload->size());
+        }
+    }
     return true;
 }
 
 bool NATSServer::unsubscribe(std::shared_ptr<Client> client, const std::string& sid) {
-    if (!client->removeSubscription(sid)) {
+    Account& account = accountFor(client.get());
+    std::lock_guard<BrokerMutex> lock(account.getMutex());
+
+    SubscriptionHandle handle = client->getSubscription(sid);
+    if (handle == SubscriptionStore::INVALID_HANDLE) {
+        return false;
+    }
+
+    client->removeSubscription(sid, account.getSubscriptions().getSubjectId(handle));
+    account.getSubscriptions().remove(handle);
+    client->charge(MemoryUse::SUBSCRIPTIONS, -SUBSCRIPTION_COST);
+    return true;
+}
+
+void NATSServer::removeClientSubscriptions(const std::shared_ptr<Client>& client) {
+    Account& account = accountFor(client.get());
+    std::lock_guard<BrokerMutex> lock(account.getMutex());
+
+    for (SubscriptionHandle handle : client->takeSubscriptions()) {
+        account.getSubscriptions().remove(handle);
+        client->charge(MemoryUse::SUBSCRIPTIONS, -SUBSCRIPTION_COST);
+    }
+}
+
+// Clients join the global account until a CONNECT names another.
+Account& NATSServer::accountFor(const Client* client) {
+    return client != nullptr && client->getAccount() != nullptr ? *client->getAccount() : accounts_->getGlobal();
+}
+
+bool NATSServer::publish(const std::string& subject, const std::string& message, const std::string& replyTo,
+                         std::shared_ptr<Client> origin) {
+    return publish(subject, message.data(), message.size(), replyTo, origin);
+}
+
+bool NATSServer::publish(const std::string& publishedSubject, const char* payload, size_t payloadSize,
+                         const std::string& replyTo, std::shared_ptr<Client> origin, const std::string& publisher) {
+    std::string mappedSubject;
+    bool mapped = subjectMapper_ && subjectMapper_->map(publishedSubject, mappedSubject);
+    const std::string& subject = mapped ? mappedSubject : publishedSubject;
+
+    if (trafficStats_ && !publisher.empty()) {
+        trafficStats_->record(subject, publisher.data(), publisher.size(), payloadSize);
+    } else if (trafficStats_) {
+        char label[32];
+        int size = origin ? std::snprintf(label, sizeof(label), "cid:%llu",
+                                          static_cast<unsigned long long>(origin->getId()))
+                          : std::snprintf(label, sizeof(label), "local");
+        trafficStats_->record(subject, label, static_cast<size_t>(size), payloadSize);
+    }
+
+    return deliverMessageToSubscribers(accountFor(origin.get()), subject, payload, payloadSize, replyTo,
+                                       origin.get());
+}
+
+bool NATSServer::handleSystemRequest(Account& account, const std::string& subject, const std::string& replyTo) {
+    if (subject == STATS_TRAFFIC_SUBJECT && trafficStats_) {
+        deliverMessageToSubscribers(account, replyTo, TrafficStats::toJson(trafficStats_->getReport()));
+        return true;
+    }
+
+    if (subject == STATS_LOCKS_SUBJECT) {
+        deliverMessageToSubscribers(account, replyTo, LockRegistry::toJson());
+        return true;
+    }
+
+    if (subject == STATS_RATES_SUBJECT) {
+        deliverMessageToSubscribers(account, replyTo, RateLimiter::toJson(getRateLimitReport()));
+        return true;
+    }
+
+    if (subject == STATS_MEMORY_SUBJECT) {
+        deliverMessageToSubscribers(account, replyTo, MemoryBudget::toJson(getMemoryBudgetReport()));
+        return true;
+    }
+
+    if (subject == STATS_ALLOCS_SUBJECT) {
+        deliverMessageToSubscribers(account, replyTo, AllocRegistry::toJson());
+        return true;
+    }
+
+    return false;
+}
+
+bool NATSServer::addSharedMemoryRing(const std::string& name, size_t capacity) {
+    if (running_) {
         return false;
     }
 
-    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    auto ring = SharedMemoryRing::create(name, capacity);
+    if (!ring) {
+        std::cerr << "Shared memory ring creation failed: " << name << std::endl;
+        return false;
+    }
 
-    for (auto& pair : subscriptions_) {
-        auto& subList = pair.second;
-        auto it = std::remove_if(subList.begin(), subList.end(),
-            [&](const std::shared_ptr<Subscription>& sub) {
-                return sub->getSID() == sid && sub->getClient().lock() == client;
-            });
+    sharedMemoryRings_.push_back(std::move(ring));
+    return true;
+}
+
+void NATSServer::drainSharedMemoryRing(SharedMemoryRing* ring) {
+    std::string publisher = "shm:" + ring->getName();
+
+    auto handler = [this, &publisher](const char* subject, size_t subjectSize,
+                                      const char* replyTo, size_t replyToSize,
+                                      const char* payload, size_t payloadSize) {
+        publish(std::string(subject, subjectSize), payload, payloadSize, std::string(replyTo, replyToSize), nullptr,
+                publisher);
+    };
+
+    while (running_) {
+        if (ring->drain(handler) == 0) {
+            ring->waitForFrames(100);
+        }
+    }
+}
+
+bool NATSServer::deliverMessageToSubscribers(Account& account, const std::string& subject, const char* payload,
+                                             size_t payloadSize, const std::string& replyTo, const Client* origin) {
+    bool delivered = deliverToAccount(account, subject, payload, payloadSize, replyTo, origin);
+
+    // Each account is delivered to under its own lock, one after another.
+    for (const auto& importer : account.getImporters()) {
+        if (subject.compare(0, importer.prefix.size(), importer.prefix) == 0) {
+            deliverToAccount(*importer.account, subject, payload, payloadSize, replyTo, origin);
+        }
+    }
+    return delivered;
+}
+
+bool NATSServer::deliverToAccount(Account& account, const std::string& subject, const char* payload,
+                                  size_t payloadSize, const std::string& replyTo, const Client* origin) {
+    bool skipOrigin = origin != nullptr && !origin->isEcho();
 
-        if (it != subList.end()) {
-            subList.erase(it, subList.end());
-            if (subList.empty()) {
-                subscriptions_.erase(pair.first);
+    std::lock_guard<BrokerMutex> lock(account.getMutex());
+
+    // Work-queue subjects are pulled, never pushed.
+    WorkQueues* workQueues = account.getWorkQueues();
+    if (workQueues != nullptr && workQueues->matches(subject)) {
+        size_t before = workQueues->getMemoryUsage();
+        std::vector<WorkBatch> ready;
+        bool queued = workQueues->push(subject, payload, payloadSize, ready);
+        sendWorkBatches(account, before, ready);
+        return queued;
+    }
+
+    if (account.getHistory()) {
+        recordHistory(account, subject, replyTo, payload, payloadSize);
+    }
+
+    // Records hold a reference to their subject and clients leave the store
+    // before they are released, so both stay valid while the lock is held.
+    const SubscriptionList* subscriptions = account.getSubscriptions().find(subject);
+    size_t subscriberCount = subscriptions != nullptr ? subscriptions->size() : 0;
+    PULSE_PROBE3(publish__matched, subject.c_str(), subscriberCount, payloadSize);
+    if (subscriptions == nullptr) {
+        PULSE_PROBE2(publish__delivered, subject.c_str(), subscriberCount);
+        return true;
+    }
+
+    auto deliver = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Subscription& subscription = (*subscriptions)[i];
+            if (skipOrigin && subscription.client == origin) {
+                continue;
             }
-            return true;
+            // The payload goes out straight from the publisher's read buffer.
+            std::string header = generateMsgHeader(*subscription.client, subject, subscription.sid, replyTo,
+                                                   payloadSize);
+            subscription.client->sendMessage(header, payload, payloadSize);
         }
+    };
+
+    // Large subscriber sets are split across the fan-out workers. run()
+    // waits for every share, so each subscriber still sees messages in
+    // publish order. While another account holds the pool, this one
+    // delivers on its own thread rather than wait.
+    std::unique_lock<BrokerMutex> pool(fanoutMutex_, std::defer_lock);
+    if (fanoutThreshold_ > 0 && subscriptions->size() >= fanoutThreshold_ && pool.try_lock() && fanoutPool_) {
+        fanoutPool_->run(subscriptions->size(), deliver);
+    } else {
+        deliver(0, subscriptions->size());
     }
+    PULSE_PROBE2(publish__delivered, subject.c_str(), subscriberCount);
+    return true;
+}
 
-    return false;
+// Called with the account's lock held.
+void NATSServer::recordHistory(Account& account, const std::string& subject, const std::string& replyTo,
+                               const char* payload, size_t payloadSize) {
+    MessageHistory& history = *account.getHistory();
+    size_t before = history.getMemoryUsage();
+    history.record(subject, replyTo, payload, payloadSize);
+    memoryBudget_.charge(MemoryUse::HISTORY,
+                         static_cast<int64_t>(history.getMemoryUsage()) - static_cast<int64_t>(before));
 }
 
-bool NATSServer::publish(const std::string& subject, const std::string& message, const std::string& replyTo) {
-    deliverMessageToSubscribers(subject, message, replyTo);
+bool NATSServer::handleWorkQueueRequest(Account& account, const Command& command) {
+    WorkQueues* workQueues = account.getWorkQueues();
+    if (workQueues == nullptr) {
+        return false;
+    }
+
+    const std::string& subject = command.subject;
+    std::lock_guard<BrokerMutex> lock(account.getMutex());
+    size_t before = workQueues->getMemoryUsage();
+    std::vector<WorkBatch> ready;
+
+    if (subject.compare(0, WORK_QUEUE_FETCH_PREFIX.size(), WORK_QUEUE_FETCH_PREFIX) == 0) {
+        FetchRequest request;
+        if (command.replyTo.empty() ||
+            !WorkQueues::parseFetchRequest(command.payloadData, command.payloadSize, request) ||
+            !workQueues->fetch(subject.substr(WORK_QUEUE_FETCH_PREFIX.size()), command.replyTo, request, ready)) {
+            return false;
+        }
+    } else if (subject.compare(0, WORK_QUEUE_ACK_PREFIX.size(), WORK_QUEUE_ACK_PREFIX) == 0) {
+        const char* start = subject.c_str() + WORK_QUEUE_ACK_PREFIX.size();
+        char* end = nullptr;
+        uint64_t sequence = std::strtoull(start, &end, 10);
+        if (end == start) {
+            return false;
+        }
+        // A late ack for a message already redelivered is not an error.
+        if (command.payloadSize == 4 && std::memcmp(command.payloadData, "-NAK", 4) == 0) {
+            workQueues->nak(sequence, ready);
+        } else {
+            workQueues->ack(sequence);
+        }
+    } else {
+        return false;
+    }
+
+    sendWorkBatches(account, before, ready);
     return true;
 }
 
-void NATSServer::deliverMessageToSubscribers(const std::string& subject, const std::string& payload, const std::string& replyTo) {
-    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+// Called with the account's lock held. Each batch goes to its inbox as one
+// write; a batch nobody is subscribed to receive goes back to its queue.
+void NATSServer::sendWorkBatches(Account& account, size_t bytesBefore, std::vector<WorkBatch>& ready) {
+    WorkQueues& workQueues = *account.getWorkQueues();
 
-    auto it = subscriptions_.find(subject);
-    if (it != subscriptions_.end()) {
-        for (auto& subscription : it->second) {
-            subscription->deliverMessage(subject, subscription->getSID(), replyTo, payload);
+    while (!ready.empty()) {
+        WorkBatch batch = std::move(ready.back());
+        ready.pop_back();
+
+        const SubscriptionList* inbox = account.getSubscriptions().find(batch.inbox);
+        if (inbox == nullptr || inbox->empty()) {
+            for (const auto& message : batch.messages) {
+                workQueues.nak(message.sequence, ready);
+            }
+            continue;
+        }
+
+        std::vector<std::string> ackSubjects;
+        for (const auto& message : batch.messages) {
+            ackSubjects.push_back(WORK_QUEUE_ACK_PREFIX + std::to_string(message.sequence) + "." +
+                                  std::to_string(message.deliveries));
+        }
+
+        for (const auto& subscription : *inbox) {
+            std::string frames;
+            uint32_t sid = 0;
+            if (subscription.client->isBinary() && BinaryProtocol::parseSid(subscription.sid, sid)) {
+                // One MSG frame carries the whole batch.
+                size_t bodySize = batch.messages.empty() ? BinaryProtocol::getRecordSize("", 0) : 0;
+                for (size_t i = 0; i < batch.messages.size(); i++) {
+                    bodySize += BinaryProtocol::getRecordSize(ackSubjects[i], batch.messages[i].payload->size());
+                }
+                BinaryProtocol::appendFrameHeader(frames, FrameType::MSG, bodySize);
+                if (batch.messages.empty()) {
+                    BinaryProtocol::appendRecordHeader(frames, sid, "", 0);
+                }
+                for (size_t i = 0; i < batch.messages.size(); i++) {
+                    BinaryProtocol::appendRecordHeader(frames, sid, ackSubjects[i], batch.messages[i].payload->size());
+                    frames += *batch.messages[i].payload;
+                }
+            } else {
+                if (batch.messages.empty()) {
+                    frames = parser_.generateMsgHeader(batch.subject, subscription.sid, "", 0) + "\r\n";
+                }
+                for (size_t i = 0; i < batch.messages.size(); i++) {
+                    frames += parser_.generateMsgHeader(batch.subject, subscription.sid, ackSubjects[i],
+                                                        batch.messages[i].payload->size());
+                    frames += *batch.messages[i].payload;
+                    frames += "\r\n";
+                }
+            }
+            subscription.client->sendMessage(frames);
+        }
+    }
+
+    memoryBudget_.charge(MemoryUse::WORK_QUEUES,
+                         static_cast<int64_t>(workQueues.getMemoryUsage()) - static_cast<int64_t>(bytesBefore));
+}
+
+void NATSServer::runWorkQueueTimers() {
+    while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WorkQueues::RESOLUTION_MS));
+
+        for (const auto& account : accounts_->getAll()) {
+            WorkQueues* workQueues = account->getWorkQueues();
+            std::lock_guard<BrokerMutex> lock(account->getMutex());
+            size_t before = workQueues->getMemoryUsage();
+            std::vector<WorkBatch> ready;
+            workQueues->advance(WorkQueues::Clock::now(), ready);
+            sendWorkBatches(*account, before, ready);
         }
     }
 }
 
 void NATSServer::addClient(std::shared_ptr<Client> client) {
-    std::lock_guard<std::mutex> lock(clientsMutex_);
+    if (client->getAccount() == nullptr) {
+        client->setAccount(&accounts_->getGlobal());
+    }
+    client->setMemoryBudget(&memoryBudget_);
+    client->charge(MemoryUse::CONNECTIONS, static_cast<int64_t>(getIdleConnectionFootprint()));
+
+    std::lock_guard<BrokerMutex> lock(clientsMutex_);
     clients_.push_back(client);
 }
 
 void NATSServer::removeClient(std::shared_ptr<Client> client) {
-    std::lock_guard<std::mutex> lock(clientsMutex_);
+    std::lock_guard<BrokerMutex> lock(clientsMutex_);
     
     auto it = std::find(clients_.begin(), clients_.end(), client);
     if (it != clients_.end()) {
         clients_.erase(it);
+        client->charge(MemoryUse::CONNECTIONS, -static_cast<int64_t>(getIdleConnectionFootprint()));
+    }
+}
+
+MemoryReport NATSServer::getMemoryReport() {
+    MemoryReport report;
+
+    for (const auto& loop : ioLoops_) {
+        report.connections += loop->getClientCount();
+        report.bufferedConnections += loop->getBufferedCount();
+        report.pooledBuffers += loop->getBufferPool().getPooledCount();
+        report.bufferCapacity = loop->getBufferPool().getBufferCapacity();
+    }
+
+    for (const auto& account : accounts_->getAll()) {
+        std::lock_guard<BrokerMutex> lock(account->getMutex());
+        report.accounts++;
+        report.subscriptions += account->getSubscriptions().size();
+        report.subscriptionBytes += account->getSubscriptions().getMemoryUsage();
+        if (account->getHistory()) {
+            report.historyMessages += account->getHistory()->size();
+            report.historyBytes += account->getHistory()->getMemoryUsage();
+        }
+        if (account->getWorkQueues()) {
+            WorkQueues& workQueues = *account->getWorkQueues();
+            report.workQueueMessages += workQueues.getPendingCount() + workQueues.getInFlightCount();
+            report.workQueueBytes += workQueues.getMemoryUsage();
+        }
+    }
+
+    {
+        std::lock_guard<BrokerMutex> lock(clientsMutex_);
+        for (const auto& client : clients_) {
+            size_t pending = client->getPendingBytes();
+            if (pending > 0) {
+                report.queuedConnections++;
+                report.outboundBytes += pending;
+            }
+        }
+    }
+
+    report.subjects = subjects_.size();
+    report.subjectTableBytes = subjects_.getMemoryUsage();
+
+    report.bytesPerIdleConnection = getIdleConnectionFootprint();
+    report.idleConnectionBytes = report.connections * report.bytesPerIdleConnection;
+    report.bufferBytes = (report.bufferedConnections + report.pooledBuffers) * report.bufferCapacity;
+    return report;
+}
+
+TrafficReport NATSServer::getTrafficReport() {
+    if (!trafficStats_) {
+        return TrafficReport();
     }
+    return trafficStats_->getReport();
+}
+
+RateLimitReport NATSServer::getRateLimitReport() {
+    if (!rateLimiter_) {
+        return RateLimitReport();
+    }
+    return rateLimiter_->getReport();
+}
+
+MemoryBudgetReport NATSServer::getMemoryBudgetReport(size_t topConnections) {
+    MemoryBudgetReport report = memoryBudget_.getReport();
+
+    {
+        std::lock_guard<BrokerMutex> lock(clientsMutex_);
+        for (const auto& client : clients_) {
+            ConnectionMemory connection;
+            connection.clientId = client->getId();
+            connection.ip = client->getIP();
+            connection.bytes = client->getChargedBytes();
+            report.connections.push_back(connection);
+        }
+    }
+
+    auto heavier = [](const ConnectionMemory& a, const ConnectionMemory& b) { return a.bytes > b.bytes; };
+    if (report.connections.size() > topConnections) {
+        std::partial_sort(report.connections.begin(), report.connections.begin() + topConnections,
+                          report.connections.end(), heavier);
+        report.connections.resize(topConnections);
+    } else {
+        std::sort(report.connections.begin(), report.connections.end(), heavier);
+    }
+    return report;
+}
+
+size_t NATSServer::getIdleConnectionFootprint() {
+    const size_t sharedControlBlock = 2 * sizeof(long) + sizeof(void*);
+    return sizeof(Client) + sharedControlBlock + IoLoop::getSlotSize() + sizeof(std::shared_ptr<Client>);
 }
 
 } // namespace pulse_broker 
\ No newline at end of file
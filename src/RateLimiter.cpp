@@ -0,0 +1,147 @@
+#include "../include/RateLimiter.h"
+#include <sstream>
+
+namespace pulse_broker {
+
+namespace {
+const int64_t NANOS_PER_SECOND = 1000000000;
+}
+
+TokenBucket::TokenBucket(double ratePerSecond)
+    : nanosPerToken_(ratePerSecond > 0 ? NANOS_PER_SECOND / ratePerSecond : 0),
+      burstNs_(NANOS_PER_SECOND), arrival_(0) {
+}
+
+int64_t TokenBucket::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+int64_t TokenBucket::take(double cost, int64_t now) {
+    if (isUnlimited()) {
+        return 0;
+    }
+
+    int64_t costNs = static_cast<int64_t>(cost * nanosPerToken_);
+    int64_t limit = costNs > burstNs_ ? costNs : burstNs_;
+
+    int64_t arrival = arrival_.load(std::memory_order_relaxed);
+    while (true) {
+        int64_t next = (arrival > now ? arrival : now) + costNs;
+        if (next - now > limit) {
+            return next - now - limit;
+        }
+        if (arrival_.compare_exchange_weak(arrival, next, std::memory_order_relaxed)) {
+            return 0;
+        }
+    }
+}
+
+void TokenBucket::refund(double cost) {
+    if (!isUnlimited()) {
+        arrival_.fetch_sub(static_cast<int64_t>(cost * nanosPerToken_), std::memory_order_relaxed);
+    }
+}
+
+RateBuckets::RateBuckets(const RateLimit& limit)
+    : messages_(limit.messagesPerSecond), bytes_(limit.bytesPerSecond) {
+}
+
+int64_t RateBuckets::take(size_t bytes, int64_t now) {
+    int64_t wait = messages_.take(1, now);
+    if (wait > 0) {
+        return wait;
+    }
+
+    wait = bytes_.take(static_cast<double>(bytes), now);
+    if (wait > 0) {
+        messages_.refund(1);
+    }
+    return wait;
+}
+
+void RateBuckets::refund(size_t bytes) {
+    messages_.refund(1);
+    bytes_.refund(static_cast<double>(bytes));
+}
+
+RateLimiter::SubjectRule::SubjectRule(const SubjectRateLimit& limit)
+    : prefix(limit.prefix), buckets(limit.limit), hits(0) {
+}
+
+RateLimiter::RateLimiter(const RateLimit& clientLimit, const std::vector<SubjectRateLimit>& subjectLimits,
+                         RateLimitAction action)
+    : clientLimit_(clientLimit), action_(action), clientHits_(0) {
+    for (const auto& limit : subjectLimits) {
+        if (limit.limit.isEnabled()) {
+            subjects_.emplace_back(new SubjectRule(limit));
+        }
+    }
+}
+
+std::unique_ptr<RateBuckets> RateLimiter::createClientBuckets() const {
+    if (!clientLimit_.isEnabled()) {
+        return nullptr;
+    }
+    return std::unique_ptr<RateBuckets>(new RateBuckets(clientLimit_));
+}
+
+int64_t RateLimiter::admit(RateBuckets* clientBuckets, const std::string& subject, size_t bytes) {
+    int64_t now = TokenBucket::now();
+
+    if (clientBuckets) {
+        int64_t wait = clientBuckets->take(bytes, now);
+        if (wait > 0) {
+            clientHits_.fetch_add(1, std::memory_order_relaxed);
+            return wait;
+        }
+    }
+
+    for (auto& rule : subjects_) {
+        if (subject.compare(0, rule->prefix.size(), rule->prefix) != 0) {
+            continue;
+        }
+
+        int64_t wait = rule->buckets.take(bytes, now);
+        if (wait > 0) {
+            rule->hits.fetch_add(1, std::memory_order_relaxed);
+            if (clientBuckets) {
+                clientBuckets->refund(bytes);
+            }
+        }
+        return wait;
+    }
+
+    return 0;
+}
+
+RateLimitReport RateLimiter::getReport() const {
+    RateLimitReport report;
+    report.action = action_;
+    report.clientHits = clientHits_.load(std::memory_order_relaxed);
+
+    for (const auto& rule : subjects_) {
+        SubjectRateReport subject;
+        subject.prefix = rule->prefix;
+        subject.hits = rule->hits.load(std::memory_order_relaxed);
+        report.subjects.push_back(subject);
+    }
+    return report;
+}
+
+std::string RateLimiter::toJson(const RateLimitReport& report) {
+    std::ostringstream out;
+    out << "{\"action\":\"" << (report.action == RateLimitAction::REJECT ? "reject" : "backpressure") << "\""
+        << ",\"client_hits\":" << report.clientHits << ",\"subjects\":[";
+
+    for (size_t i = 0; i < report.subjects.size(); i++) {
+        if (i > 0) {
+            out << ',';
+        }
+        out << "{\"prefix\":\"" << report.subjects[i].prefix << "\",\"hits\":" << report.subjects[i].hits << '}';
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,250 @@
+#include "../include/SharedMemoryRing.h"
+#include <windows.h>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <new>
+
+namespace pulse_broker {
+
+namespace {
+
+const uint32_t RING_MAGIC = 0x50425247;
+const size_t FRAME_ALIGNMENT = 16;
+
+struct FrameHeader {
+    uint32_t frameSize;
+    uint16_t subjectSize;
+    uint16_t replyToSize;
+    uint32_t payloadSize;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FrameHeader) == FRAME_ALIGNMENT, "frame header must fill one alignment unit");
+
+size_t alignFrame(size_t size) {
+    return (size + FRAME_ALIGNMENT - 1) & ~(FRAME_ALIGNMENT - 1);
+}
+
+} // namespace
+
+struct SharedMemoryRingHeader {
+    uint32_t magic;
+    uint32_t capacity;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> consumerWaiting;
+};
+
+std::string SharedMemoryRing::mappingName(const std::string& name) {
+    return "Local\\PulseBroker." + name;
+}
+
+std::string SharedMemoryRing::eventName(const std::string& name) {
+    return "Local\\PulseBroker." + name + ".wake";
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::create(const std::string& name, size_t capacity) {
+    if (capacity < 4096 || (capacity & (capacity - 1)) != 0 || capacity > UINT32_MAX / 2) {
+        return nullptr;
+    }
+
+    size_t mappingSize = sizeof(SharedMemoryRingHeader) + capacity;
+
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                       0, static_cast<DWORD>(mappingSize), mappingName(name).c_str());
+    if (mapping == nullptr) {
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, mappingSize);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    HANDLE event = CreateEventA(nullptr, FALSE, FALSE, eventName(name).c_str());
+    if (event == nullptr) {
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    auto header = new (view) SharedMemoryRingHeader();
+    header->capacity = static_cast<uint32_t>(capacity);
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->consumerWaiting.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = RING_MAGIC;
+
+    char* data = static_cast<char*>(view) + sizeof(SharedMemoryRingHeader);
+    return std::unique_ptr<SharedMemoryRing>(new SharedMemoryRing(name, mapping, event, header, data));
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::attach(const std::string& name) {
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName(name).c_str());
+    if (mapping == nullptr) {
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    auto header = static_cast<SharedMemoryRingHeader*>(view);
+    if (header->magic != RING_MAGIC) {
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    HANDLE event = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, eventName(name).c_str());
+    if (event == nullptr) {
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    char* data = static_cast<char*>(view) + sizeof(SharedMemoryRingHeader);
+    return std::unique_ptr<SharedMemoryRing>(new SharedMemoryRing(name, mapping, event, header, data));
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name, void* mapping, void* event,
+                                   SharedMemoryRingHeader* header, char* data)
+    : name_(name), mapping_(mapping), event_(event), header_(header), data_(data) {
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+    UnmapViewOfFile(header_);
+    CloseHandle(event_);
+    CloseHandle(mapping_);
+}
+
+size_t SharedMemoryRing::getCapacity() const {
+    return header_->capacity;
+}
+
+bool SharedMemoryRing::tryPublish(const std::string& subject, const std::string& payload, const std::string& replyTo) {
+    if (subject.empty() || subject.size() > UINT16_MAX || replyTo.size() > UINT16_MAX) {
+        return false;
+    }
+
+    size_t capacity = header_->capacity;
+    size_t frameSize = alignFrame(sizeof(FrameHeader) + subject.size() + replyTo.size() + payload.size());
+    if (frameSize > capacity / 2) {
+        return false;
+    }
+
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+
+    size_t offset = static_cast<size_t>(head & (capacity - 1));
+    size_t untilEnd = capacity - offset;
+    size_t needed = untilEnd < frameSize ? untilEnd + frameSize : frameSize;
+
+    if (capacity - static_cast<size_t>(head - tail) < needed) {
+        return false;
+    }
+
+    if (untilEnd < frameSize) {
+        FrameHeader padding = {};
+        padding.frameSize = static_cast<uint32_t>(untilEnd);
+        std::memcpy(data_ + offset, &padding, sizeof(padding));
+        head += untilEnd;
+        offset = 0;
+    }
+
+    FrameHeader frame = {};
+    frame.frameSize = static_cast<uint32_t>(frameSize);
+    frame.subjectSize = static_cast<uint16_t>(subject.size());
+    frame.replyToSize = static_cast<uint16_t>(replyTo.size());
+    frame.payloadSize = static_cast<uint32_t>(payload.size());
+
+    char* out = data_ + offset;
+    std::memcpy(out, &frame, sizeof(frame));
+    out += sizeof(frame);
+    std::memcpy(out, subject.data(), subject.size());
+    out += subject.size();
+    std::memcpy(out, replyTo.data(), replyTo.size());
+    out += replyTo.size();
+    std::memcpy(out, payload.data(), payload.size());
+
+    header_->head.store(head + frameSize, std::memory_order_seq_cst);
+
+    if (header_->consumerWaiting.load(std::memory_order_seq_cst) != 0 &&
+        header_->consumerWaiting.exchange(0, std::memory_order_seq_cst) != 0) {
+        wake();
+    }
+
+    return true;
+}
+
+bool SharedMemoryRing::publish(const std::string& subject, const std::string& payload, const std::string& replyTo) {
+    size_t frameSize = alignFrame(sizeof(FrameHeader) + subject.size() + replyTo.size() + payload.size());
+    if (subject.empty() || frameSize > header_->capacity / 2) {
+        return false;
+    }
+
+    while (!tryPublish(subject, payload, replyTo)) {
+        std::this_thread::yield();
+    }
+
+    return true;
+}
+
+size_t SharedMemoryRing::drain(const FrameHandler& handler) {
+    size_t capacity = header_->capacity;
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    size_t frames = 0;
+
+    while (tail != head) {
+        const char* in = data_ + static_cast<size_t>(tail & (capacity - 1));
+
+        FrameHeader frame;
+        std::memcpy(&frame, in, sizeof(frame));
+
+        size_t untilEnd = capacity - static_cast<size_t>(tail & (capacity - 1));
+        size_t contentSize = sizeof(frame) + frame.subjectSize + frame.replyToSize + size_t(frame.payloadSize);
+        if (frame.frameSize < FRAME_ALIGNMENT || frame.frameSize > untilEnd ||
+            (frame.subjectSize != 0 && contentSize > frame.frameSize)) {
+            header_->tail.store(head, std::memory_order_release);
+            break;
+        }
+
+        if (frame.subjectSize != 0) {
+            const char* subject = in + sizeof(frame);
+            const char* replyTo = subject + frame.subjectSize;
+            const char* payload = replyTo + frame.replyToSize;
+            handler(subject, frame.subjectSize, replyTo, frame.replyToSize, payload, frame.payloadSize);
+            frames++;
+        }
+
+        tail += frame.frameSize;
+        header_->tail.store(tail, std::memory_order_release);
+    }
+
+    return frames;
+}
+
+void SharedMemoryRing::waitForFrames(int timeoutMs) {
+    header_->consumerWaiting.store(1, std::memory_order_seq_cst);
+
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    if (header_->head.load(std::memory_order_seq_cst) != tail) {
+        header_->consumerWaiting.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    WaitForSingleObject(event_, static_cast<DWORD>(timeoutMs));
+    header_->consumerWaiting.store(0, std::memory_order_relaxed);
+}
+
+void SharedMemoryRing::wake() {
+    SetEvent(event_);
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,260 @@
+#include "../include/SubjectMapping.h"
+#include <iostream>
+#include <cstdlib>
+
+namespace pulse_broker {
+
+namespace {
+
+const uint32_t FNV_OFFSET = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+
+uint32_t fnv1a(uint32_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+std::vector<std::string> split(const std::string& subject) {
+    std::vector<std::string> tokens;
+    size_t start = 0;
+    while (true) {
+        size_t dot = subject.find('.', start);
+        tokens.push_back(subject.substr(start, dot == std::string::npos ? std::string::npos : dot - start));
+        if (dot == std::string::npos) {
+            return tokens;
+        }
+        start = dot + 1;
+    }
+}
+
+// Parses "name(a,b,...)" wrapped in {{ }} into its numeric arguments.
+bool parseFunction(const std::string& token, std::string& name, std::vector<long>& arguments) {
+    if (token.size() < 4 || token.compare(0, 2, "{{") != 0 || token.compare(token.size() - 2, 2, "}}") != 0) {
+        return false;
+    }
+
+    std::string body = token.substr(2, token.size() - 4);
+    size_t open = body.find('(');
+    if (open == std::string::npos || body.empty() || body.back() != ')') {
+        return false;
+    }
+
+    name = body.substr(0, open);
+    std::string list = body.substr(open + 1, body.size() - open - 2);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        std::string argument = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        char* end = nullptr;
+        long value = std::strtol(argument.c_str(), &end, 10);
+        if (argument.empty() || end == argument.c_str()) {
+            return false;
+        }
+        while (*end == ' ') {
+            end++;
+        }
+        if (*end != '\0') {
+            return false;
+        }
+        arguments.push_back(value);
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return true;
+}
+
+} // namespace
+
+SubjectMapper::SubjectMapper(const std::vector<SubjectMappingRule>& rules) {
+    for (const auto& rule : rules) {
+        CompiledRule compiled;
+        std::string error;
+        if (!compile(rule, compiled, error)) {
+            std::cerr << "Ignoring subject mapping " << rule.source << " -> " << rule.destination << ": " << error
+                      << std::endl;
+            continue;
+        }
+        rules_.push_back(std::move(compiled));
+    }
+}
+
+bool SubjectMapper::validate(const SubjectMappingRule& rule, std::string& error) {
+    CompiledRule compiled;
+    return compile(rule, compiled, error);
+}
+
+bool SubjectMapper::compile(const SubjectMappingRule& rule, CompiledRule& compiled, std::string& error) {
+    size_t wildcardCount = 0;
+    std::vector<std::string> source = split(rule.source);
+    if (source.size() > MAX_TOKENS) {
+        error = "source has too many tokens";
+        return false;
+    }
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source[i].empty()) {
+            error = "empty source token";
+            return false;
+        }
+        if (source[i] == ">") {
+            if (i + 1 != source.size()) {
+                error = "> must be the last source token";
+                return false;
+            }
+            compiled.rest = true;
+        } else {
+            if (source[i] == "*") {
+                wildcardCount++;
+            }
+            compiled.source.push_back(source[i]);
+        }
+    }
+
+    std::vector<std::string> destination = split(rule.destination);
+    size_t nextWildcard = 0;
+    for (size_t i = 0; i < destination.size(); i++) {
+        const std::string& text = destination[i];
+        Token token;
+
+        if (text.empty()) {
+            error = "empty destination token";
+            return false;
+        } else if (text == "*") {
+            if (nextWildcard == wildcardCount) {
+                error = "more * in the destination than in the source";
+                return false;
+            }
+            token.kind = Token::WILDCARD;
+            token.wildcards.push_back(nextWildcard++);
+        } else if (text == ">") {
+            if (!compiled.rest || i + 1 != destination.size()) {
+                error = "> must end both the source and the destination";
+                return false;
+            }
+            token.kind = Token::REST;
+        } else if (text.compare(0, 2, "{{") == 0) {
+            std::string name;
+            std::vector<long> arguments;
+            if (!parseFunction(text, name, arguments)) {
+                error = "cannot parse " + text;
+                return false;
+            }
+
+            size_t first = 0;
+            if (name == "wildcard" && arguments.size() == 1) {
+                token.kind = Token::WILDCARD;
+            } else if (name == "partition" && arguments.size() >= 2 && arguments[0] > 0) {
+                token.kind = Token::PARTITION;
+                token.partitions = static_cast<uint32_t>(arguments[0]);
+                first = 1;
+            } else {
+                error = "unknown function " + text;
+                return false;
+            }
+
+            for (size_t a = first; a < arguments.size(); a++) {
+                if (arguments[a] < 1 || static_cast<size_t>(arguments[a]) > wildcardCount) {
+                    error = "no source wildcard " + std::to_string(arguments[a]);
+                    return false;
+                }
+                token.wildcards.push_back(static_cast<size_t>(arguments[a] - 1));
+            }
+        } else {
+            token.literal = text;
+        }
+
+        compiled.destination.push_back(std::move(token));
+    }
+    return true;
+}
+
+bool SubjectMapper::map(const std::string& subject, std::string& mapped) const {
+    size_t starts[MAX_TOKENS + 1];
+    size_t ends[MAX_TOKENS + 1];
+    size_t count = 0;
+
+    size_t start = 0;
+    while (count <= MAX_TOKENS) {
+        size_t dot = subject.find('.', start);
+        starts[count] = start;
+        ends[count] = dot == std::string::npos ? subject.size() : dot;
+        count++;
+        if (dot == std::string::npos) {
+            break;
+        }
+        start = dot + 1;
+    }
+    if (count > MAX_TOKENS) {
+        return false;
+    }
+
+    size_t wildcards[MAX_TOKENS];
+    for (const auto& rule : rules_) {
+        size_t sourceSize = rule.source.size();
+        if (rule.rest ? count <= sourceSize : count != sourceSize) {
+            continue;
+        }
+
+        size_t wildcardCount = 0;
+        bool matched = true;
+        for (size_t i = 0; i < sourceSize && matched; i++) {
+            const std::string& token = rule.source[i];
+            if (token == "*") {
+                wildcards[wildcardCount++] = i;
+            } else {
+                matched = token.size() == ends[i] - starts[i] && subject.compare(starts[i], token.size(), token) == 0;
+            }
+        }
+        if (!matched) {
+            continue;
+        }
+
+        mapped.clear();
+        for (size_t i = 0; i < rule.destination.size(); i++) {
+            const Token& token = rule.destination[i];
+            if (i > 0) {
+                mapped += '.';
+            }
+
+            switch (token.kind) {
+                case Token::LITERAL:
+                    mapped += token.literal;
+                    break;
+                case Token::WILDCARD: {
+                    size_t index = wildcards[token.wildcards[0]];
+                    mapped.append(subject, starts[index], ends[index] - starts[index]);
+                    break;
+                }
+                case Token::PARTITION: {
+                    uint32_t hash = FNV_OFFSET;
+                    for (size_t wildcard : token.wildcards) {
+                        size_t index = wildcards[wildcard];
+                        hash = fnv1a(hash, subject.data() + starts[index], ends[index] - starts[index]);
+                    }
+                    mapped += std::to_string(hash % token.partitions);
+                    break;
+                }
+                case Token::REST:
+                    mapped.append(subject, starts[sourceSize], std::string::npos);
+                    break;
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+uint32_t SubjectMapper::partition(const std::vector<std::string>& tokens, uint32_t count) {
+    uint32_t hash = FNV_OFFSET;
+    for (const auto& token : tokens) {
+        hash = fnv1a(hash, token.data(), token.size());
+    }
+    return count > 0 ? hash % count : 0;
+}
+
+} // namespace pulse_broker
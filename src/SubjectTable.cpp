@@ -0,0 +1,145 @@
+#include "../include/SubjectTable.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace pulse_broker {
+
+bool SubjectTable::Key::operator==(const Key& other) const {
+    return hash == other.hash && size == other.size && std::memcmp(data, other.data, size) == 0;
+}
+
+SubjectTable::SubjectTable()
+    : nextId_(1), chunkCount_(0), size_(0), subjectBytes_(0) {
+    for (size_t i = 0; i < MAX_CHUNKS; i++) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+SubjectTable::~SubjectTable() {
+    for (size_t i = 0; i < chunkCount_; i++) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t SubjectTable::hash(const char* data, size_t size) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+SubjectTable::Shard& SubjectTable::shardFor(uint64_t hash) const {
+    return shards_[(hash >> 7) % SHARDS];
+}
+
+SubjectTable::Entry& SubjectTable::entryAt(SubjectId id) const {
+    Entry* chunk = chunks_[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    return chunk[id & (CHUNK_SIZE - 1)];
+}
+
+SubjectId SubjectTable::allocateId() {
+    std::lock_guard<BrokerMutex> lock(allocationMutex_);
+
+    if (!freeIds_.empty()) {
+        SubjectId id = freeIds_.back();
+        freeIds_.pop_back();
+        return id;
+    }
+
+    if ((nextId_ >> CHUNK_BITS) >= chunkCount_) {
+        if (chunkCount_ == MAX_CHUNKS) {
+            throw std::length_error("subject table is full");
+        }
+        chunks_[chunkCount_].store(new Entry[CHUNK_SIZE], std::memory_order_release);
+        chunkCount_++;
+    }
+
+    return nextId_++;
+}
+
+void SubjectTable::freeId(SubjectId id) {
+    std::lock_guard<BrokerMutex> lock(allocationMutex_);
+    freeIds_.push_back(id);
+}
+
+SubjectId SubjectTable::intern(const std::string& subject) {
+    uint64_t subjectHash = hash(subject.data(), subject.size());
+    Shard& shard = shardFor(subjectHash);
+
+    std::lock_guard<BrokerMutex> lock(shard.mutex);
+
+    auto it = shard.ids.find(Key{subject.data(), subject.size(), subjectHash});
+    if (it != shard.ids.end()) {
+        entryAt(it->second).references.fetch_add(1, std::memory_order_relaxed);
+        return it->second;
+    }
+
+    SubjectId id = allocateId();
+    Entry& entry = entryAt(id);
+    entry.subject = subject;
+    entry.hash = subjectHash;
+    entry.references.store(1, std::memory_order_relaxed);
+
+    shard.ids.emplace(Key{entry.subject.data(), entry.subject.size(), subjectHash}, id);
+    size_++;
+    subjectBytes_ += entry.subject.size();
+    return id;
+}
+
+SubjectId SubjectTable::find(const std::string& subject) const {
+    uint64_t subjectHash = hash(subject.data(), subject.size());
+    Shard& shard = shardFor(subjectHash);
+
+    std::lock_guard<BrokerMutex> lock(shard.mutex);
+
+    auto it = shard.ids.find(Key{subject.data(), subject.size(), subjectHash});
+    return it != shard.ids.end() ? it->second : INVALID_ID;
+}
+
+void SubjectTable::retain(SubjectId id) {
+    entryAt(id).references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SubjectTable::release(SubjectId id) {
+    Entry& entry = entryAt(id);
+    Shard& shard = shardFor(entry.hash);
+
+    // The count only reaches zero under the shard lock, so a concurrent
+    // intern of the same subject either revives the entry first or misses
+    // it and creates a new one.
+    std::lock_guard<BrokerMutex> lock(shard.mutex);
+
+    if (entry.references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    shard.ids.erase(Key{entry.subject.data(), entry.subject.size(), entry.hash});
+    size_--;
+    subjectBytes_ -= entry.subject.size();
+
+    std::string().swap(entry.subject);
+    freeId(id);
+}
+
+const std::string& SubjectTable::getSubject(SubjectId id) const {
+    return entryAt(id).subject;
+}
+
+uint32_t SubjectTable::getReferenceCount(SubjectId id) const {
+    return entryAt(id).references.load(std::memory_order_relaxed);
+}
+
+size_t SubjectTable::getMemoryUsage() const {
+    size_t chunks;
+    {
+        std::lock_guard<BrokerMutex> lock(allocationMutex_);
+        chunks = chunkCount_;
+    }
+
+    size_t mapBytes = size_ * (sizeof(Key) + sizeof(SubjectId) + 2 * sizeof(void*));
+    return chunks * CHUNK_SIZE * sizeof(Entry) + subjectBytes_ + mapBytes;
+}
+
+} // namespace pulse_broker
@@ -1,24 +1,91 @@
 #include "../include/Subscription.h"
-#include "../include/Client.h"
-#include "../include/NATSProtocolParser.h"
 
 namespace pulse_broker {
 
-Subscription::Subscription(std::weak_ptr<Client> client, const std::string& subject, const std::string& sid)
-    : client_(client), subject_(subject), sid_(sid) {
+SubscriptionStore::SubscriptionStore(SubjectTable& subjects)
+    : subjects_(subjects), size_(0) {
 }
 
-bool Subscription::deliverMessage(const std::string& subject, const std::string& sid, 
-                               const std::string& replyTo, const std::string& payload) {
-    auto client = client_.lock();
-    if (!client) {
-        return false;
+SubscriptionStore::~SubscriptionStore() {
+    clear();
+}
+
+SubscriptionHandle SubscriptionStore::add(Client* client, const std::string& subject, const std::string& sid) {
+    SubjectId subjectId = subjects_.intern(subject);
+    AllocScope scope(AllocTag::SUBSCRIPTIONS);
+
+    SubscriptionHandle handle;
+    if (!freeHandles_.empty()) {
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+    } else {
+        handle = static_cast<SubscriptionHandle>(slots_.size());
+        slots_.push_back(Slot());
+    }
+
+    auto& records = subscriptions_[subjectId];
+    slots_[handle].subjectId = subjectId;
+    slots_[handle].position = static_cast<uint32_t>(records.size());
+    records.push_back(Subscription{client, handle, sid});
+
+    size_++;
+    return handle;
+}
+
+void SubscriptionStore::remove(SubscriptionHandle handle) {
+    if (handle >= slots_.size() || slots_[handle].subjectId == SubjectTable::INVALID_ID) {
+        return;
+    }
+
+    Slot& slot = slots_[handle];
+    auto it = subscriptions_.find(slot.subjectId);
+    auto& records = it->second;
+
+    if (slot.position != records.size() - 1) {
+        records[slot.position] = std::move(records.back());
+        slots_[records[slot.position].handle].position = slot.position;
+    }
+    records.pop_back();
+
+    if (records.empty()) {
+        subscriptions_.erase(it);
+    }
+
+    subjects_.release(slot.subjectId);
+    slot.subjectId = SubjectTable::INVALID_ID;
+    freeHandles_.push_back(handle);
+    size_--;
+}
+
+void SubscriptionStore::clear() {
+    for (const auto& pair : subscriptions_) {
+        for (size_t i = 0; i < pair.second.size(); i++) {
+            subjects_.release(pair.first);
+        }
+    }
+
+    subscriptions_.clear();
+    slots_.clear();
+    freeHandles_.clear();
+    size_ = 0;
+}
+
+const SubscriptionList* SubscriptionStore::find(const std::string& subject) const {
+    SubjectId subjectId = subjects_.find(subject);
+    if (subjectId == SubjectTable::INVALID_ID) {
+        return nullptr;
     }
 
-    NATSProtocolParser parser;
-    std::string message = parser.generateMsgMessage(subject, sid, replyTo, payload);
-    
-    return client->sendMessage(message);
+    auto it = subscriptions_.find(subjectId);
+    return it != subscriptions_.end() ? &it->second : nullptr;
+}
+
+size_t SubscriptionStore::getMemoryUsage() const {
+    size_t bytes = slots_.capacity() * sizeof(Slot) + freeHandles_.capacity() * sizeof(SubscriptionHandle);
+    for (const auto& pair : subscriptions_) {
+        bytes += sizeof(pair) + 2 * sizeof(void*) + pair.second.capacity() * sizeof(Subscription);
+    }
+    return bytes;
 }
 
-} // namespace pulse_broker 
\ No newline at end of file
+} // namespace pulse_broker
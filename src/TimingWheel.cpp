@@ -0,0 +1,177 @@
+#include "../include/TimingWheel.h"
+
+namespace pulse_broker {
+
+TimingWheel::TimingWheel(std::chrono::milliseconds resolution, Handler handler, Clock::time_point start)
+    : resolution_(resolution.count() > 0 ? resolution : std::chrono::milliseconds(1)),
+      handler_(handler), start_(start), currentTick_(0), count_(0) {
+    for (unsigned level = 0; level < LEVELS; level++) {
+        for (unsigned slot = 0; slot < SLOTS; slot++) {
+            slots_[level][slot].prev = &slots_[level][slot];
+            slots_[level][slot].next = &slots_[level][slot];
+        }
+    }
+}
+
+TimingWheel::~TimingWheel() {
+    for (unsigned level = 0; level < LEVELS; level++) {
+        for (unsigned slot = 0; slot < SLOTS; slot++) {
+            Timer& head = slots_[level][slot];
+            while (head.next != &head) {
+                unlink(*head.next);
+            }
+        }
+    }
+}
+
+void TimingWheel::link(Timer& head, Timer& timer) {
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+}
+
+void TimingWheel::unlink(Timer& timer) {
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = nullptr;
+    timer.next = nullptr;
+}
+
+void TimingWheel::schedule(Timer& timer, std::chrono::milliseconds delay) {
+    if (timer.isScheduled()) {
+        cancel(timer);
+    }
+
+    uint64_t ticks = static_cast<uint64_t>((delay.count() + resolution_.count() - 1) / resolution_.count());
+    timer.deadline = currentTick_ + (ticks > 0 ? ticks : 1);
+
+    insert(timer);
+    count_++;
+}
+
+void TimingWheel::cancel(Timer& timer) {
+    if (!timer.isScheduled()) {
+        return;
+    }
+
+    unlink(timer);
+    count_--;
+}
+
+void TimingWheel::insert(Timer& timer) {
+    uint64_t deadline = timer.deadline > currentTick_ ? timer.deadline : currentTick_;
+
+    for (unsigned level = 0; level < LEVELS; level++) {
+        unsigned shift = level * SLOT_BITS;
+        if ((deadline >> shift) - (currentTick_ >> shift) < SLOTS) {
+            link(slots_[level][(deadline >> shift) & (SLOTS - 1)], timer);
+            return;
+        }
+    }
+
+    unsigned shift = (LEVELS - 1) * SLOT_BITS;
+    link(slots_[LEVELS - 1][((currentTick_ >> shift) - 1) & (SLOTS - 1)], timer);
+}
+
+void TimingWheel::cascade(unsigned level) {
+    unsigned shift = level * SLOT_BITS;
+    Timer& head = slots_[level][(currentTick_ >> shift) & (SLOTS - 1)];
+
+    Timer pending;
+    pending.prev = &pending;
+    pending.next = &pending;
+
+    while (head.next != &head) {
+        Timer& timer = *head.next;
+        unlink(timer);
+        link(pending, timer);
+    }
+
+    while (pending.next != &pending) {
+        Timer& timer = *pending.next;
+        unlink(timer);
+        insert(timer);
+    }
+}
+
+size_t TimingWheel::advance(Clock::time_point now) {
+    if (now < start_) {
+        return 0;
+    }
+
+    uint64_t targetTick = static_cast<uint64_t>((now - start_) / resolution_);
+    size_t fired = 0;
+
+    while (currentTick_ < targetTick) {
+        currentTick_++;
+
+        if (count_ == 0) {
+            currentTick_ = targetTick;
+            break;
+        }
+
+        for (unsigned level = LEVELS - 1; level > 0; level--) {
+            uint64_t mask = (uint64_t(1) << (level * SLOT_BITS)) - 1;
+            if ((currentTick_ & mask) == 0) {
+                cascade(level);
+            }
+        }
+
+        Timer& head = slots_[0][currentTick_ & (SLOTS - 1)];
+
+        Timer expired;
+        expired.prev = &expired;
+        expired.next = &expired;
+
+        while (head.next != &head) {
+            Timer& timer = *head.next;
+            unlink(timer);
+            link(expired, timer);
+        }
+
+        while (expired.next != &expired) {
+            Timer& timer = *expired.next;
+            unlink(timer);
+
+            if (timer.deadline > currentTick_) {
+                insert(timer);
+                continue;
+            }
+
+            count_--;
+            fired++;
+            handler_(timer);
+        }
+    }
+
+    return fired;
+}
+
+int TimingWheel::getPollTimeout(Clock::time_point now) const {
+    if (count_ == 0) {
+        return -1;
+    }
+
+    // Sleep until the next occupied inner slot, or until the inner wheel
+    // wraps and the outer wheels have to cascade.
+    uint64_t tick = currentTick_ + 1;
+    uint64_t wrap = (currentTick_ | (SLOTS - 1)) + 1;
+    while (tick < wrap) {
+        const Timer& head = slots_[0][tick & (SLOTS - 1)];
+        if (head.next != &head) {
+            break;
+        }
+        tick++;
+    }
+
+    Clock::time_point nextTick = start_ + resolution_ * static_cast<Clock::rep>(tick);
+    if (nextTick <= now) {
+        return 0;
+    }
+
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(nextTick - now).count();
+    return static_cast<int>(remaining) + 1;
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,290 @@
+#include "../include/Tls.h"
+#include <winsock2.h>
+
+#ifdef PULSE_BROKER_TLS
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#endif
+
+namespace pulse_broker {
+
+#ifdef PULSE_BROKER_TLS
+
+namespace {
+
+std::string lastError(const std::string& what) {
+    char text[256];
+    ERR_error_string_n(ERR_get_error(), text, sizeof(text));
+    ERR_clear_error();
+    return what + ": " + text;
+}
+
+SSL_CTX* createContext(bool server, bool kernelOffload) {
+    SSL_CTX* context = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+    if (context == nullptr) {
+        return nullptr;
+    }
+
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_options(context, SSL_OP_NO_RENEGOTIATION);
+#ifdef SSL_OP_ENABLE_KTLS
+    if (kernelOffload) {
+        SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+    }
+#else
+    (void)kernelOffload;
+#endif
+
+    // Queued output is retried from wherever the last write stopped, which
+    // is not the buffer the write started from.
+    SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    return context;
+}
+
+bool useSelfSigned(SSL_CTX* context) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* certificate = X509_new();
+    bool ok = key != nullptr && certificate != nullptr;
+
+    if (ok) {
+        X509_set_version(certificate, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+        X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+        X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 60 * 60);
+        X509_set_pubkey(certificate, key);
+
+        X509_NAME* name = X509_get_subject_name(certificate);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"),
+                                   -1, -1, 0);
+        X509_set_issuer_name(certificate, name);
+
+        ok = X509_sign(certificate, key, EVP_sha256()) > 0 && SSL_CTX_use_certificate(context, certificate) == 1 &&
+             SSL_CTX_use_PrivateKey(context, key) == 1;
+    }
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+} // namespace
+
+bool TlsContext::isAvailable() {
+    return true;
+}
+
+bool TlsContext::isKernelOffloadAvailable() {
+#if defined(_WIN32) || defined(OPENSSL_NO_KTLS) || !defined(SSL_OP_ENABLE_KTLS)
+    return false;
+#else
+    return true;
+#endif
+}
+
+std::shared_ptr<TlsContext> TlsContext::createServer(const std::string& certFile, const std::string& keyFile,
+                                                     bool kernelOffload, std::string& error) {
+    SSL_CTX* context = createContext(true, kernelOffload);
+    if (context == nullptr) {
+        error = lastError("Cannot create TLS context");
+        return nullptr;
+    }
+
+    if (SSL_CTX_use_certificate_chain_file(context, certFile.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(context, keyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(context) != 1) {
+        error = lastError("Cannot load " + certFile + " and " + keyFile);
+        SSL_CTX_free(context);
+        return nullptr;
+    }
+
+    return std::shared_ptr<TlsContext>(new TlsContext(context, true));
+}
+
+std::shared_ptr<TlsContext> TlsContext::createSelfSigned(bool kernelOffload, std::string& error) {
+    SSL_CTX* context = createContext(true, kernelOffload);
+    if (context == nullptr || !useSelfSigned(context)) {
+        error = lastError("Cannot create self-signed TLS context");
+        SSL_CTX_free(context);
+        return nullptr;
+    }
+
+    return std::shared_ptr<TlsContext>(new TlsContext(context, true));
+}
+
+std::shared_ptr<TlsContext> TlsContext::createClient(bool kernelOffload, std::string& error) {
+    SSL_CTX* context = createContext(false, kernelOffload);
+    if (context == nullptr) {
+        error = lastError("Cannot create TLS context");
+        return nullptr;
+    }
+
+    SSL_CTX_set_verify(context, SSL_VERIFY_NONE, nullptr);
+    return std::shared_ptr<TlsContext>(new TlsContext(context, false));
+}
+
+TlsContext::TlsContext(ssl_ctx_st* context, bool server) : context_(context), server_(server) {
+}
+
+TlsContext::~TlsContext() {
+    SSL_CTX_free(context_);
+}
+
+std::unique_ptr<TlsSession> TlsContext::createSession(int socket) const {
+    SSL* ssl = SSL_new(context_);
+    if (ssl == nullptr) {
+        ERR_clear_error();
+        return nullptr;
+    }
+
+    if (SSL_set_fd(ssl, socket) != 1) {
+        ERR_clear_error();
+        SSL_free(ssl);
+        return nullptr;
+    }
+
+    if (server_) {
+        SSL_set_accept_state(ssl);
+    } else {
+        SSL_set_connect_state(ssl);
+    }
+    return std::unique_ptr<TlsSession>(new TlsSession(ssl));
+}
+
+TlsSession::TlsSession(ssl_st* ssl) : ssl_(ssl) {
+}
+
+TlsSession::~TlsSession() {
+    SSL_free(ssl_);
+}
+
+bool TlsSession::isEstablished() const {
+    return SSL_is_init_finished(ssl_) == 1;
+}
+
+bool TlsSession::isKernelSend() const {
+#ifdef BIO_get_ktls_send
+    return isEstablished() && BIO_get_ktls_send(SSL_get_wbio(ssl_));
+#else
+    return false;
+#endif
+}
+
+bool TlsSession::isKernelReceive() const {
+#ifdef BIO_get_ktls_recv
+    return isEstablished() && BIO_get_ktls_recv(SSL_get_rbio(ssl_));
+#else
+    return false;
+#endif
+}
+
+bool TlsSession::connect() {
+    ERR_clear_error();
+    bool connected = SSL_connect(ssl_) == 1;
+    ERR_clear_error();
+    return connected;
+}
+
+int TlsSession::read(char* buffer, size_t size) {
+    ERR_clear_error();
+    return result(SSL_read(ssl_, buffer, static_cast<int>(size)));
+}
+
+// Output queued before the handshake finishes waits for it rather than
+// driving it from the write side.
+int TlsSession::write(const char* data, size_t size) {
+    if (!isEstablished()) {
+        WSASetLastError(WSAEWOULDBLOCK);
+        return SOCKET_ERROR;
+    }
+
+    ERR_clear_error();
+    return result(SSL_write(ssl_, data, static_cast<int>(size)));
+}
+
+int TlsSession::result(int returned) {
+    if (returned > 0) {
+        return returned;
+    }
+
+    int error = SSL_get_error(ssl_, returned);
+    ERR_clear_error();
+    if (error == SSL_ERROR_ZERO_RETURN) {
+        return 0;
+    }
+    WSASetLastError(error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE ? WSAEWOULDBLOCK : WSAECONNRESET);
+    return SOCKET_ERROR;
+}
+
+#else
+
+namespace {
+const char NOT_BUILT[] = "TLS support is not built in (configure with -DPULSE_BROKER_TLS=ON)";
+}
+
+bool TlsContext::isAvailable() {
+    return false;
+}
+
+bool TlsContext::isKernelOffloadAvailable() {
+    return false;
+}
+
+std::shared_ptr<TlsContext> TlsContext::createServer(const std::string&, const std::string&, bool,
+                                                     std::string& error) {
+    error = NOT_BUILT;
+    return nullptr;
+}
+
+std::shared_ptr<TlsContext> TlsContext::createSelfSigned(bool, std::string& error) {
+    error = NOT_BUILT;
+    return nullptr;
+}
+
+std::shared_ptr<TlsContext> TlsContext::createClient(bool, std::string& error) {
+    error = NOT_BUILT;
+    return nullptr;
+}
+
+TlsContext::~TlsContext() {
+}
+
+std::unique_ptr<TlsSession> TlsContext::createSession(int) const {
+    return nullptr;
+}
+
+TlsSession::~TlsSession() {
+}
+
+bool TlsSession::isEstablished() const {
+    return false;
+}
+
+bool TlsSession::isKernelSend() const {
+    return false;
+}
+
+bool TlsSession::isKernelReceive() const {
+    return false;
+}
+
+bool TlsSession::connect() {
+    return false;
+}
+
+int TlsSession::read(char*, size_t) {
+    WSASetLastError(WSAECONNRESET);
+    return SOCKET_ERROR;
+}
+
+int TlsSession::write(const char*, size_t) {
+    WSASetLastError(WSAECONNRESET);
+    return SOCKET_ERROR;
+}
+
+#endif
+
+const size_t TlsSession::MAX_RECORD_SIZE;
+
+} // namespace pulse_broker
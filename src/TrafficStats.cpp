@@ -0,0 +1,392 @@
+#include "../include/TrafficStats.h"
+#include "../include/LockStats.h"
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <unordered_set>
+
+namespace pulse_broker {
+
+namespace {
+
+// FNV-1a with a final avalanche so both halves are usable for double hashing.
+uint64_t hashKey(const char* data, size_t size) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+void appendJsonString(std::ostringstream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void appendEntries(std::ostringstream& out, const char* name, const std::vector<TrafficEntry>& entries) {
+    out << '"' << name << "\":[";
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i > 0) {
+            out << ',';
+        }
+        out << "{\"key\":";
+        appendJsonString(out, entries[i].key);
+        out << ",\"msgs\":" << entries[i].messages << ",\"bytes\":" << entries[i].bytes << '}';
+    }
+    out << ']';
+}
+
+void appendWindow(std::ostringstream& out, const TrafficWindowReport& window) {
+    out << "{\"complete\":" << (window.complete ? "true" : "false")
+        << ",\"msgs\":" << window.messages << ",\"bytes\":" << window.bytes << ',';
+    appendEntries(out, "subjects_by_msgs", window.subjectsByMessages);
+    out << ',';
+    appendEntries(out, "subjects_by_bytes", window.subjectsByBytes);
+    out << ',';
+    appendEntries(out, "publishers_by_msgs", window.publishersByMessages);
+    out << ',';
+    appendEntries(out, "publishers_by_bytes", window.publishersByBytes);
+    out << '}';
+}
+
+} // namespace
+
+CountMinSketch::CountMinSketch(size_t width)
+    : mask_(roundUpToPowerOfTwo(width > 0 ? width : 1) - 1),
+      cells_(DEPTH * (mask_ + 1), Cell{0, 0}) {
+}
+
+size_t CountMinSketch::index(uint64_t hash, size_t row) const {
+    uint64_t low = hash & 0xFFFFFFFFULL;
+    uint64_t high = (hash >> 32) | 1;
+    return row * (mask_ + 1) + static_cast<size_t>((low + row * high) & mask_);
+}
+
+void CountMinSketch::add(uint64_t hash, uint64_t messages, uint64_t bytes) {
+    for (size_t row = 0; row < DEPTH; row++) {
+        Cell& cell = cells_[index(hash, row)];
+        cell.messages += messages;
+        cell.bytes += bytes;
+    }
+}
+
+TrafficCounts CountMinSketch::estimate(uint64_t hash) const {
+    TrafficCounts counts;
+    counts.messages = UINT64_MAX;
+    counts.bytes = UINT64_MAX;
+
+    for (size_t row = 0; row < DEPTH; row++) {
+        const Cell& cell = cells_[index(hash, row)];
+        counts.messages = std::min(counts.messages, cell.messages);
+        counts.bytes = std::min(counts.bytes, cell.bytes);
+    }
+    return counts;
+}
+
+void CountMinSketch::merge(const CountMinSketch& other) {
+    if (other.cells_.size() != cells_.size()) {
+        return;
+    }
+
+    for (size_t i = 0; i < cells_.size(); i++) {
+        cells_[i].messages += other.cells_[i].messages;
+        cells_[i].bytes += other.cells_[i].bytes;
+    }
+}
+
+void CountMinSketch::clear() {
+    std::fill(cells_.begin(), cells_.end(), Cell{0, 0});
+}
+
+HeavyHitters::HeavyHitters(size_t capacity)
+    : capacity_(capacity > 0 ? capacity : 1), minScore_(0) {
+    candidates_.reserve(capacity_);
+}
+
+void HeavyHitters::offer(uint64_t hash, const char* key, size_t keySize, uint64_t score) {
+    // Scores only grow, so a key at or below the minimum of a full list is
+    // either absent and not admitted or already present with that score.
+    if (candidates_.size() == capacity_ && score <= minScore_) {
+        return;
+    }
+
+    size_t minIndex = 0;
+
+    for (size_t i = 0; i < candidates_.size(); i++) {
+        Candidate& candidate = candidates_[i];
+        if (candidate.hash == hash && candidate.key.compare(0, std::string::npos, key, keySize) == 0) {
+            bool wasMinimum = candidate.score == minScore_;
+            candidate.score = score;
+            if (wasMinimum && candidates_.size() == capacity_) {
+                updateMinScore();
+            }
+            return;
+        }
+        if (candidate.score < candidates_[minIndex].score) {
+            minIndex = i;
+        }
+    }
+
+    if (candidates_.size() < capacity_) {
+        candidates_.push_back(Candidate{hash, std::string(key, keySize), score});
+        if (candidates_.size() == capacity_) {
+            updateMinScore();
+        }
+        return;
+    }
+
+    Candidate& victim = candidates_[minIndex];
+    victim.hash = hash;
+    victim.key.assign(key, keySize);
+    victim.score = score;
+    updateMinScore();
+}
+
+void HeavyHitters::updateMinScore() {
+    minScore_ = UINT64_MAX;
+    for (const auto& candidate : candidates_) {
+        minScore_ = std::min(minScore_, candidate.score);
+    }
+}
+
+void HeavyHitters::clear() {
+    candidates_.clear();
+    minScore_ = 0;
+}
+
+struct TrafficStats::Dimension {
+    CountMinSketch sketch;
+    HeavyHitters byMessages;
+    HeavyHitters byBytes;
+
+    Dimension(size_t width, size_t candidates)
+        : sketch(width), byMessages(candidates), byBytes(candidates) {
+    }
+
+    void add(const char* key, size_t keySize, size_t bytes) {
+        uint64_t hash = hashKey(key, keySize);
+        sketch.add(hash, 1, bytes);
+
+        TrafficCounts counts = sketch.estimate(hash);
+        byMessages.offer(hash, key, keySize, counts.messages);
+        byBytes.offer(hash, key, keySize, counts.bytes);
+    }
+
+    void clear() {
+        sketch.clear();
+        byMessages.clear();
+        byBytes.clear();
+    }
+};
+
+struct TrafficStats::Window {
+    uint64_t epoch;
+    uint64_t messages;
+    uint64_t bytes;
+    Dimension subjects;
+    Dimension publishers;
+
+    Window(size_t width, size_t candidates)
+        : epoch(0), messages(0), bytes(0), subjects(width, candidates), publishers(width, candidates) {
+    }
+
+    void reset(uint64_t newEpoch) {
+        epoch = newEpoch;
+        messages = 0;
+        bytes = 0;
+        subjects.clear();
+        publishers.clear();
+    }
+};
+
+struct TrafficStats::Shard {
+    BrokerMutex mutex{"TrafficStats::Shard::mutex"};
+    std::unique_ptr<Window> current;
+    std::unique_ptr<Window> previous;
+};
+
+TrafficStats::TrafficStats(std::chrono::milliseconds window, size_t topK, size_t sketchWidth, Clock::time_point start)
+    : window_(window.count() > 0 ? window : std::chrono::milliseconds(1)),
+      topK_(topK > 0 ? topK : 1), sketchWidth_(sketchWidth), start_(start) {
+    // Each shard tracks twice as many candidates as it reports so keys that
+    // are only heavy once shards are merged still make the final list.
+    for (size_t i = 0; i < SHARDS; i++) {
+        std::unique_ptr<Shard> shard(new Shard());
+        shard->current.reset(new Window(sketchWidth_, 2 * topK_));
+        shard->previous.reset(new Window(sketchWidth_, 2 * topK_));
+        shard->previous->epoch = UINT64_MAX;
+        shards_.push_back(std::move(shard));
+    }
+}
+
+TrafficStats::~TrafficStats() = default;
+
+uint64_t TrafficStats::epochAt(Clock::time_point now) const {
+    if (now <= start_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((now - start_) / window_);
+}
+
+TrafficStats::Shard& TrafficStats::currentShard() {
+    static std::atomic<size_t> nextShard(0);
+    thread_local size_t shardIndex = nextShard++;
+    return *shards_[shardIndex % SHARDS];
+}
+
+// Threads share shards and read the clock before taking the lock, so a
+// stale epoch can arrive after the shard has moved on. It is counted into
+// the current window rather than rotating backwards.
+void TrafficStats::rotate(Shard& shard, uint64_t epoch) {
+    if (epoch <= shard.current->epoch) {
+        return;
+    }
+
+    if (shard.current->epoch + 1 == epoch) {
+        std::swap(shard.current, shard.previous);
+    } else {
+        shard.previous->reset(epoch - 1);
+    }
+    shard.current->reset(epoch);
+}
+
+void TrafficStats::record(const std::string& subject, const char* publisher, size_t publisherSize, size_t bytes,
+                          Clock::time_point now) {
+    uint64_t epoch = epochAt(now);
+    Shard& shard = currentShard();
+
+    std::lock_guard<BrokerMutex> lock(shard.mutex);
+    rotate(shard, epoch);
+
+    Window& window = *shard.current;
+    window.messages++;
+    window.bytes += bytes;
+    window.subjects.add(subject.data(), subject.size(), bytes);
+    window.publishers.add(publisher, publisherSize, bytes);
+}
+
+TrafficReport TrafficStats::getReport(Clock::time_point now) {
+    uint64_t epoch = epochAt(now);
+
+    // Shards are copied under their own lock and merged afterwards, so a
+    // report holds up each publishing thread for one copy at most.
+    std::vector<std::unique_ptr<Window>> snapshots;
+
+    for (auto& shard : shards_) {
+        std::lock_guard<BrokerMutex> lock(shard->mutex);
+        rotate(*shard, epoch);
+
+        snapshots.emplace_back(new Window(*shard->current));
+        snapshots.emplace_back(new Window(*shard->previous));
+    }
+
+    std::vector<const Window*> currentWindows;
+    std::vector<const Window*> previousWindows;
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        (i % 2 == 0 ? currentWindows : previousWindows).push_back(snapshots[i].get());
+    }
+
+    TrafficReport report;
+    report.windowMs = static_cast<uint64_t>(window_.count());
+    report.current = buildReport(currentWindows, false);
+    report.previous = buildReport(previousWindows, true);
+    return report;
+}
+
+TrafficWindowReport TrafficStats::buildReport(const std::vector<const Window*>& windows, bool complete) const {
+    TrafficWindowReport report;
+    report.complete = complete;
+
+    CountMinSketch subjects(sketchWidth_);
+    CountMinSketch publishers(sketchWidth_);
+    std::vector<const HeavyHitters::Candidate*> subjectCandidates;
+    std::vector<const HeavyHitters::Candidate*> publisherCandidates;
+
+    for (const Window* window : windows) {
+        report.messages += window->messages;
+        report.bytes += window->bytes;
+        subjects.merge(window->subjects.sketch);
+        publishers.merge(window->publishers.sketch);
+
+        for (const auto& candidate : window->subjects.byMessages.getCandidates()) subjectCandidates.push_back(&candidate);
+        for (const auto& candidate : window->subjects.byBytes.getCandidates()) subjectCandidates.push_back(&candidate);
+        for (const auto& candidate : window->publishers.byMessages.getCandidates()) publisherCandidates.push_back(&candidate);
+        for (const auto& candidate : window->publishers.byBytes.getCandidates()) publisherCandidates.push_back(&candidate);
+    }
+
+    auto rank = [this](const CountMinSketch& sketch, const std::vector<const HeavyHitters::Candidate*>& candidates,
+                       std::vector<TrafficEntry>& byMessages, std::vector<TrafficEntry>& byBytes) {
+        std::unordered_set<std::string> seen;
+        std::vector<TrafficEntry> entries;
+
+        for (const auto* candidate : candidates) {
+            if (!seen.insert(candidate->key).second) {
+                continue;
+            }
+
+            TrafficCounts counts = sketch.estimate(candidate->hash);
+            TrafficEntry entry;
+            entry.key = candidate->key;
+            entry.messages = counts.messages;
+            entry.bytes = counts.bytes;
+            entries.push_back(entry);
+        }
+
+        byMessages = entries;
+        std::sort(byMessages.begin(), byMessages.end(),
+            [](const TrafficEntry& a, const TrafficEntry& b) { return a.messages > b.messages; });
+        if (byMessages.size() > topK_) {
+            byMessages.resize(topK_);
+        }
+
+        byBytes = entries;
+        std::sort(byBytes.begin(), byBytes.end(),
+            [](const TrafficEntry& a, const TrafficEntry& b) { return a.bytes > b.bytes; });
+        if (byBytes.size() > topK_) {
+            byBytes.resize(topK_);
+        }
+    };
+
+    rank(subjects, subjectCandidates, report.subjectsByMessages, report.subjectsByBytes);
+    rank(publishers, publisherCandidates, report.publishersByMessages, report.publishersByBytes);
+    return report;
+}
+
+size_t TrafficStats::getMemoryUsage() const {
+    size_t sketchBytes = CountMinSketch::DEPTH * shards_.front()->current->subjects.sketch.getWidth() * 2 * sizeof(uint64_t);
+    return SHARDS * 2 * (sizeof(Window) + 2 * sketchBytes);
+}
+
+std::string TrafficStats::toJson(const TrafficReport& report) {
+    std::ostringstream out;
+    out << "{\"window_ms\":" << report.windowMs << ",\"current\":";
+    appendWindow(out, report.current);
+    out << ",\"previous\":";
+    appendWindow(out, report.previous);
+    out << '}';
+    return out.str();
+}
+
+} // namespace pulse_broker
@@ -0,0 +1,330 @@
+#include "../include/WorkQueue.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace pulse_broker {
+
+namespace {
+
+// Reads the integer after "key": in a flat JSON object. Returns false if the
+// key is present but its value is not a number.
+bool readNumber(const std::string& text, const char* key, long& value) {
+    size_t position = text.find(key);
+    if (position == std::string::npos) {
+        return true;
+    }
+
+    size_t colon = text.find_first_not_of(" \t", position + std::char_traits<char>::length(key));
+    if (colon == std::string::npos || text[colon] != ':') {
+        return false;
+    }
+
+    const char* start = text.c_str() + colon + 1;
+    char* end = nullptr;
+    value = std::strtol(start, &end, 10);
+    return end != start;
+}
+
+} // namespace
+
+const int WorkQueues::RESOLUTION_MS;
+
+WorkQueues::WorkQueues(const std::vector<WorkQueueConfig>& configs, Clock::time_point start)
+    : timers_(std::chrono::milliseconds(RESOLUTION_MS),
+              [this](TimingWheel::Timer& timer) { expired_.push_back(static_cast<Deadline*>(&timer)); }, start),
+      nextSequence_(1), pending_(0), waiting_(0), bytes_(0) {
+    for (const auto& config : configs) {
+        if (config.maxMessages > 0 && config.ackWaitMs > 0) {
+            configs_.push_back(config);
+        }
+    }
+}
+
+WorkQueues::~WorkQueues() {
+    clear();
+}
+
+const WorkQueueConfig* WorkQueues::configFor(const std::string& subject) const {
+    for (const auto& config : configs_) {
+        if (subject.compare(0, config.prefix.size(), config.prefix) == 0) {
+            return &config;
+        }
+    }
+    return nullptr;
+}
+
+// nullptr if subject is not a work-queue subject.
+WorkQueues::Queue* WorkQueues::queueFor(const std::string& subject) {
+    const WorkQueueConfig* config = configFor(subject);
+    if (config == nullptr) {
+        return nullptr;
+    }
+
+    auto& slot = queues_[subject];
+    if (!slot) {
+        slot.reset(new Queue());
+        slot->subject = subject;
+        slot->config = config;
+    }
+    return slot.get();
+}
+
+size_t WorkQueues::footprint(const WorkMessage& message) {
+    return sizeof(WorkMessage) + sizeof(std::string) + message.payload->size();
+}
+
+bool WorkQueues::push(const std::string& subject, const char* payload, size_t payloadSize,
+                      std::vector<WorkBatch>& ready) {
+    Queue* slot = queueFor(subject);
+    if (slot == nullptr) {
+        return false;
+    }
+
+    Queue& queue = *slot;
+    if (queue.pending.size() + queue.inFlight >= queue.config->maxMessages) {
+        return false;
+    }
+
+    WorkMessage message;
+    message.sequence = nextSequence_++;
+    message.payload = std::make_shared<const std::string>(payload, payloadSize);
+    bytes_ += footprint(message);
+    queue.pending.push_back(std::move(message));
+    pending_++;
+
+    serve(queue, ready);
+    return true;
+}
+
+bool WorkQueues::fetch(const std::string& subject, const std::string& inbox, const FetchRequest& request,
+                       std::vector<WorkBatch>& ready) {
+    Queue* slot = queueFor(subject);
+    if (slot == nullptr) {
+        return false;
+    }
+
+    Queue& queue = *slot;
+    queue.waiting.emplace_back(&queue, inbox, request.batch > 0 ? request.batch : 1);
+    waiting_++;
+    serve(queue, ready);
+
+    // Fetches are served in arrival order, so this one is still waiting
+    // exactly when the list is not empty.
+    if (!queue.waiting.empty()) {
+        if (request.expiresMs > 0) {
+            timers_.schedule(queue.waiting.back(), std::chrono::milliseconds(request.expiresMs));
+        } else {
+            queue.waiting.pop_back();
+            waiting_--;
+            ready.push_back(WorkBatch{subject, inbox, {}});
+        }
+    }
+    return true;
+}
+
+void WorkQueues::serve(Queue& queue, std::vector<WorkBatch>& ready) {
+    while (!queue.waiting.empty() && !queue.pending.empty()) {
+        Waiting& fetch = queue.waiting.front();
+        timers_.cancel(fetch);
+
+        WorkBatch batch;
+        batch.subject = queue.subject;
+        batch.inbox = fetch.inbox;
+        while (batch.messages.size() < fetch.batch && !queue.pending.empty()) {
+            WorkMessage message = std::move(queue.pending.front());
+            queue.pending.pop_front();
+            pending_--;
+            message.deliveries++;
+            batch.messages.push_back(message);
+
+            std::unique_ptr<InFlight> delivered(new InFlight(&queue, std::move(message)));
+            timers_.schedule(*delivered, std::chrono::milliseconds(queue.config->ackWaitMs));
+            queue.inFlight++;
+            inFlight_[delivered->message.sequence] = std::move(delivered);
+        }
+
+        queue.waiting.pop_front();
+        waiting_--;
+        ready.push_back(std::move(batch));
+    }
+}
+
+bool WorkQueues::ack(uint64_t sequence) {
+    auto it = inFlight_.find(sequence);
+    if (it == inFlight_.end()) {
+        return false;
+    }
+
+    InFlight& delivered = *it->second;
+    timers_.cancel(delivered);
+    delivered.queue->inFlight--;
+    bytes_ -= footprint(delivered.message);
+    inFlight_.erase(it);
+    return true;
+}
+
+bool WorkQueues::nak(uint64_t sequence, std::vector<WorkBatch>& ready) {
+    auto it = inFlight_.find(sequence);
+    if (it == inFlight_.end()) {
+        return false;
+    }
+
+    Queue& queue = *it->second->queue;
+    requeue(*it->second);
+    serve(queue, ready);
+    return true;
+}
+
+void WorkQueues::requeue(InFlight& delivered) {
+    Queue& queue = *delivered.queue;
+    timers_.cancel(delivered);
+    queue.inFlight--;
+    queue.pending.push_front(std::move(delivered.message));
+    pending_++;
+    inFlight_.erase(queue.pending.front().sequence);
+}
+
+void WorkQueues::advance(Clock::time_point now, std::vector<WorkBatch>& ready) {
+    expired_.clear();
+    timers_.advance(now);
+    if (expired_.empty()) {
+        return;
+    }
+
+    // Expired fetches leave their lists before any queue is served, since
+    // serving pops fetches that may still be in expired_. Their entries are
+    // cleared, as erasing them freed the deadline.
+    std::vector<Queue*> requeued;
+    for (Deadline*& deadline : expired_) {
+        Queue& queue = *deadline->queue;
+        if (deadline->kind == Deadline::FETCH) {
+            for (auto it = queue.waiting.begin(); it != queue.waiting.end(); ++it) {
+                if (&*it == deadline) {
+                    ready.push_back(WorkBatch{queue.subject, it->inbox, {}});
+                    queue.waiting.erase(it);
+                    waiting_--;
+                    break;
+                }
+            }
+            deadline = nullptr;
+        }
+    }
+
+    for (Deadline* deadline : expired_) {
+        if (deadline != nullptr) {
+            requeued.push_back(deadline->queue);
+            requeue(static_cast<InFlight&>(*deadline));
+        }
+    }
+    expired_.clear();
+
+    for (Queue* queue : requeued) {
+        serve(*queue, ready);
+    }
+}
+
+void WorkQueues::clear() {
+    for (auto& pair : inFlight_) {
+        timers_.cancel(*pair.second);
+    }
+    for (auto& pair : queues_) {
+        for (auto& fetch : pair.second->waiting) {
+            timers_.cancel(fetch);
+        }
+    }
+
+    inFlight_.clear();
+    queues_.clear();
+    expired_.clear();
+    pending_ = 0;
+    waiting_ = 0;
+    bytes_ = 0;
+}
+
+int WorkQueues::remainingMs(const TimingWheel::Timer& timer) const {
+    uint64_t current = timers_.getCurrentTick();
+    uint64_t ticks = timer.deadline > current ? timer.deadline - current : 1;
+    return static_cast<int>(ticks * RESOLUTION_MS);
+}
+
+void WorkQueues::save(WorkQueueState& state) const {
+    state.nextSequence = nextSequence_;
+
+    for (const auto& pair : queues_) {
+        const Queue& queue = *pair.second;
+        for (const auto& message : queue.pending) {
+            state.messages.push_back(WorkQueueState::Message{queue.subject, message, -1});
+        }
+        for (const auto& fetch : queue.waiting) {
+            state.fetches.push_back(WorkQueueState::Fetch{queue.subject, fetch.inbox, fetch.batch, remainingMs(fetch)});
+        }
+    }
+
+    for (const auto& pair : inFlight_) {
+        const InFlight& delivered = *pair.second;
+        state.messages.push_back(
+            WorkQueueState::Message{delivered.queue->subject, delivered.message, remainingMs(delivered)});
+    }
+}
+
+// A consistent state never has messages queued while fetches wait on the
+// same subject, so nothing needs serving here.
+void WorkQueues::restore(const WorkQueueState& state) {
+    nextSequence_ = std::max(nextSequence_, state.nextSequence);
+
+    for (const auto& entry : state.messages) {
+        Queue* queue = queueFor(entry.subject);
+        if (queue == nullptr || !entry.message.payload) {
+            continue;
+        }
+
+        bytes_ += footprint(entry.message);
+        if (entry.ackWaitMs < 0) {
+            queue->pending.push_back(entry.message);
+            pending_++;
+            continue;
+        }
+
+        std::unique_ptr<InFlight> delivered(new InFlight(queue, entry.message));
+        timers_.schedule(*delivered, std::chrono::milliseconds(entry.ackWaitMs));
+        queue->inFlight++;
+        inFlight_[entry.message.sequence] = std::move(delivered);
+    }
+
+    for (const auto& fetch : state.fetches) {
+        Queue* queue = queueFor(fetch.subject);
+        if (queue == nullptr) {
+            continue;
+        }
+
+        queue->waiting.emplace_back(queue, fetch.inbox, fetch.batch);
+        timers_.schedule(queue->waiting.back(), std::chrono::milliseconds(fetch.expiresMs));
+        waiting_++;
+    }
+}
+
+bool WorkQueues::parseFetchRequest(const char* payload, size_t payloadSize, FetchRequest& request) {
+    request = FetchRequest();
+
+    std::string text(payload != nullptr ? payload : "", payload != nullptr ? payloadSize : 0);
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return true;
+    }
+    if (text[start] != '{') {
+        return false;
+    }
+
+    long batch = 1;
+    long expires = 0;
+    if (!readNumber(text, "\"batch\"", batch) || !readNumber(text, "\"expires\"", expires) || batch <= 0 ||
+        expires < 0) {
+        return false;
+    }
+
+    request.batch = static_cast<size_t>(batch);
+    request.expiresMs = static_cast<int>(expires);
+    return true;
+}
+
+} // namespace pulse_broker
@@ -2,11 +2,36 @@
 #include <iostream>
 #include <csignal>
 #include <string>
+#include <vector>
 
 using namespace pulse_broker;
 
 static NATSServer* server = nullptr;
 
+// Parses "<msgs/s>[:<bytes/s>]".
+static bool parseRateLimit(const std::string& value, RateLimit& limit) {
+    try {
+        size_t colon = value.find(':');
+        limit.messagesPerSecond = std::stod(value.substr(0, colon));
+        limit.bytesPerSecond = colon == std::string::npos ? 0 : std::stod(value.substr(colon + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return limit.messagesPerSecond >= 0 && limit.bytesPerSecond >= 0;
+}
+
+// The account called name, added on first use.
+static AccountConfig& accountConfig(std::vector<AccountConfig>& accounts, const std::string& name) {
+    for (auto& account : accounts) {
+        if (account.name == name) {
+            return account;
+        }
+    }
+    accounts.push_back(AccountConfig());
+    accounts.back().name = name;
+    return accounts.back();
+}
+
 void signalHandler(int signal) {
     if (server) {
         std::cout << "Received signal " << signal << ", shutting down..." << std::endl;
@@ -15,31 +40,282 @@ void signalHandler(int signal) {
 }
 
 int main(int argc, char* argv[]) {
-    std::string host = "0.0.0.0";
-    int port = 4222;
+    ServerOptions options;
+    std::vector<std::string> sharedMemoryRings;
+    std::string tlsCertFile;
+    std::string tlsKeyFile;
+    bool kernelTls = true;
     
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "--host" && i + 1 < argc) {
-            host = argv[++i];
+            options.host = argv[++i];
         } else if (arg == "--port" && i + 1 < argc) {
             try {
-                port = std::stoi(argv[++i]);
+                options.port = std::stoi(argv[++i]);
             } catch (const std::exception&) {
                 std::cerr << "Invalid port number: " << argv[i] << std::endl;
                 return 1;
             }
+        } else if (arg == "--unix" && i + 1 < argc) {
+            options.unixSocketPath = argv[++i];
+        } else if (arg == "--io-threads" && i + 1 < argc) {
+            try {
+                options.ioThreads = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid I/O thread count: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if ((arg == "--ping-interval" || arg == "--max-pings-out" || arg == "--connect-timeout") && i + 1 < argc) {
+            int value;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                return 1;
+            }
+
+            if (arg == "--ping-interval") {
+                options.pingIntervalMs = value * 1000;
+            } else if (arg == "--max-pings-out") {
+                options.maxPingsOutstanding = value;
+            } else {
+                options.connectTimeoutMs = value * 1000;
+            }
+        } else if (arg == "--stats-window" && i + 1 < argc) {
+            try {
+                options.trafficWindowMs = std::stoi(argv[++i]) * 1000;
+            } catch (const std::exception&) {
+                std::cerr << "Invalid stats window: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--max-payload" && i + 1 < argc) {
+            long long value = 0;
+            try {
+                value = std::stoll(argv[++i]);
+            } catch (const std::exception&) {
+            }
+            if (value <= 0) {
+                std::cerr << "Invalid max payload: " << argv[i] << std::endl;
+                return 1;
+            }
+            options.maxPayload = static_cast<size_t>(value);
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            long long value = 0;
+            try {
+                value = std::stoll(argv[++i]);
+            } catch (const std::exception&) {
+            }
+            if (value <= 0) {
+                std::cerr << "Invalid memory budget: " << argv[i] << std::endl;
+                return 1;
+            }
+            options.memoryBudget = static_cast<size_t>(value) * 1024 * 1024;
+        } else if ((arg == "--fanout-threshold" || arg == "--fanout-threads") && i + 1 < argc) {
+            int value;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                return 1;
+            }
+
+            if (arg == "--fanout-threshold") {
+                options.fanoutThreshold = value > 0 ? static_cast<size_t>(value) : 0;
+            } else {
+                options.fanoutThreads = value;
+            }
+        } else if (arg == "--client-rate" && i + 1 < argc) {
+            if (!parseRateLimit(argv[++i], options.clientRateLimit)) {
+                std::cerr << "Invalid client rate limit: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--subject-rate" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t equals = value.find('=');
+            SubjectRateLimit limit;
+            if (equals == std::string::npos || equals == 0 || !parseRateLimit(value.substr(equals + 1), limit.limit)) {
+                std::cerr << "Invalid subject rate limit: " << value << std::endl;
+                return 1;
+            }
+            limit.prefix = value.substr(0, equals);
+            options.subjectRateLimits.push_back(limit);
+        } else if ((arg == "--account" || arg == "--export" || arg == "--import") && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t equals = value.find('=');
+            if (equals == std::string::npos || equals == 0 || equals + 1 == value.size()) {
+                std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+                return 1;
+            }
+
+            AccountConfig& account = accountConfig(options.accounts, value.substr(0, equals));
+            std::string rest = value.substr(equals + 1);
+            if (arg == "--account") {
+                size_t start = 0;
+                while (start <= rest.size()) {
+                    size_t comma = rest.find(',', start);
+                    size_t end = comma == std::string::npos ? rest.size() : comma;
+                    account.users.push_back(rest.substr(start, end - start));
+                    if (comma == std::string::npos) {
+                        break;
+                    }
+                    start = comma + 1;
+                }
+            } else if (arg == "--export") {
+                account.exports.push_back(rest);
+            } else {
+                size_t colon = rest.find(':');
+                if (colon == std::string::npos || colon == 0) {
+                    std::cerr << "Invalid import: " << value << std::endl;
+                    return 1;
+                }
+                AccountImport import;
+                import.account = rest.substr(0, colon);
+                import.prefix = rest.substr(colon + 1);
+                account.imports.push_back(import);
+            }
+        } else if (arg == "--map" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t equals = value.find('=');
+            SubjectMappingRule rule;
+            rule.source = value.substr(0, equals);
+            rule.destination = equals != std::string::npos ? value.substr(equals + 1) : std::string();
+            std::string error = "expected <source>=<destination>";
+            if (equals == std::string::npos || !SubjectMapper::validate(rule, error)) {
+                std::cerr << "Invalid subject mapping " << value << ": " << error << std::endl;
+                return 1;
+            }
+            options.subjectMappings.push_back(rule);
+        } else if (arg == "--history" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t equals = value.find('=');
+            int depth = 0;
+            if (equals != std::string::npos && equals > 0) {
+                try {
+                    depth = std::stoi(value.substr(equals + 1));
+                } catch (const std::exception&) {
+                }
+            }
+            if (depth <= 0) {
+                std::cerr << "Invalid subject history: " << value << std::endl;
+                return 1;
+            }
+            SubjectHistoryLimit limit;
+            limit.depth = static_cast<size_t>(depth);
+            limit.prefix = value.substr(0, equals);
+            options.subjectHistory.push_back(limit);
+        } else if (arg == "--work-queue" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t equals = value.find('=');
+            WorkQueueConfig queue;
+            int maxMessages = 0;
+            if (equals != std::string::npos && equals > 0) {
+                std::string limits = value.substr(equals + 1);
+                size_t comma = limits.find(',');
+                try {
+                    maxMessages = std::stoi(limits.substr(0, comma));
+                    if (comma != std::string::npos) {
+                        queue.ackWaitMs = std::stoi(limits.substr(comma + 1));
+                    }
+                } catch (const std::exception&) {
+                    maxMessages = 0;
+                }
+            }
+            if (maxMessages <= 0 || queue.ackWaitMs <= 0) {
+                std::cerr << "Invalid work queue: " << value << std::endl;
+                return 1;
+            }
+            queue.maxMessages = static_cast<size_t>(maxMessages);
+            queue.prefix = value.substr(0, equals);
+            options.workQueues.push_back(queue);
+        } else if (arg == "--rate-limit-action" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "backpressure") {
+                options.rateLimitAction = RateLimitAction::BACKPRESSURE;
+            } else if (value == "reject") {
+                options.rateLimitAction = RateLimitAction::REJECT;
+            } else {
+                std::cerr << "Invalid rate limit action: " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--handoff" && i + 1 < argc) {
+            options.handoffPath = argv[++i];
+        } else if (arg == "--takeover" && i + 1 < argc) {
+            options.takeoverPath = argv[++i];
+        } else if (arg == "--tls-cert" && i + 1 < argc) {
+            tlsCertFile = argv[++i];
+        } else if (arg == "--tls-key" && i + 1 < argc) {
+            tlsKeyFile = argv[++i];
+        } else if (arg == "--no-ktls") {
+            kernelTls = false;
+        } else if (arg == "--no-traffic-stats") {
+            options.trafficStats = false;
+        } else if (arg == "--shm-ring" && i + 1 < argc) {
+            sharedMemoryRings.push_back(argv[++i]);
         } else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
             std::cout << "Options:" << std::endl;
             std::cout << "  --host <host>     Server host (default: 0.0.0.0)" << std::endl;
             std::cout << "  --port <port>     Server port (default: 4222)" << std::endl;
+            std::cout << "  --unix <path>     Also listen on a Unix domain socket" << std::endl;
+            std::cout << "  --io-threads <n>  Number of I/O loop threads (default: CPU count)" << std::endl;
+            std::cout << "  --shm-ring <name> Create a shared memory publish ring (repeatable)" << std::endl;
+            std::cout << "  --ping-interval <s>   Seconds between server PINGs, 0 disables (default: 120)" << std::endl;
+            std::cout << "  --max-pings-out <n>   Unanswered PINGs before a client is dropped (default: 2)" << std::endl;
+            std::cout << "  --connect-timeout <s> Seconds a client has to send CONNECT, 0 disables (default: 10)" << std::endl;
+            std::cout << "  --max-payload <bytes> Largest PUB payload accepted (default: 1048576)" << std::endl;
+            std::cout << "  --memory-budget <MiB> Refuse connections and throttle reads above this much memory" << std::endl;
+            std::cout << "  --stats-window <s>    Traffic analytics window in seconds (default: 60)" << std::endl;
+            std::cout << "  --no-traffic-stats    Disable per-subject and per-client traffic analytics" << std::endl;
+            std::cout << "  --fanout-threshold <n> Subscribers at which delivery is split across threads, 0 disables (default: 1024)" << std::endl;
+            std::cout << "  --fanout-threads <n>  Fan-out worker threads (default: CPU count - 1)" << std::endl;
+            std::cout << "  --client-rate <m>[:<b>]          Per-connection publish limit in msgs/s and bytes/s" << std::endl;
+            std::cout << "  --subject-rate <prefix>=<m>[:<b>] Publish limit for subjects with a prefix (repeatable)" << std::endl;
+            std::cout << "  --rate-limit-action <a>          backpressure (stop reading) or reject (default: backpressure)" << std::endl;
+            std::cout << "  --history <prefix>=<n>           Replay the last n messages of matching subjects on SUB (repeatable)" << std::endl;
+            std::cout << "  --work-queue <prefix>=<n>[,<ms>] Queue up to n messages per subject for pulling workers, redelivered after ms without ack (repeatable)" << std::endl;
+            std::cout << "  --account <name>=<user>[,<user>]  Clients connecting as these users join their own account" << std::endl;
+            std::cout << "  --export <name>=<prefix>         Let other accounts import subjects with a prefix (repeatable)" << std::endl;
+            std::cout << "  --import <name>=<from>:<prefix>  Also deliver the exported subjects of another account (repeatable)" << std::endl;
+            std::cout << "  --map <source>=<destination>     Rewrite published subjects, e.g. orders.*=orders.{{partition(16,1)}} (repeatable)" << std::endl;
+            std::cout << "  --tls-cert <file>  Serve TLS on the TCP listener with this PEM certificate chain" << std::endl;
+            std::cout << "  --tls-key <file>   PEM private key for --tls-cert (default: the certificate file)" << std::endl;
+            std::cout << "  --no-ktls          Keep TLS records in user space instead of offloading them to the kernel" << std::endl;
+            std::cout << "                     (no effect on Windows, which has no kernel TLS)" << std::endl;
+            std::cout << "  --handoff <path>  Hand sockets over to a process started with --takeover on this path" << std::endl;
+            std::cout << "  --takeover <path> Take listening and client sockets over from a running server" << std::endl;
             std::cout << "  --help            Show this help message" << std::endl;
             return 0;
         }
     }
     
-    server = new NATSServer(host, port);
+    std::string accountError;
+    if (!Accounts::validate(options.accounts, accountError)) {
+        std::cerr << "Invalid accounts: " << accountError << std::endl;
+        return 1;
+    }
+
+    if (!tlsCertFile.empty() || !tlsKeyFile.empty()) {
+        std::string tlsError;
+        options.tls = TlsContext::createServer(tlsCertFile, tlsKeyFile.empty() ? tlsCertFile : tlsKeyFile, kernelTls,
+                                               tlsError);
+        if (!options.tls) {
+            std::cerr << "Invalid TLS configuration: " << tlsError << std::endl;
+            return 1;
+        }
+        if (kernelTls && !TlsContext::isKernelOffloadAvailable()) {
+            std::cout << "Kernel TLS is not available on this platform; records are encrypted by OpenSSL" << std::endl;
+        }
+    }
+
+    server = new NATSServer(options);
+
+    for (const auto& ring : sharedMemoryRings) {
+        if (!server->addSharedMemoryRing(ring)) {
+            delete server;
+            return 1;
+        }
+    }
     
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
@@ -0,0 +1,163 @@
+#include "../include/Account.h"
+#include "../include/LocalHarness.h"
+#include <iostream>
+#include <cassert>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+namespace {
+
+std::vector<AccountConfig> tenants() {
+    AccountConfig acme;
+    acme.name = "acme";
+    acme.users = {"alice"};
+    acme.exports = {"orders."};
+
+    AccountConfig globex;
+    globex.name = "globex";
+    globex.users = {"bob", "carol"};
+    globex.imports = {AccountImport{"acme", "orders.eu."}};
+
+    return {acme, globex};
+}
+
+}
+
+TEST(accounts_validation) {
+    std::string error;
+    assert(Accounts::validate(tenants(), error));
+    assert(Accounts::validate({}, error));
+
+    std::vector<AccountConfig> configs = tenants();
+    configs[1].imports[0].prefix = "invoices.";
+    assert(!Accounts::validate(configs, error));
+    assert(error.find("does not export") != std::string::npos);
+
+    configs = tenants();
+    configs[1].imports[0].account = "initech";
+    assert(!Accounts::validate(configs, error));
+
+    configs = tenants();
+    configs[1].users.push_back("alice");
+    assert(!Accounts::validate(configs, error));
+
+    configs = tenants();
+    configs[1].name = "acme";
+    assert(!Accounts::validate(configs, error));
+
+    configs = tenants();
+    configs[0].name = Accounts::GLOBAL;
+    assert(!Accounts::validate(configs, error));
+}
+
+TEST(accounts_assignment_and_imports) {
+    SubjectTable subjects;
+    Accounts accounts(subjects, tenants(), {}, {});
+
+    assert(accounts.getAll().size() == 3);
+    assert(accounts.getGlobal().getName() == Accounts::GLOBAL);
+    assert(accounts.findByUser("alice").getName() == "acme");
+    assert(accounts.findByUser("carol").getName() == "globex");
+    assert(&accounts.findByUser("") == &accounts.getGlobal());
+    assert(&accounts.findByUser("mallory") == &accounts.getGlobal());
+    assert(accounts.find("initech") == nullptr);
+
+    Account& acme = *accounts.find("acme");
+    assert(acme.getImporters().size() == 1);
+    assert(acme.getImporters()[0].account == accounts.find("globex"));
+    assert(acme.getImporters()[0].prefix == "orders.eu.");
+    assert(accounts.find("globex")->getImporters().empty());
+}
+
+TEST(accounts_isolate_subjects) {
+    ServerOptions options;
+    options.accounts = tenants();
+    LocalHarness harness(options);
+    assert(harness.start());
+
+    int alice = harness.connect();
+    int bob = harness.connect();
+    int guest = harness.connect();
+    assert(alice >= 0 && bob >= 0 && guest >= 0);
+
+    harness.send(alice, "CONNECT {\"verbose\":false,\"user\":\"alice\"}\r\nSUB news 1\r\nPING\r\n");
+    assert(harness.receive(alice) == "PONG\r\n");
+    harness.send(bob, "CONNECT {\"verbose\":false,\"user\":\"bob\"}\r\nSUB orders.eu.7 2\r\nSUB orders.us.7 3\r\nPING\r\n");
+    assert(harness.receive(bob) == "PONG\r\n");
+    harness.send(guest, "CONNECT {\"verbose\":false}\r\nSUB news 4\r\nSUB orders.eu.7 5\r\nPING\r\n");
+    assert(harness.receive(guest) == "PONG\r\n");
+    assert(harness.getServer().getMemoryReport().accounts == 3);
+
+    // Same subject, different accounts.
+    harness.send(bob, "PUB news 3\r\nbob\r\n");
+    harness.send(guest, "PUB news 5\r\nguest\r\n");
+    assert(harness.receive(guest) == "MSG news 4 5\r\nguest\r\n");
+
+    // Only the imported prefix crosses from acme to globex.
+    harness.send(alice, "PUB orders.us.7 2\r\nus\r\nPUB orders.eu.7 2\r\neu\r\nPING\r\n");
+    assert(harness.receive(alice) == "PONG\r\n");
+    assert(harness.receive(bob) == "MSG orders.eu.7 2 2\r\neu\r\n");
+
+    harness.send(alice, "PING\r\n");
+    assert(harness.receive(alice) == "PONG\r\n");
+    harness.send(guest, "PING\r\n");
+    assert(harness.receive(guest) == "PONG\r\n");
+
+    // Moving to another account with live subscriptions is refused.
+    harness.send(alice, "CONNECT {\"user\":\"bob\"}\r\n");
+    assert(harness.receive(alice).find("-ERR 'Authorization Violation'") == 0);
+}
+
+TEST(accounts_cannot_read_broker_stats) {
+    ServerOptions options;
+    options.accounts = tenants();
+    LocalHarness harness(options);
+    assert(harness.start());
+
+    int alice = harness.connect();
+    int bob = harness.connect();
+    int admin = harness.connect();
+    assert(alice >= 0 && bob >= 0 && admin >= 0);
+
+    harness.send(alice, "CONNECT {\"verbose\":false,\"user\":\"alice\"}\r\nPUB acme.secret.plans 2\r\nhi\r\n"
+                        "PING\r\n");
+    assert(harness.receive(alice) == "PONG\r\n");
+
+    // A tenant gets an error, not a report naming another tenant's subjects.
+    harness.send(bob, "CONNECT {\"verbose\":false,\"user\":\"bob\"}\r\nSUB _INBOX.stats 1\r\n"
+                      "PUB $SYS.REQ.STATS.TRAFFIC _INBOX.stats 0\r\n\r\nPING\r\n");
+    std::string expected = "-ERR 'Permissions Violation for Publish to $SYS.REQ.STATS.TRAFFIC'\r\nPONG\r\n";
+    std::string reply;
+    assert(harness.receiveExactly(bob, expected.size(), reply));
+    assert(reply == expected);
+    assert(reply.find("acme.secret.plans") == std::string::npos);
+
+    harness.send(bob, "PUB $SYS.REQ.STATS.MEMORY _INBOX.stats 0\r\n\r\n");
+    assert(harness.receive(bob).find("-ERR 'Permissions Violation") == 0);
+
+    // The global account still gets the broker-wide report.
+    harness.send(admin, "CONNECT {\"verbose\":false}\r\nSUB _INBOX.stats 1\r\n"
+                        "PUB $SYS.REQ.STATS.TRAFFIC _INBOX.stats 0\r\n\r\n");
+    std::string report;
+    while (report.find("}\r\n") == std::string::npos) {
+        std::string chunk = harness.receive(admin);
+        assert(!chunk.empty());
+        report += chunk;
+    }
+    assert(report.find("MSG _INBOX.stats 1 ") == 0);
+    assert(report.find("acme.secret.plans") != std::string::npos);
+}
+
+void account_tests() {
+    std::cout << "Running account tests...\n";
+
+    RUN_TEST(accounts_validation);
+    RUN_TEST(accounts_assignment_and_imports);
+    RUN_TEST(accounts_isolate_subjects);
+    RUN_TEST(accounts_cannot_read_broker_stats);
+
+    std::cout << "All account tests PASSED!\n";
+}
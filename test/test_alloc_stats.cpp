@@ -0,0 +1,98 @@
+#include "../include/AllocStats.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+static AllocReport findTag(AllocTag tag) {
+    for (const auto& report : AllocRegistry::getReport()) {
+        if (report.tag == allocTagName(tag)) {
+            return report;
+        }
+    }
+    return AllocReport();
+}
+
+TEST(report_lists_every_tag) {
+    auto reports = AllocRegistry::getReport();
+    assert(reports.size() == static_cast<size_t>(AllocTag::COUNT) - 1);
+    assert(reports[0].tag == "parser");
+    assert(reports[1].tag == "subscriptions");
+    assert(reports[2].tag == "client_buffers");
+    assert(reports[3].tag == "outbound_frames");
+}
+
+TEST(counting_allocator_tracks_live_bytes) {
+    AllocRegistry::reset();
+    AllocReport before = findTag(AllocTag::OUTBOUND_FRAMES);
+
+    {
+        std::vector<int, CountingAllocator<int, AllocTag::OUTBOUND_FRAMES>> values;
+        values.reserve(100);
+
+        AllocReport during = findTag(AllocTag::OUTBOUND_FRAMES);
+        assert(during.allocations == before.allocations + 1);
+        assert(during.allocatedBytes == before.allocatedBytes + 100 * sizeof(int));
+        assert(during.liveBytes == before.liveBytes + 100 * sizeof(int));
+    }
+
+    AllocReport after = findTag(AllocTag::OUTBOUND_FRAMES);
+    assert(after.deallocations == before.deallocations + 1);
+    assert(after.liveBytes == before.liveBytes);
+}
+
+TEST(reset_keeps_live_bytes) {
+    std::vector<char, CountingAllocator<char, AllocTag::PARSER>> buffer(4096);
+    uint64_t live = findTag(AllocTag::PARSER).liveBytes;
+    assert(live >= 4096);
+
+    AllocRegistry::reset();
+    AllocReport report = findTag(AllocTag::PARSER);
+    assert(report.allocations == 0);
+    assert(report.allocatedBytes == 0);
+    assert(report.liveBytes == live);
+}
+
+TEST(scope_attributes_operator_new) {
+    if (!AllocRegistry::isEnabled()) {
+        return;
+    }
+
+    AllocRegistry::reset();
+    std::string* text;
+    {
+        AllocScope scope(AllocTag::SUBSCRIPTIONS);
+        text = new std::string(200, 'x');
+    }
+    AllocReport report = findTag(AllocTag::SUBSCRIPTIONS);
+    assert(report.allocations >= 2);
+    assert(report.allocatedBytes >= 200);
+
+    // Freed outside the scope, still uncounted from the tag it came from.
+    delete text;
+    assert(findTag(AllocTag::SUBSCRIPTIONS).liveBytes + 200 <= report.liveBytes);
+}
+
+TEST(json_report) {
+    std::string json = AllocRegistry::toJson();
+    assert(json.find(AllocRegistry::isEnabled() ? "{\"enabled\":true," : "{\"enabled\":false,") == 0);
+    assert(json.find("{\"tag\":\"client_buffers\",\"live_bytes\":") != std::string::npos);
+    assert(json.find("\"allocations_per_sec\":") != std::string::npos);
+}
+
+void alloc_stats_tests() {
+    std::cout << "Running AllocStats tests...\n";
+
+    RUN_TEST(report_lists_every_tag);
+    RUN_TEST(counting_allocator_tracks_live_bytes);
+    RUN_TEST(reset_keeps_live_bytes);
+    RUN_TEST(scope_attributes_operator_new);
+    RUN_TEST(json_report);
+
+    std::cout << "All alloc stats tests PASSED!\n";
+}
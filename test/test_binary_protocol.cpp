@@ -0,0 +1,168 @@
+#include "../include/BinaryProtocol.h"
+#include "../include/LocalHarness.h"
+#include <iostream>
+#include <cassert>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+namespace {
+
+struct Record {
+    uint32_t id;
+    std::string replyTo;
+    std::string payload;
+};
+
+std::string recordFrame(FrameType type, const std::vector<Record>& records) {
+    std::string body;
+    for (const auto& record : records) {
+        BinaryProtocol::appendRecordHeader(body, record.id, record.replyTo, record.payload.size());
+        body += record.payload;
+    }
+    return BinaryProtocol::generateFrame(type, body);
+}
+
+// Reads frames until count have arrived.
+std::vector<std::string> receiveFrames(LocalHarness& harness, int client, size_t count) {
+    std::vector<std::string> frames;
+    while (frames.size() < count) {
+        std::string header;
+        if (!harness.receiveExactly(client, BinaryProtocol::FRAME_HEADER_SIZE, header)) {
+            break;
+        }
+        std::string body;
+        size_t size = BinaryProtocol::readU32(header.data());
+        if (size > 0 && !harness.receiveExactly(client, size, body)) {
+            break;
+        }
+        frames.push_back(header + body);
+    }
+    return frames;
+}
+
+std::vector<Record> parseRecords(const std::string& data) {
+    BinaryFrame frame;
+    assert(BinaryProtocol::parseFrame(data.data(), data.size(), frame) == data.size());
+    assert(frame.type == FrameType::MSG);
+
+    std::vector<Record> records;
+    size_t offset = 0;
+    while (offset < frame.size) {
+        BinaryRecord record;
+        assert(BinaryProtocol::readRecord(frame, offset, record));
+        records.push_back(Record{record.id, std::string(record.replyTo, record.replySize),
+                                 std::string(record.payload, record.payloadSize)});
+    }
+    return records;
+}
+
+}
+
+TEST(binary_frames_round_trip) {
+    std::string data = recordFrame(FrameType::PUB, {{7, "", "hello"}, {9, "_INBOX.r", ""}});
+    assert(data.size() == BinaryProtocol::FRAME_HEADER_SIZE + 2 * BinaryProtocol::RECORD_HEADER_SIZE + 5 + 8);
+    assert(data[0] == static_cast<char>(data.size() - BinaryProtocol::FRAME_HEADER_SIZE) && data[1] == 0);
+
+    BinaryFrame frame;
+    assert(BinaryProtocol::parseFrame(data.data(), 5, frame) == 0 && frame.size == 0);
+    assert(BinaryProtocol::parseFrame(data.data(), data.size() - 1, frame) == 0);
+    assert(frame.size == data.size() - BinaryProtocol::FRAME_HEADER_SIZE);
+    assert(BinaryProtocol::parseFrame(data.data(), data.size() + 3, frame) == data.size());
+    assert(frame.type == FrameType::PUB);
+
+    size_t offset = 0;
+    BinaryRecord record;
+    assert(BinaryProtocol::readRecord(frame, offset, record));
+    assert(record.id == 7 && std::string(record.payload, record.payloadSize) == "hello" && record.replySize == 0);
+    assert(BinaryProtocol::readRecord(frame, offset, record));
+    assert(record.id == 9 && std::string(record.replyTo, record.replySize) == "_INBOX.r" && record.payloadSize == 0);
+    assert(offset == frame.size);
+
+    // A record claiming more payload than the frame holds is rejected.
+    BinaryFrame truncated = frame;
+    truncated.size -= 1;
+    offset = 0;
+    assert(BinaryProtocol::readRecord(truncated, offset, record));
+    assert(!BinaryProtocol::readRecord(truncated, offset, record));
+}
+
+TEST(binary_control_replies) {
+    assert(BinaryProtocol::fromTextControl("PONG\r\n") == BinaryProtocol::generateFrame(FrameType::PONG));
+    assert(BinaryProtocol::fromTextControl("+OK\r\n") == BinaryProtocol::generateFrame(FrameType::OK));
+    assert(BinaryProtocol::fromTextControl("-ERR 'Stale Connection'\r\n") ==
+           BinaryProtocol::generateFrame(FrameType::ERR, "Stale Connection"));
+
+    uint32_t sid = 0;
+    assert(BinaryProtocol::parseSid("4294967295", sid) && sid == 4294967295u);
+    assert(!BinaryProtocol::parseSid("4294967296", sid));
+    assert(!BinaryProtocol::parseSid("a1", sid));
+    assert(!BinaryProtocol::parseSid("", sid));
+}
+
+TEST(binary_clients_interoperate_with_text) {
+    LocalHarness harness;
+    assert(harness.start());
+
+    int binary = harness.connect();
+    int text = harness.connect();
+    assert(binary >= 0 && text >= 0);
+
+    harness.send(binary, "CONNECT {\"verbose\":false,\"binary\":true}\r\n" +
+                         BinaryProtocol::generateSubject(1, "orders") + BinaryProtocol::generateSubject(2, "audit") +
+                         BinaryProtocol::generateSub(10, 1) + BinaryProtocol::generateFrame(FrameType::PING));
+    std::vector<std::string> frames = receiveFrames(harness, binary, 1);
+    assert(frames.size() == 1 && frames[0] == BinaryProtocol::generateFrame(FrameType::PONG));
+
+    harness.send(text, "CONNECT {\"verbose\":false}\r\nSUB orders 5\r\nSUB audit 6\r\nPING\r\n");
+    assert(harness.receive(text) == "PONG\r\n");
+
+    // One frame publishes three messages on two subjects.
+    harness.send(binary, recordFrame(FrameType::PUB, {{1, "", "first"}, {2, "_INBOX.x", "seen"}, {1, "", "second"}}));
+    std::string expected = "MSG orders 5 5\r\nfirst\r\nMSG audit 6 _INBOX.x 4\r\nseen\r\nMSG orders 5 6\r\nsecond\r\n";
+    std::string messages;
+    assert(harness.receiveExactly(text, expected.size(), messages));
+    assert(messages == expected);
+
+    frames = receiveFrames(harness, binary, 2);
+    assert(frames.size() == 2);
+    assert(frames[0] == recordFrame(FrameType::MSG, {{10, "", "first"}}));
+    assert(frames[1] == recordFrame(FrameType::MSG, {{10, "", "second"}}));
+
+    harness.send(text, "PUB orders _INBOX.y 4\r\ntext\r\n");
+    frames = receiveFrames(harness, binary, 1);
+    assert(frames.size() == 1);
+    std::vector<Record> records = parseRecords(frames[0]);
+    assert(records.size() == 1 && records[0].id == 10 && records[0].replyTo == "_INBOX.y");
+    assert(records[0].payload == "text");
+
+    harness.send(binary, recordFrame(FrameType::PUB, {{3, "", "lost"}}) + BinaryProtocol::generateUnsub(10) +
+                         BinaryProtocol::generateFrame(FrameType::PING));
+    frames = receiveFrames(harness, binary, 2);
+    assert(frames.size() == 2);
+    assert(frames[0] == BinaryProtocol::generateFrame(FrameType::ERR, "Unknown Subject ID"));
+    assert(frames[1] == BinaryProtocol::generateFrame(FrameType::PONG));
+}
+
+TEST(binary_negotiation_requires_fresh_connection) {
+    LocalHarness harness;
+    assert(harness.start());
+
+    int client = harness.connect();
+    assert(client >= 0);
+    harness.send(client, "CONNECT {\"verbose\":false}\r\nSUB orders 1\r\nCONNECT {\"binary\":true}\r\n");
+    assert(harness.receive(client) == "-ERR 'Binary Framing Requires No Subscriptions'\r\n");
+}
+
+void binary_protocol_tests() {
+    std::cout << "Running binary protocol tests...\n";
+
+    RUN_TEST(binary_frames_round_trip);
+    RUN_TEST(binary_control_replies);
+    RUN_TEST(binary_clients_interoperate_with_text);
+    RUN_TEST(binary_negotiation_requires_fresh_connection);
+
+    std::cout << "All binary protocol tests PASSED!\n";
+}
@@ -0,0 +1,129 @@
+#include "../include/ByteScan.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+static std::vector<ScanLevel> availableLevels() {
+    std::vector<ScanLevel> levels = {ScanLevel::SCALAR};
+    if (static_cast<int>(detectScanLevel()) >= static_cast<int>(ScanLevel::SSE2)) {
+        levels.push_back(ScanLevel::SSE2);
+    }
+    if (detectScanLevel() == ScanLevel::AVX2) {
+        levels.push_back(ScanLevel::AVX2);
+    }
+    return levels;
+}
+
+static std::vector<std::string> scanFields(const std::string& buffer, size_t& lineEnd) {
+    HeaderScan scan;
+    std::vector<std::string> fields;
+
+    lineEnd = scanHeader(buffer.data(), buffer.size(), scan) ? scan.lineEnd : HeaderScan::NOT_FOUND;
+    for (size_t i = 0; i < scan.fieldCount && lineEnd != HeaderScan::NOT_FOUND; i++) {
+        fields.push_back(buffer.substr(scan.fields[i].offset, scan.fields[i].size));
+    }
+    return fields;
+}
+
+TEST(scan_short_header) {
+    ScanLevel original = getScanLevel();
+
+    for (ScanLevel level : availableLevels()) {
+        setScanLevel(level);
+
+        size_t lineEnd;
+        auto fields = scanFields("PUB FOO 5\r\nHello\r\n", lineEnd);
+        assert(lineEnd == 9);
+        assert(fields.size() == 3);
+        assert(fields[0] == "PUB" && fields[1] == "FOO" && fields[2] == "5");
+    }
+
+    setScanLevel(original);
+}
+
+TEST(scan_fields_across_blocks) {
+    ScanLevel original = getScanLevel();
+
+    std::string subject(40, 'a');
+    std::string reply(23, 'b');
+    std::string header = "PUB  " + subject + "\t" + reply + "   1234 \r\npayload\r\n";
+
+    for (ScanLevel level : availableLevels()) {
+        setScanLevel(level);
+
+        size_t lineEnd;
+        auto fields = scanFields(header, lineEnd);
+        assert(lineEnd == header.find("\r\n"));
+        assert(fields.size() == 4);
+        assert(fields[1] == subject);
+        assert(fields[2] == reply);
+        assert(fields[3] == "1234");
+    }
+
+    setScanLevel(original);
+}
+
+TEST(scan_requires_crlf) {
+    ScanLevel original = getScanLevel();
+
+    for (ScanLevel level : availableLevels()) {
+        setScanLevel(level);
+
+        size_t lineEnd;
+        scanFields("PING", lineEnd);
+        assert(lineEnd == HeaderScan::NOT_FOUND);
+
+        std::string bareNewlines = "SUB FOO\n1" + std::string(40, ' ') + "\r\n";
+        auto fields = scanFields(bareNewlines, lineEnd);
+        assert(lineEnd == bareNewlines.size() - 2);
+        assert(fields.size() == 3);
+        assert(fields[2] == "1");
+    }
+
+    setScanLevel(original);
+}
+
+TEST(scan_crlf_at_every_offset) {
+    ScanLevel original = getScanLevel();
+
+    for (size_t length = 1; length < 80; length++) {
+        std::string header(length, 'x');
+        for (size_t i = 3; i < length; i += 7) {
+            header[i] = ' ';
+        }
+        header += "\r\nrest";
+
+        setScanLevel(ScanLevel::SCALAR);
+        size_t expectedEnd;
+        auto expected = scanFields(header, expectedEnd);
+
+        for (ScanLevel level : availableLevels()) {
+            setScanLevel(level);
+
+            size_t lineEnd;
+            auto fields = scanFields(header, lineEnd);
+            assert(lineEnd == length);
+            assert(lineEnd == expectedEnd);
+            assert(fields == expected);
+        }
+    }
+
+    setScanLevel(original);
+}
+
+void byte_scan_tests() {
+    std::cout << "Running ByteScan tests (" << scanLevelName(detectScanLevel()) << ")...\n";
+
+    RUN_TEST(scan_short_header);
+    RUN_TEST(scan_fields_across_blocks);
+    RUN_TEST(scan_requires_crlf);
+    RUN_TEST(scan_crlf_at_every_offset);
+
+    std::cout << "All byte scan tests PASSED!\n";
+}
@@ -0,0 +1,87 @@
+#include "../include/FanoutPool.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <atomic>
+#include <set>
+#include <mutex>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+TEST(pool_covers_every_item_once) {
+    FanoutPool pool(3);
+    assert(pool.getWorkerCount() == 3);
+
+    for (size_t count : {0u, 1u, 2u, 5u, 1000u}) {
+        std::vector<std::atomic<int>> hits(count);
+        for (auto& hit : hits) {
+            hit = 0;
+        }
+
+        pool.run(count, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                hits[i]++;
+            }
+        });
+
+        for (auto& hit : hits) {
+            assert(hit == 1);
+        }
+    }
+}
+
+TEST(pool_runs_shares_on_several_threads) {
+    FanoutPool pool(3);
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    size_t shares = 0;
+
+    pool.run(400, [&](size_t begin, size_t end) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+        shares++;
+        assert(end - begin == 100);
+    });
+
+    assert(shares == 4);
+    assert(threads.size() == 4);
+    assert(threads.count(std::this_thread::get_id()) == 1);
+}
+
+TEST(pool_completes_before_returning) {
+    FanoutPool pool(2);
+
+    std::atomic<size_t> done(0);
+    for (int round = 0; round < 200; round++) {
+        pool.run(30, [&](size_t begin, size_t end) {
+            done += end - begin;
+        });
+        assert(done == static_cast<size_t>(round + 1) * 30);
+    }
+}
+
+TEST(pool_without_workers_runs_inline) {
+    FanoutPool pool(0);
+
+    size_t calls = 0;
+    pool.run(10, [&](size_t begin, size_t end) {
+        assert(begin == 0 && end == 10);
+        calls++;
+    });
+    assert(calls == 1);
+}
+
+void fanout_pool_tests() {
+    std::cout << "Running FanoutPool tests...\n";
+
+    RUN_TEST(pool_covers_every_item_once);
+    RUN_TEST(pool_runs_shares_on_several_threads);
+    RUN_TEST(pool_completes_before_returning);
+    RUN_TEST(pool_without_workers_runs_inline);
+
+    std::cout << "All fan-out pool tests PASSED!\n";
+}
@@ -0,0 +1,122 @@
+#include "../include/Handoff.h"
+#include <iostream>
+#include <cassert>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+TEST(handoff_state_round_trip) {
+    HandoffState state;
+    state.tcpListener = std::string("tcp\0info", 8);
+    state.unixListener = "unix-info";
+    state.unixSocketPath = "pulse.sock";
+
+    HandoffClient client;
+    client.socketInfo = "client-info";
+    client.ip = "10.0.0.7";
+    client.account = "tenant-a";
+    client.connectReceived = true;
+    client.connectOptions.verbose = false;
+    client.connectOptions.pedantic = true;
+    client.connectOptions.echo = false;
+    client.connectOptions.binary = true;
+    client.binarySubjects.emplace_back(7u, "orders.new");
+    client.resumeRecord = 3;
+    client.subscriptions.emplace_back("1", "orders.new");
+    client.subscriptions.emplace_back("22", "orders.>");
+    client.pendingInput = "PUB orders.new 5\r\nhel";
+    client.pendingOutput = "MSG orders.new 1 2\r\nhi\r\n";
+    state.clients.push_back(client);
+    state.clients.push_back(HandoffClient());
+
+    HandoffAccount account;
+    account.name = "tenant-a";
+    account.workQueues.nextSequence = 1ull << 40;
+    WorkQueueState::Message queued;
+    queued.subject = "jobs.resize";
+    queued.message.sequence = 5;
+    queued.message.payload = std::make_shared<const std::string>("img");
+    account.workQueues.messages.push_back(queued);
+    queued.message.sequence = (1ull << 40) - 1;
+    queued.message.deliveries = 2;
+    queued.ackWaitMs = 250;
+    account.workQueues.messages.push_back(queued);
+    account.workQueues.fetches.push_back(WorkQueueState::Fetch{"jobs.encode", "_INBOX.w", 4, 900});
+    RetainedMessage retained{"_INBOX.r", std::make_shared<const std::string>(std::string("1.08\0", 5))};
+    account.history.messages.push_back(MessageHistoryState::Message{"ticks.eur", retained});
+    state.accounts.push_back(account);
+
+    HandoffState decoded;
+    assert(Handoff::decode(Handoff::encode(state), decoded));
+
+    assert(decoded.tcpListener == state.tcpListener);
+    assert(decoded.unixListener == "unix-info");
+    assert(decoded.unixSocketPath == "pulse.sock");
+    assert(decoded.clients.size() == 2);
+
+    const HandoffClient& restored = decoded.clients[0];
+    assert(restored.socketInfo == "client-info");
+    assert(restored.ip == "10.0.0.7");
+    assert(restored.account == "tenant-a");
+    assert(restored.connectReceived);
+    assert(!restored.connectOptions.verbose);
+    assert(restored.connectOptions.pedantic);
+    assert(!restored.connectOptions.echo);
+    assert(restored.connectOptions.binary);
+    assert(restored.binarySubjects == client.binarySubjects);
+    assert(restored.resumeRecord == 3);
+    assert(restored.subscriptions == client.subscriptions);
+    assert(restored.pendingInput == client.pendingInput);
+    assert(restored.pendingOutput == client.pendingOutput);
+
+    assert(!decoded.clients[1].connectReceived);
+    assert(decoded.clients[1].connectOptions.verbose);
+    assert(decoded.clients[1].subscriptions.empty());
+    assert(!decoded.clients[1].connectOptions.binary && decoded.clients[1].binarySubjects.empty());
+
+    assert(decoded.accounts.size() == 1 && decoded.accounts[0].name == "tenant-a");
+    const WorkQueueState& queues = decoded.accounts[0].workQueues;
+    assert(queues.nextSequence == 1ull << 40);
+    assert(queues.messages.size() == 2);
+    assert(queues.messages[0].subject == "jobs.resize" && queues.messages[0].message.sequence == 5);
+    assert(*queues.messages[0].message.payload == "img" && queues.messages[0].ackWaitMs == -1);
+    assert(queues.messages[1].message.sequence == (1ull << 40) - 1);
+    assert(queues.messages[1].message.deliveries == 2 && queues.messages[1].ackWaitMs == 250);
+    assert(queues.fetches.size() == 1 && queues.fetches[0].subject == "jobs.encode");
+    assert(queues.fetches[0].inbox == "_INBOX.w" && queues.fetches[0].batch == 4);
+    assert(queues.fetches[0].expiresMs == 900);
+
+    const MessageHistoryState& history = decoded.accounts[0].history;
+    assert(history.messages.size() == 1 && history.messages[0].subject == "ticks.eur");
+    assert(history.messages[0].message.replyTo == "_INBOX.r");
+    assert(*history.messages[0].message.payload == std::string("1.08\0", 5));
+}
+
+TEST(handoff_decode_rejects_bad_input) {
+    HandoffState state;
+    state.tcpListener = "tcp-info";
+    HandoffClient client;
+    client.subscriptions.emplace_back("1", "foo");
+    state.clients.push_back(client);
+    std::string encoded = Handoff::encode(state);
+
+    HandoffState decoded;
+    assert(!Handoff::decode("", decoded));
+    assert(!Handoff::decode("XXXX" + encoded.substr(4), decoded));
+    for (size_t size = 0; size < encoded.size(); size++) {
+        assert(!Handoff::decode(encoded.substr(0, size), decoded));
+    }
+    assert(!Handoff::decode(encoded + "x", decoded));
+    assert(Handoff::decode(encoded, decoded));
+}
+
+void handoff_tests() {
+    std::cout << "Running handoff tests...\n";
+
+    RUN_TEST(handoff_state_round_trip);
+    RUN_TEST(handoff_decode_rejects_bad_input);
+
+    std::cout << "All handoff tests PASSED!\n";
+}
@@ -0,0 +1,79 @@
+#include "../include/LocalHarness.h"
+#include <iostream>
+#include <cassert>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+TEST(local_harness_request_reply) {
+    LocalHarness harness;
+    assert(harness.start());
+
+    int subscriber = harness.connect();
+    int publisher = harness.connect();
+    assert(subscriber >= 0 && publisher >= 0);
+    assert(harness.getServer().getMemoryReport().connections == 2);
+
+    harness.send(subscriber, "SUB local.echo 3\r\n");
+    assert(harness.receive(subscriber) == "+OK\r\n");
+
+    harness.send(publisher, "PUB local.echo 5\r\nhello\r\n");
+    assert(harness.receive(publisher) == "+OK\r\n");
+
+    std::string expected = "MSG local.echo 3 5\r\nhello\r\n";
+    std::string message;
+    assert(harness.receiveExactly(subscriber, expected.size(), message));
+    assert(message == expected);
+
+    harness.close(subscriber);
+    harness.send(publisher, "PING\r\n");
+    assert(harness.receive(publisher) == "PONG\r\n");
+
+    harness.stop();
+}
+
+TEST(local_harness_workload_is_reproducible) {
+    Workload workload;
+    workload.subjects = 12;
+    workload.subscribersPerSubject = 2;
+    workload.messages = 2000;
+    workload.payloadSize = 32;
+    workload.batchSize = 64;
+    workload.seed = 42;
+
+    WorkloadResult results[2];
+    for (auto& result : results) {
+        LocalHarness harness;
+        assert(harness.start());
+        result = harness.run(workload);
+        harness.stop();
+    }
+
+    for (const auto& result : results) {
+        assert(result.complete);
+        assert(result.published == 2000);
+        assert(result.delivered == 2000 * 2);
+        assert(result.expectedDeliveries == result.delivered);
+    }
+
+    // bench.0 to bench.11 differ in length, so equal byte counts mean the
+    // same subjects were drawn.
+    assert(results[0].deliveredBytes == results[1].deliveredBytes);
+
+    workload.seed = 7;
+    LocalHarness harness;
+    assert(harness.start());
+    WorkloadResult other = harness.run(workload);
+    assert(other.complete && other.delivered == 2000 * 2);
+}
+
+void local_harness_tests() {
+    std::cout << "Running local harness tests...\n";
+
+    RUN_TEST(local_harness_request_reply);
+    RUN_TEST(local_harness_workload_is_reproducible);
+
+    std::cout << "All local harness tests PASSED!\n";
+}
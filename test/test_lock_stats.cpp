@@ -0,0 +1,93 @@
+#include "../include/LockStats.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <chrono>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+static LockReport findLock(const std::string& name) {
+    for (const auto& report : LockRegistry::getReport()) {
+        if (report.name == name) {
+            return report;
+        }
+    }
+    return LockReport();
+}
+
+TEST(histogram_buckets) {
+    assert(LockHistogram::bucketFor(0) == 0);
+    assert(LockHistogram::bucketFor(1) == 0);
+    assert(LockHistogram::bucketFor(2) == 1);
+    assert(LockHistogram::bucketFor(1023) == 9);
+    assert(LockHistogram::bucketFor(1024) == 10);
+    assert(LockHistogram::bucketFor(UINT64_MAX) == LockHistogram::BUCKETS - 1);
+}
+
+TEST(instrumented_mutex_counts_acquisitions) {
+    InstrumentedMutex mutex("test.uncontended");
+
+    for (int i = 0; i < 10; i++) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+    }
+    assert(mutex.try_lock());
+    mutex.unlock();
+
+    LockReport report = findLock("test.uncontended");
+    assert(report.acquisitions == 11);
+    assert(report.contentions == 0);
+    assert(report.waitTotalNs == 0);
+    assert(report.waitHistogram[0] == 11);
+}
+
+TEST(instrumented_mutex_records_contention) {
+    InstrumentedMutex mutex("test.contended");
+
+    mutex.lock();
+    std::thread waiter([&]() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    mutex.unlock();
+    waiter.join();
+
+    LockReport report = findLock("test.contended");
+    assert(report.acquisitions == 2);
+    assert(report.contentions == 1);
+    assert(report.waitMaxNs >= 10 * 1000 * 1000);
+    assert(report.holdMaxNs >= 10 * 1000 * 1000);
+    assert(report.waitP99Ns >= report.waitMaxNs / 2);
+}
+
+TEST(locks_with_same_name_share_stats) {
+    InstrumentedMutex first("test.shared");
+    InstrumentedMutex second("test.shared");
+
+    first.lock();
+    first.unlock();
+    second.lock();
+    second.unlock();
+
+    assert(findLock("test.shared").acquisitions == 2);
+
+    std::string json = LockRegistry::toJson();
+    assert(json.find("{\"name\":\"test.shared\",\"acquisitions\":2,\"contended\":0,") != std::string::npos);
+
+    LockRegistry::reset();
+    assert(findLock("test.shared").acquisitions == 0);
+}
+
+void lock_stats_tests() {
+    std::cout << "Running LockStats tests...\n";
+
+    RUN_TEST(histogram_buckets);
+    RUN_TEST(instrumented_mutex_counts_acquisitions);
+    RUN_TEST(instrumented_mutex_records_contention);
+    RUN_TEST(locks_with_same_name_share_stats);
+
+    std::cout << "All lock stats tests PASSED!\n";
+}
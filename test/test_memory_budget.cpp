@@ -0,0 +1,195 @@
+#include "../include/MemoryBudget.h"
+#include "../include/LocalHarness.h"
+#include "../include/Client.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <chrono>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+namespace {
+
+size_t outboundBytes(NATSServer& server) {
+    return server.getMemoryBudgetReport().usage[static_cast<size_t>(MemoryUse::OUTBOUND)];
+}
+
+bool waitForOutbound(NATSServer& server, bool queued) {
+    for (int i = 0; i < 200; i++) {
+        if ((outboundBytes(server) > 0) == queued) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+}
+
+TEST(memory_budget_accounting) {
+    MemoryBudget budget(1000);
+    assert(budget.getLimit() == 1000);
+    assert(!budget.isExceeded());
+
+    budget.charge(MemoryUse::OUTBOUND, 600);
+    budget.charge(MemoryUse::HISTORY, 400);
+    assert(budget.getUsed() == 1000);
+    assert(!budget.isExceeded());
+
+    budget.charge(MemoryUse::CONNECTIONS, 1);
+    assert(budget.isExceeded());
+
+    budget.charge(MemoryUse::OUTBOUND, -600);
+    assert(budget.getUsed() == 401);
+    assert(budget.getUsed(MemoryUse::OUTBOUND) == 0);
+    assert(!budget.isExceeded());
+
+    MemoryBudget unlimited;
+    unlimited.charge(MemoryUse::READ_BUFFERS, 1 << 30);
+    assert(!unlimited.isExceeded());
+
+    budget.reset();
+    assert(budget.getUsed() == 0 && budget.getUsed(MemoryUse::HISTORY) == 0);
+}
+
+TEST(memory_budget_json) {
+    MemoryBudget budget(4096);
+    budget.charge(MemoryUse::SUBSCRIPTIONS, 256);
+    budget.recordRefusedConnection();
+    budget.recordSlowConsumer();
+
+    MemoryBudgetReport report = budget.getReport();
+    ConnectionMemory connection;
+    connection.clientId = 7;
+    connection.ip = "127.0.0.1";
+    connection.bytes = 256;
+    report.connections.push_back(connection);
+
+    std::string json = MemoryBudget::toJson(report);
+    assert(json.find("\"limit\":4096,\"used\":256") != std::string::npos);
+    assert(json.find("\"subscriptions\":256") != std::string::npos);
+    assert(json.find("\"refused_connections\":1") != std::string::npos);
+    assert(json.find("\"slow_consumers\":1") != std::string::npos);
+    assert(json.find("{\"cid\":7,\"ip\":\"127.0.0.1\",\"bytes\":256}") != std::string::npos);
+}
+
+TEST(memory_budget_tracks_outbound_queues) {
+    LocalHarness harness;
+    assert(harness.start());
+    NATSServer& server = harness.getServer();
+
+    int subscriber = harness.connect();
+    int publisher = harness.connect();
+    assert(subscriber >= 0 && publisher >= 0);
+
+    harness.send(subscriber, "CONNECT {\"verbose\":false}\r\nSUB budget.out 1\r\nPING\r\n");
+    assert(harness.receive(subscriber) == "PONG\r\n");
+    harness.send(publisher, "CONNECT {\"verbose\":false}\r\n");
+
+    // The subscriber never reads, so the socket fills and the rest queues.
+    std::string payload(512 * 1024, 'x');
+    for (int i = 0; i < 16; i++) {
+        harness.send(publisher, "PUB budget.out " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n");
+    }
+    assert(waitForOutbound(server, true));
+
+    MemoryBudgetReport report = server.getMemoryBudgetReport();
+    assert(report.connections.size() == 2);
+    assert(report.connections[0].bytes >= report.usage[static_cast<size_t>(MemoryUse::OUTBOUND)]);
+    assert(report.usage[static_cast<size_t>(MemoryUse::SUBSCRIPTIONS)] > 0);
+
+    harness.close(subscriber);
+    assert(waitForOutbound(server, false));
+}
+
+TEST(memory_budget_drops_slow_consumers) {
+    LocalHarness harness;
+    assert(harness.start());
+    NATSServer& server = harness.getServer();
+
+    int subscriber = harness.connect();
+    int publisher = harness.connect();
+    assert(subscriber >= 0 && publisher >= 0);
+
+    harness.send(subscriber, "CONNECT {\"verbose\":false}\r\nSUB budget.slow 1\r\nPING\r\n");
+    assert(harness.receive(subscriber) == "PONG\r\n");
+    harness.send(publisher, "CONNECT {\"verbose\":false}\r\n");
+
+    // More than the data lane holds, while the subscriber reads nothing.
+    std::string payload(512 * 1024, 'x');
+    size_t messages = Client::MAX_PENDING_DATA / payload.size() + 16;
+    for (size_t i = 0; i < messages; i++) {
+        harness.send(publisher, "PUB budget.slow " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n");
+    }
+    harness.send(publisher, "PING\r\n");
+    assert(harness.receive(publisher, 5000) == "PONG\r\n");
+    assert(outboundBytes(server) < 2 * payload.size());
+
+    // Whatever was already in flight arrives, then the error, then EOF.
+    std::string tail;
+    for (std::string data = harness.receive(subscriber); !data.empty(); data = harness.receive(subscriber)) {
+        tail += data;
+        if (tail.size() > 64) {
+            tail.erase(0, tail.size() - 64);
+        }
+    }
+    const std::string error = "x\r\n-ERR 'Slow Consumer'\r\n";
+    assert(tail.size() >= error.size() && tail.compare(tail.size() - error.size(), error.size(), error) == 0);
+
+    for (int i = 0; i < 200 && server.getMemoryBudgetReport().slowConsumers == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(server.getMemoryBudgetReport().slowConsumers == 1);
+    assert(waitForOutbound(server, false));
+}
+
+TEST(memory_budget_refuses_connections) {
+    ServerOptions options;
+    options.memoryBudget = 3 * NATSServer::getIdleConnectionFootprint();
+    LocalHarness harness(options);
+    assert(harness.start());
+
+    // The connection that crosses the budget is still admitted.
+    std::vector<int> clients;
+    for (int i = 0; i < 4; i++) {
+        clients.push_back(harness.connect());
+        assert(clients.back() >= 0);
+    }
+    assert(harness.connect() < 0);
+
+    MemoryBudgetReport report = harness.getServer().getMemoryBudgetReport();
+    assert(report.refusedConnections == 1);
+    assert(report.used > report.limit);
+
+    harness.send(clients[0], "SUB _INBOX.budget 1\r\nPUB $SYS.REQ.STATS.MEMORY _INBOX.budget 0\r\n\r\n");
+    std::string reply;
+    for (int i = 0; i < 20 && reply.find("refused_connections") == std::string::npos; i++) {
+        reply += harness.receive(clients[0]);
+    }
+    assert(reply.find("MSG _INBOX.budget 1 ") != std::string::npos);
+    assert(reply.find("\"refused_connections\":1") != std::string::npos);
+
+    harness.close(clients[1]);
+    harness.close(clients[2]);
+    int admitted = -1;
+    for (int i = 0; i < 100 && admitted < 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        admitted = harness.connect();
+    }
+    assert(admitted >= 0);
+}
+
+void memory_budget_tests() {
+    std::cout << "Running memory budget tests...\n";
+
+    RUN_TEST(memory_budget_accounting);
+    RUN_TEST(memory_budget_json);
+    RUN_TEST(memory_budget_tracks_outbound_queues);
+    RUN_TEST(memory_budget_drops_slow_consumers);
+    RUN_TEST(memory_budget_refuses_connections);
+
+    std::cout << "All memory budget tests PASSED!\n";
+}
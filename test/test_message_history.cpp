@@ -0,0 +1,125 @@
+#include "../include/MessageHistory.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+static std::vector<SubjectHistoryLimit> limits(const std::string& prefix, size_t depth) {
+    SubjectHistoryLimit limit;
+    limit.prefix = prefix;
+    limit.depth = depth;
+    return std::vector<SubjectHistoryLimit>(1, limit);
+}
+
+TEST(history_keeps_last_n) {
+    SubjectTable subjects;
+    MessageHistory history(subjects, limits("ticks.", 3));
+    assert(history.isEnabled());
+
+    for (int i = 0; i < 5; i++) {
+        std::string payload = std::to_string(i);
+        history.record("ticks.eur", "", payload.data(), payload.size());
+    }
+    history.record("ticks.usd", "reply", "x", 1);
+
+    const auto* eur = history.find("ticks.eur");
+    assert(eur != nullptr && eur->size() == 3);
+    assert(*(*eur)[0].payload == "2" && *(*eur)[2].payload == "4");
+
+    const auto* usd = history.find("ticks.usd");
+    assert(usd != nullptr && usd->size() == 1 && (*usd)[0].replyTo == "reply");
+
+    assert(history.size() == 4);
+    assert(history.getSubjectCount() == 2);
+    assert(history.getMemoryUsage() > 0);
+}
+
+TEST(history_ignores_unmatched_subjects) {
+    SubjectTable subjects;
+    MessageHistory history(subjects, limits("ticks.", 1));
+
+    history.record("orders.new", "", "payload", 7);
+    assert(history.find("orders.new") == nullptr);
+    assert(history.size() == 0);
+    assert(subjects.size() == 0);
+
+    MessageHistory disabled(subjects, std::vector<SubjectHistoryLimit>());
+    assert(!disabled.isEnabled());
+    disabled.record("ticks.eur", "", "payload", 7);
+    assert(disabled.find("ticks.eur") == nullptr);
+}
+
+TEST(history_first_matching_prefix_wins) {
+    SubjectTable subjects;
+    std::vector<SubjectHistoryLimit> rules = limits("ticks.eur", 1);
+    rules.push_back(limits("ticks.", 4)[0]);
+    MessageHistory history(subjects, rules);
+
+    for (int i = 0; i < 4; i++) {
+        std::string payload = std::to_string(i);
+        history.record("ticks.eur", "", payload.data(), payload.size());
+        history.record("ticks.gbp", "", payload.data(), payload.size());
+    }
+
+    assert(history.find("ticks.eur")->size() == 1);
+    assert(*history.find("ticks.eur")->back().payload == "3");
+    assert(history.find("ticks.gbp")->size() == 4);
+}
+
+TEST(history_holds_one_subject_reference) {
+    SubjectTable subjects;
+    MessageHistory history(subjects, limits("", 2));
+
+    SubjectId id = subjects.intern("ticks.eur");
+    history.record("ticks.eur", "", "a", 1);
+    history.record("ticks.eur", "", "b", 1);
+    history.record("ticks.eur", "", "c", 1);
+    assert(subjects.getReferenceCount(id) == 2);
+
+    subjects.release(id);
+    assert(history.find("ticks.eur") != nullptr);
+
+    history.clear();
+    assert(subjects.size() == 0);
+    assert(history.size() == 0 && history.getMemoryUsage() == 0);
+}
+
+TEST(history_save_and_restore) {
+    SubjectTable subjects;
+    MessageHistory history(subjects, limits("ticks.", 3));
+    for (int i = 0; i < 4; i++) {
+        std::string payload = std::to_string(i);
+        history.record("ticks.eur", i == 3 ? "reply" : "", payload.data(), payload.size());
+    }
+    history.record("ticks.usd", "", "x", 1);
+
+    MessageHistoryState state;
+    history.save(state);
+    assert(state.messages.size() == 4);
+
+    SubjectTable otherSubjects;
+    MessageHistory restored(otherSubjects, limits("ticks.eur", 2));
+    restored.restore(state);
+
+    const auto* eur = restored.find("ticks.eur");
+    assert(eur != nullptr && eur->size() == 2);
+    assert(*(*eur)[0].payload == "2" && *(*eur)[1].payload == "3" && (*eur)[1].replyTo == "reply");
+    assert(restored.find("ticks.usd") == nullptr);
+    assert(restored.size() == 2 && otherSubjects.size() == 1);
+}
+
+void message_history_tests() {
+    std::cout << "Running message history tests...\n";
+
+    RUN_TEST(history_keeps_last_n);
+    RUN_TEST(history_ignores_unmatched_subjects);
+    RUN_TEST(history_first_matching_prefix_wins);
+    RUN_TEST(history_holds_one_subject_reference);
+    RUN_TEST(history_save_and_restore);
+
+    std::cout << "All message history tests PASSED!\n";
+}
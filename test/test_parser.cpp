@@ -18,6 +18,45 @@ TEST(parse_connect) {
     assert(command.type == CommandType::CONNECT);
 }
 
+TEST(parse_connect_default_options) {
+    NATSProtocolParser parser;
+    Command command;
+
+    bool result = parser.parse("CONNECT {}\r\n", command);
+
+    assert(result == true);
+    assert(command.connectOptions.verbose == true);
+    assert(command.connectOptions.pedantic == false);
+    assert(command.connectOptions.echo == true);
+    assert(command.connectOptions.binary == false);
+    assert(command.connectOptions.user.empty());
+}
+
+TEST(parse_connect_options) {
+    NATSProtocolParser parser;
+    Command command;
+
+    bool result = parser.parse("CONNECT {\"name\":\"svc \\\"a\\\"\", \"verbose\": false, \"tags\":{\"echo\":true},"
+                               "\"pedantic\":true,\"lang\":\"cpp\",\"user\":\"acme\",\"echo\":false,"
+                               "\"binary\":true}\r\n", command);
+
+    assert(result == true);
+    assert(command.type == CommandType::CONNECT);
+    assert(command.connectOptions.verbose == false);
+    assert(command.connectOptions.pedantic == true);
+    assert(command.connectOptions.echo == false);
+    assert(command.connectOptions.binary == true);
+    assert(command.connectOptions.user == "acme");
+}
+
+TEST(parse_connect_malformed) {
+    NATSProtocolParser parser;
+    Command command;
+
+    assert(parser.parse("CONNECT\r\n", command) == false);
+    assert(parser.parse("CONNECT {\"verbose\":false\r\n", command) == false);
+}
+
 TEST(parse_ping) {
     NATSProtocolParser parser;
     Command command;
@@ -90,6 +129,81 @@ TEST(parse_pub_with_reply_to) {
     assert(command.payloadSize == 5);
 }
 
+TEST(parse_pipelined_buffer) {
+    NATSProtocolParser parser;
+    Command command;
+    std::string buffer = "PUB FOO 5\r\nHello\r\nPING\r\nPUB BAR 3\r\nab";
+    size_t consumed;
+
+    assert(parser.parse(buffer.data(), buffer.size(), command, consumed) == true);
+    assert(command.type == CommandType::PUB);
+    assert(command.payload == "Hello");
+    assert(consumed == 18);
+
+    size_t offset = consumed;
+    assert(parser.parse(buffer.data() + offset, buffer.size() - offset, command, consumed) == true);
+    assert(command.type == CommandType::PING);
+    assert(consumed == 6);
+
+    offset += consumed;
+    assert(parser.parse(buffer.data() + offset, buffer.size() - offset, command, consumed) == false);
+    assert(consumed == 0);
+}
+
+TEST(parse_skips_invalid_line) {
+    NATSProtocolParser parser;
+    Command command;
+    std::string buffer = "BOGUS 1 2\r\nPING\r\n";
+    size_t consumed;
+
+    assert(parser.parse(buffer.data(), buffer.size(), command, consumed) == false);
+    assert(consumed == 11);
+
+    assert(parser.parse("PUB FOO X\r\n", command) == false);
+}
+
+TEST(parse_pub_reports_pending_body) {
+    NATSProtocolParser parser;
+    Command command;
+    std::string buffer = "PUB FOO 10\r\nHel";
+    size_t consumed;
+
+    assert(parser.parse(buffer.data(), buffer.size(), command, consumed) == false);
+    assert(consumed == 0);
+    assert(command.payloadData == buffer.data() + 12);
+    assert(command.payloadSize == 10);
+}
+
+TEST(parse_pub_rejects_oversized_payload_early) {
+    NATSProtocolParser parser;
+    parser.setMaxPayload(8);
+    Command command;
+    std::string buffer = "PUB FOO 9\r\n";
+    size_t consumed;
+
+    // The body has not arrived, yet the header alone is enough to refuse it.
+    assert(parser.parse(buffer.data(), buffer.size(), command, consumed) == true);
+    assert(command.type == CommandType::PUB);
+    assert(command.payloadSize == 9);
+    assert(command.payloadData == nullptr);
+    assert(consumed == buffer.size());
+
+    assert(parser.parse("PUB FOO 8\r\n12345678\r\n", command) == true);
+    assert(command.payload == "12345678");
+}
+
+TEST(parse_pub_without_payload_copy) {
+    NATSProtocolParser parser;
+    parser.setPayloadCopy(false);
+    Command command;
+    std::string buffer = "PUB FOO 5\r\nHello\r\n";
+    size_t consumed;
+
+    assert(parser.parse(buffer.data(), buffer.size(), command, consumed) == true);
+    assert(command.payload.empty());
+    assert(std::string(command.payloadData, command.payloadSize) == "Hello");
+}
+
 TEST(parse_unsub) {
     NATSProtocolParser parser;
     Command command;
@@ -117,7 +231,7 @@ TEST(generate_info_message) {
     NATSProtocolParser parser;
     std::string message = parser.generateInfoMessage("localhost", 4222, "127.0.0.1");
     
-    assert(message == "INFO {\"host\":\"localhost\",\"port\":4222,\"client_ip\":\"127.0.0.1\"}\r\n");
+    assert(message == "INFO {\"host\":\"localhost\",\"port\":4222,\"client_ip\":\"127.0.0.1\",\"max_payload\":1048576,\"binary\":true}\r\n");
 }
 
 TEST(generate_ok_message) {
@@ -148,16 +262,51 @@ TEST(generate_msg_message_with_reply_to) {
     assert(message == "MSG FOO 1 BAR 5\r\nHello\r\n");
 }
 
+TEST(generate_msg_header) {
+    NATSProtocolParser parser;
+
+    assert(parser.generateMsgHeader("FOO", "1", "", 5) == "MSG FOO 1 5\r\n");
+    assert(parser.generateMsgHeader("FOO", "1", "BAR", 5) + "Hello\r\n" ==
+           parser.generateMsgMessage("FOO", "1", "BAR", "Hello"));
+}
+
+TEST(generate_err_message) {
+    NATSProtocolParser parser;
+    std::string message = parser.generateErrMessage("Invalid Subject");
+
+    assert(message == "-ERR 'Invalid Subject'\r\n");
+}
+
+TEST(validate_subjects) {
+    assert(NATSProtocolParser::isValidSubject("foo.bar", false));
+    assert(NATSProtocolParser::isValidSubject("foo.*.baz", true));
+    assert(NATSProtocolParser::isValidSubject("foo.>", true));
+    assert(!NATSProtocolParser::isValidSubject("foo.*", false));
+    assert(!NATSProtocolParser::isValidSubject("foo..bar", true));
+    assert(!NATSProtocolParser::isValidSubject("foo.", true));
+    assert(!NATSProtocolParser::isValidSubject("foo.>.bar", true));
+    assert(!NATSProtocolParser::isValidSubject("foo.b*r", true));
+    assert(!NATSProtocolParser::isValidSubject("", true));
+}
+
 void parser_tests() {
     std::cout << "Running NATSProtocolParser tests...\n";
     
     RUN_TEST(parse_connect);
+    RUN_TEST(parse_connect_default_options);
+    RUN_TEST(parse_connect_options);
+    RUN_TEST(parse_connect_malformed);
     RUN_TEST(parse_ping);
     RUN_TEST(parse_pong);
     RUN_TEST(parse_sub);
     RUN_TEST(parse_sub_with_queue_group);
     RUN_TEST(parse_pub);
     RUN_TEST(parse_pub_with_reply_to);
+    RUN_TEST(parse_pipelined_buffer);
+    RUN_TEST(parse_skips_invalid_line);
+    RUN_TEST(parse_pub_reports_pending_body);
+    RUN_TEST(parse_pub_rejects_oversized_payload_early);
+    RUN_TEST(parse_pub_without_payload_copy);
     RUN_TEST(parse_unsub);
     RUN_TEST(parse_unsub_with_max_msgs);
     
@@ -166,6 +315,9 @@ void parser_tests() {
     RUN_TEST(generate_pong_message);
     RUN_TEST(generate_msg_message);
     RUN_TEST(generate_msg_message_with_reply_to);
+    RUN_TEST(generate_msg_header);
+    RUN_TEST(generate_err_message);
+    RUN_TEST(validate_subjects);
     
     std::cout << "All parser tests PASSED!\n";
 } 
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "../include/RateLimiter.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+const int64_t SECOND = 1000000000;
+
+TEST(bucket_allows_burst_then_refills) {
+    TokenBucket bucket(10);
+    int64_t now = 5 * SECOND;
+
+    for (int i = 0; i < 10; i++) {
+        assert(bucket.take(1, now) == 0);
+    }
+
+    int64_t wait = bucket.take(1, now);
+    assert(wait > 0 && wait <= SECOND / 10);
+
+    assert(bucket.take(1, now + wait) == 0);
+    assert(bucket.take(1, now + wait) > 0);
+
+    assert(bucket.take(1, now + 3 * SECOND) == 0);
+}
+
+TEST(bucket_admits_oversized_cost_when_full) {
+    TokenBucket bucket(100);
+    int64_t now = 5 * SECOND;
+
+    assert(bucket.take(500, now) == 0);
+    assert(bucket.take(1, now) > 0);
+    assert(bucket.take(500, now + 5 * SECOND) == 0);
+}
+
+TEST(bucket_refund_returns_tokens) {
+    TokenBucket bucket(2);
+    int64_t now = 5 * SECOND;
+
+    assert(bucket.take(1, now) == 0);
+    assert(bucket.take(1, now) == 0);
+    assert(bucket.take(1, now) > 0);
+
+    bucket.refund(1);
+    assert(bucket.take(1, now) == 0);
+}
+
+TEST(unlimited_bucket_always_admits) {
+    TokenBucket bucket(0);
+    assert(bucket.isUnlimited());
+    for (int i = 0; i < 1000; i++) {
+        assert(bucket.take(1000, 0) == 0);
+    }
+}
+
+TEST(buckets_limit_bytes_and_messages) {
+    RateLimit limit;
+    limit.messagesPerSecond = 100;
+    limit.bytesPerSecond = 1000;
+    RateBuckets buckets(limit);
+    int64_t now = 5 * SECOND;
+
+    assert(buckets.take(600, now) == 0);
+    assert(buckets.take(600, now) > 0);
+    assert(buckets.take(400, now) == 0);
+}
+
+TEST(limiter_matches_first_prefix_and_counts_hits) {
+    RateLimit clientLimit;
+    clientLimit.messagesPerSecond = 1000;
+
+    std::vector<SubjectRateLimit> subjectLimits(2);
+    subjectLimits[0].prefix = "orders.";
+    subjectLimits[0].limit.messagesPerSecond = 1;
+    subjectLimits[1].prefix = "orders.eu.";
+    subjectLimits[1].limit.messagesPerSecond = 1000;
+
+    RateLimiter limiter(clientLimit, subjectLimits, RateLimitAction::REJECT);
+    assert(limiter.isEnabled());
+    assert(limiter.getAction() == RateLimitAction::REJECT);
+
+    auto buckets = limiter.createClientBuckets();
+    assert(buckets != nullptr);
+
+    assert(limiter.admit(buckets.get(), "orders.eu.new", 10) == 0);
+    assert(limiter.admit(buckets.get(), "orders.eu.new", 10) > 0);
+    assert(limiter.admit(buckets.get(), "trades.new", 10) == 0);
+
+    RateLimitReport report = limiter.getReport();
+    assert(report.clientHits == 0);
+    assert(report.subjects.size() == 2);
+    assert(report.subjects[0].hits == 1);
+    assert(report.subjects[1].hits == 0);
+
+    std::string json = RateLimiter::toJson(report);
+    assert(json.find("\"action\":\"reject\"") != std::string::npos);
+    assert(json.find("{\"prefix\":\"orders.\",\"hits\":1}") != std::string::npos);
+}
+
+TEST(limiter_without_client_limit_has_no_buckets) {
+    RateLimiter limiter(RateLimit(), std::vector<SubjectRateLimit>(), RateLimitAction::BACKPRESSURE);
+    assert(!limiter.isEnabled());
+    assert(limiter.createClientBuckets() == nullptr);
+    assert(limiter.admit(nullptr, "anything", 100) == 0);
+}
+
+void rate_limiter_tests() {
+    std::cout << "Running RateLimiter tests...\n";
+
+    RUN_TEST(bucket_allows_burst_then_refills);
+    RUN_TEST(bucket_admits_oversized_cost_when_full);
+    RUN_TEST(bucket_refund_returns_tokens);
+    RUN_TEST(unlimited_bucket_always_admits);
+    RUN_TEST(buckets_limit_bytes_and_messages);
+    RUN_TEST(limiter_matches_first_prefix_and_counts_hits);
+    RUN_TEST(limiter_without_client_limit_has_no_buckets);
+
+    std::cout << "All rate limiter tests PASSED!\n";
+}
@@ -6,8 +6,10 @@
 #include <thread>
 #include <chrono>
 #include <memory>
+#include <vector>
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <afunix.h>
 
 #pragma comment(lib, "Ws2_32.lib")
 
@@ -47,6 +49,36 @@ SOCKET connectToServer(const std::string& host, int port) {
     return clientSocket;
 }
 
+SOCKET connectToUnixServer(const std::string& path) {
+    WSADATA wsaData;
+    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (result != 0) {
+        std::cerr << "WSAStartup failed: " << result << std::endl;
+        return INVALID_SOCKET;
+    }
+
+    SOCKET clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (clientSocket == INVALID_SOCKET) {
+        std::cerr << "Socket creation failed: " << WSAGetLastError() << std::endl;
+        WSACleanup();
+        return INVALID_SOCKET;
+    }
+
+    sockaddr_un serverAddr = {};
+    serverAddr.sun_family = AF_UNIX;
+    path.copy(serverAddr.sun_path, sizeof(serverAddr.sun_path) - 1);
+
+    result = connect(clientSocket, (sockaddr*)&serverAddr, sizeof(serverAddr));
+    if (result == SOCKET_ERROR) {
+        std::cerr << "Connect failed: " << WSAGetLastError() << std::endl;
+        closesocket(clientSocket);
+        WSACleanup();
+        return INVALID_SOCKET;
+    }
+
+    return clientSocket;
+}
+
 bool sendToServer(SOCKET socket, const std::string& message) {
     int result = send(socket, message.c_str(), static_cast<int>(message.size()), 0);
     return result != SOCKET_ERROR;
@@ -126,6 +158,826 @@ TEST(connect_command) {
     server.stop();
 }
 
+TEST(unix_socket_listener) {
+    NATSServer server("127.0.0.1", 4226, "pulse_broker_test.sock");
+    server.start();
+
+    SOCKET clientSocket = connectToUnixServer("pulse_broker_test.sock");
+    assert(clientSocket != INVALID_SOCKET);
+
+    std::string response = receiveFromServer(clientSocket);
+    assert(response.substr(0, 4) == "INFO");
+
+    sendToServer(clientSocket, "PING\r\n");
+
+    response = receiveFromServer(clientSocket);
+    assert(response == "PONG\r\n");
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(shared_memory_ring_publish) {
+    NATSServer server("127.0.0.1", 4227);
+    assert(server.addSharedMemoryRing("pulse_broker_test_server", 65536));
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4227);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "SUB FOO 1\r\n");
+    assert(receiveFromServer(clientSocket) == "+OK\r\n");
+
+    auto ring = SharedMemoryRing::attach("pulse_broker_test_server");
+    assert(ring != nullptr);
+    assert(ring->publish("FOO", "Hello"));
+
+    std::string response = receiveFromServer(clientSocket);
+    assert(response == "MSG FOO 1 5\r\nHello\r\n");
+
+    TrafficReport report = server.getTrafficReport();
+    assert(report.current.publishersByMessages[0].key == "shm:pulse_broker_test_server");
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(connect_verbose_false) {
+    NATSServer server("127.0.0.1", 4228);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4228);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "CONNECT {\"verbose\":false}\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sendToServer(clientSocket, "PUB FOO 5\r\nHello\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sendToServer(clientSocket, "PING\r\n");
+
+    std::string response = receiveFromServer(clientSocket);
+    assert(response == "PONG\r\n");
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(connect_echo_false) {
+    NATSServer server("127.0.0.1", 4229);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4229);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "CONNECT {\"verbose\":false,\"echo\":false}\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sendToServer(clientSocket, "SUB FOO 1\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sendToServer(clientSocket, "PUB FOO 5\r\nHello\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sendToServer(clientSocket, "PING\r\n");
+
+    std::string response = receiveFromServer(clientSocket);
+    assert(response == "PONG\r\n");
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(connect_pedantic_rejects_invalid_subject) {
+    NATSServer server("127.0.0.1", 4230);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4230);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "CONNECT {\"pedantic\":true}\r\n");
+    assert(receiveFromServer(clientSocket) == "+OK\r\n");
+
+    sendToServer(clientSocket, "PUB FOO.* 5\r\nHello\r\n");
+    assert(receiveFromServer(clientSocket) == "-ERR 'Invalid Publish Subject'\r\n");
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(idle_connection_memory) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4231;
+    options.ioThreads = 2;
+
+    NATSServer server(options);
+    server.start();
+
+    std::vector<SOCKET> sockets;
+    for (int i = 0; i < 50; i++) {
+        SOCKET clientSocket = connectToServer("127.0.0.1", 4231);
+        assert(clientSocket != INVALID_SOCKET);
+        receiveFromServer(clientSocket);
+        sockets.push_back(clientSocket);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    MemoryReport report = server.getMemoryReport();
+    assert(report.connections == 50);
+    assert(report.bufferedConnections == 0);
+    assert(report.bytesPerIdleConnection <= 1024);
+    assert(report.idleConnectionBytes == 50 * report.bytesPerIdleConnection);
+
+    for (SOCKET clientSocket : sockets) {
+        closesocket(clientSocket);
+        WSACleanup();
+    }
+    server.stop();
+}
+
+TEST(disconnected_client_reclaimed) {
+    NATSServer server("127.0.0.1", 4232);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4232);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "SUB FOO 1\r\n");
+    assert(receiveFromServer(clientSocket) == "+OK\r\n");
+    assert(server.getMemoryReport().subscriptions == 1);
+
+    closesocket(clientSocket);
+    WSACleanup();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    MemoryReport report = server.getMemoryReport();
+    assert(report.connections == 0);
+    assert(report.subscriptions == 0);
+
+    server.stop();
+}
+
+TEST(partial_command_buffered_lazily) {
+    NATSServer server("127.0.0.1", 4233);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4233);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "PI");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(server.getMemoryReport().bufferedConnections == 1);
+
+    sendToServer(clientSocket, "NG\r\n");
+    assert(receiveFromServer(clientSocket) == "PONG\r\n");
+
+    MemoryReport report = server.getMemoryReport();
+    assert(report.bufferedConnections == 0);
+    assert(report.pooledBuffers == 1);
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(keepalive_ping_and_stale_eviction) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4234;
+    options.pingIntervalMs = 100;
+    options.maxPingsOutstanding = 1;
+    options.connectTimeoutMs = 0;
+
+    NATSServer server(options);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4234);
+    receiveFromServer(clientSocket);
+
+    assert(receiveFromServer(clientSocket) == "PING\r\n");
+    sendToServer(clientSocket, "PONG\r\n");
+    assert(receiveFromServer(clientSocket) == "PING\r\n");
+
+    assert(receiveFromServer(clientSocket) == "-ERR 'Stale Connection'\r\n");
+    assert(receiveFromServer(clientSocket).empty());
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(connect_timeout_eviction) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4235;
+    options.connectTimeoutMs = 100;
+
+    NATSServer server(options);
+    server.start();
+
+    SOCKET lateSocket = connectToServer("127.0.0.1", 4235);
+    receiveFromServer(lateSocket);
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4235);
+    receiveFromServer(clientSocket);
+    sendToServer(clientSocket, "CONNECT {}\r\n");
+    assert(receiveFromServer(clientSocket) == "+OK\r\n");
+
+    assert(receiveFromServer(lateSocket) == "-ERR 'Authentication Timeout'\r\n");
+    assert(receiveFromServer(lateSocket).empty());
+
+    sendToServer(clientSocket, "PING\r\n");
+    assert(receiveFromServer(clientSocket) == "PONG\r\n");
+    assert(server.getMemoryReport().connections == 1);
+
+    closesocket(lateSocket);
+    closesocket(clientSocket);
+    WSACleanup();
+    WSACleanup();
+    server.stop();
+}
+
+TEST(traffic_stats_request) {
+    NATSServer server("127.0.0.1", 4236);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4236);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "CONNECT {\"verbose\":false}\r\n");
+    sendToServer(clientSocket, "SUB _INBOX.stats 1\r\n");
+    sendToServer(clientSocket, "PUB orders.new 5\r\nHello\r\nPUB orders.new 5\r\nHello\r\n");
+    sendToServer(clientSocket, "PUB $SYS.REQ.STATS.TRAFFIC _INBOX.stats 0\r\n\r\n");
+
+    std::string response = receiveFromServer(clientSocket);
+    assert(response.find("MSG _INBOX.stats 1 ") == 0);
+    assert(response.find("\"subjects_by_msgs\":[{\"key\":\"orders.new\",\"msgs\":2,\"bytes\":10}") != std::string::npos);
+
+    TrafficReport report = server.getTrafficReport();
+    assert(report.current.messages == 2);
+    assert(report.current.publishersByMessages.size() == 1);
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(lock_stats_request) {
+    NATSServer server("127.0.0.1", 4237);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4237);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "CONNECT {\"verbose\":false}\r\n");
+    sendToServer(clientSocket, "SUB _INBOX.locks 1\r\n");
+    sendToServer(clientSocket, "PUB $SYS.REQ.STATS.LOCKS _INBOX.locks 0\r\n\r\n");
+
+    std::string response = receiveFromServer(clientSocket);
+    assert(response.find("MSG _INBOX.locks 1 ") == 0);
+    if (LockRegistry::isEnabled()) {
+        assert(response.find("{\"enabled\":true,") != std::string::npos);
+        assert(response.find("\"name\":\"Account::mutex_\"") != std::string::npos);
+    } else {
+        assert(response.find("{\"enabled\":false,") != std::string::npos);
+    }
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(alloc_stats_request) {
+    NATSServer server("127.0.0.1", 4247);
+    server.start();
+
+    SOCKET clientSocket = connectToServer("127.0.0.1", 4247);
+    receiveFromServer(clientSocket);
+
+    sendToServer(clientSocket, "CONNECT {\"verbose\":false}\r\n");
+    sendToServer(clientSocket, "SUB _INBOX.allocs 1\r\n");
+    sendToServer(clientSocket, "PUB $SYS.REQ.STATS.ALLOCS _INBOX.allocs 0\r\n\r\n");
+
+    std::string response = receiveFromServer(clientSocket);
+    assert(response.find("MSG _INBOX.allocs 1 ") == 0);
+    if (AllocRegistry::isEnabled()) {
+        assert(response.find("{\"enabled\":true,") != std::string::npos);
+        assert(response.find("\"tag\":\"parser\",\"live_bytes\":") != std::string::npos);
+    } else {
+        assert(response.find("{\"enabled\":false,") != std::string::npos);
+    }
+
+    closesocket(clientSocket);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(subjects_interned_once) {
+    NATSServer server("127.0.0.1", 4238);
+    server.start();
+
+    SOCKET first = connectToServer("127.0.0.1", 4238);
+    SOCKET second = connectToServer("127.0.0.1", 4238);
+    receiveFromServer(first);
+    receiveFromServer(second);
+
+    sendToServer(first, "SUB orders.new 1\r\n");
+    assert(receiveFromServer(first) == "+OK\r\n");
+    sendToServer(second, "SUB orders.new 7\r\n");
+    assert(receiveFromServer(second) == "+OK\r\n");
+
+    MemoryReport report = server.getMemoryReport();
+    assert(report.subscriptions == 2);
+    assert(report.subjects == 1);
+
+    sendToServer(first, "UNSUB 1\r\n");
+    assert(receiveFromServer(first) == "+OK\r\n");
+    assert(server.getMemoryReport().subjects == 1);
+
+    sendToServer(first, "PUB orders.new 2\r\nhi\r\n");
+    assert(receiveFromServer(first) == "+OK\r\n");
+    assert(receiveFromServer(second) == "MSG orders.new 7 2\r\nhi\r\n");
+
+    closesocket(second);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    report = server.getMemoryReport();
+    assert(report.subscriptions == 0);
+    assert(report.subjects == 0);
+
+    closesocket(first);
+    WSACleanup();
+    WSACleanup();
+    server.stop();
+}
+
+TEST(parallel_fanout_preserves_order) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4239;
+    options.fanoutThreshold = 2;
+    options.fanoutThreads = 3;
+
+    NATSServer server(options);
+    server.start();
+
+    SOCKET publisher = connectToServer("127.0.0.1", 4239);
+    receiveFromServer(publisher);
+    sendToServer(publisher, "CONNECT {\"verbose\":false}\r\n");
+
+    std::vector<SOCKET> subscribers;
+    for (int i = 0; i < 8; i++) {
+        SOCKET subscriber = connectToServer("127.0.0.1", 4239);
+        receiveFromServer(subscriber);
+        sendToServer(subscriber, "SUB fanout.test " + std::to_string(i) + "\r\n");
+        assert(receiveFromServer(subscriber) == "+OK\r\n");
+        subscribers.push_back(subscriber);
+    }
+
+    std::string burst;
+    for (int i = 0; i < 20; i++) {
+        burst += "PUB fanout.test 2\r\n" + std::string(i < 10 ? "0" : "") + std::to_string(i) + "\r\n";
+    }
+    sendToServer(publisher, burst);
+
+    for (size_t i = 0; i < subscribers.size(); i++) {
+        std::string expected;
+        for (int j = 0; j < 20; j++) {
+            expected += "MSG fanout.test " + std::to_string(i) + " 2\r\n" +
+                        std::string(j < 10 ? "0" : "") + std::to_string(j) + "\r\n";
+        }
+
+        std::string received;
+        while (received.size() < expected.size()) {
+            std::string chunk = receiveFromServer(subscribers[i]);
+            assert(!chunk.empty());
+            received += chunk;
+        }
+        assert(received == expected);
+        closesocket(subscribers[i]);
+    }
+
+    closesocket(publisher);
+    for (size_t i = 0; i <= subscribers.size(); i++) {
+        WSACleanup();
+    }
+    server.stop();
+}
+
+TEST(control_frames_bypass_queued_data) {
+    NATSServer server("127.0.0.1", 4240);
+    server.start();
+
+    SOCKET publisher = connectToServer("127.0.0.1", 4240);
+    SOCKET subscriber = connectToServer("127.0.0.1", 4240);
+    receiveFromServer(publisher);
+    receiveFromServer(subscriber);
+
+    sendToServer(publisher, "CONNECT {\"verbose\":false}\r\n");
+    sendToServer(subscriber, "SUB bulk.data 1\r\n");
+    assert(receiveFromServer(subscriber) == "+OK\r\n");
+
+    // Far more than the socket buffers hold, so most of it queues in the
+    // broker while the subscriber is not reading.
+    const int messages = 1024;
+    std::string payload(32 * 1024, 'x');
+    std::string pub = "PUB bulk.data " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+    for (int i = 0; i < messages; i++) {
+        sendToServer(publisher, pub);
+    }
+    sendToServer(publisher, "PING\r\n");
+    std::string reply;
+    while (reply.find("PONG\r\n") == std::string::npos) {
+        reply += receiveFromServer(publisher);
+    }
+
+    MemoryReport report = server.getMemoryReport();
+    assert(report.queuedConnections == 1);
+    assert(report.outboundBytes > 0);
+
+    std::string msg = "MSG bulk.data 1 " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+    size_t expected = msg.size() * messages;
+
+    sendToServer(subscriber, "PING\r\n");
+    std::string received;
+    size_t pong;
+    while ((pong = received.find("PONG\r\n")) == std::string::npos) {
+        std::string chunk = receiveFromServer(subscriber);
+        assert(!chunk.empty());
+        received += chunk;
+    }
+    assert(pong < expected / 2);
+    assert(pong % msg.size() == 0);
+
+    while (received.size() < expected + 6) {
+        std::string chunk = receiveFromServer(subscriber);
+        assert(!chunk.empty());
+        received += chunk;
+    }
+    assert(received.size() == expected + 6);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(server.getMemoryReport().outboundBytes == 0);
+
+    closesocket(subscriber);
+    closesocket(publisher);
+    WSACleanup();
+    WSACleanup();
+    server.stop();
+}
+
+TEST(rate_limit_rejects_over_limit_publishes) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4241;
+    options.clientRateLimit.messagesPerSecond = 2;
+    options.rateLimitAction = RateLimitAction::REJECT;
+
+    NATSServer server(options);
+    server.start();
+
+    SOCKET publisher = connectToServer("127.0.0.1", 4241);
+    receiveFromServer(publisher);
+
+    std::string burst;
+    for (int i = 0; i < 5; i++) {
+        burst += "PUB limited.subject 2\r\nhi\r\n";
+    }
+    sendToServer(publisher, burst + "PING\r\n");
+
+    std::string replies;
+    while (replies.find("PONG\r\n") == std::string::npos) {
+        std::string chunk = receiveFromServer(publisher);
+        assert(!chunk.empty());
+        replies += chunk;
+    }
+    assert(replies == "+OK\r\n+OK\r\n-ERR 'Rate Limit Exceeded'\r\n-ERR 'Rate Limit Exceeded'\r\n"
+                      "-ERR 'Rate Limit Exceeded'\r\nPONG\r\n");
+    assert(server.getRateLimitReport().clientHits == 3);
+
+    closesocket(publisher);
+    WSACleanup();
+    server.stop();
+}
+
+TEST(rate_limit_backpressure_delays_publishes) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4242;
+    SubjectRateLimit limit;
+    limit.prefix = "slow.";
+    limit.limit.messagesPerSecond = 10;
+    options.subjectRateLimits.push_back(limit);
+
+    NATSServer server(options);
+    server.start();
+
+    SOCKET publisher = connectToServer("127.0.0.1", 4242);
+    SOCKET subscriber = connectToServer("127.0.0.1", 4242);
+    receiveFromServer(publisher);
+    receiveFromServer(subscriber);
+
+    sendToServer(publisher, "CONNECT {\"verbose\":false}\r\n");
+    sendToServer(subscriber, "SUB slow.feed 1\r\n");
+    assert(receiveFromServer(subscriber) == "+OK\r\n");
+
+    std::string burst;
+    std::string expected;
+    for (int i = 0; i < 20; i++) {
+        std::string payload = std::string(i < 10 ? "0" : "") + std::to_string(i);
+        burst += "PUB slow.feed 2\r\n" + payload + "\r\n";
+        expected += "MSG slow.feed 1 2\r\n" + payload + "\r\n";
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    sendToServer(publisher, burst);
+
+    std::string received;
+    while (received.size() < expected.size()) {
+        std::string chunk = receiveFromServer(subscriber);
+        assert(!chunk.empty());
+        received += chunk;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Ten go out as the burst, the other ten at the refill rate.
+    assert(received == expected);
+    assert(elapsed >= std::chrono::milliseconds(800));
+
+    RateLimitReport report = server.getRateLimitReport();
+    assert(report.subjects.size() == 1 && report.subjects[0].prefix == "slow.");
+    assert(report.subjects[0].hits > 0);
+
+    closesocket(subscriber);
+    closesocket(publisher);
+    WSACleanup();
+    WSACleanup();
+    server.stop();
+}
+
+TEST(hot_restart_keeps_connections) {
+    ServerOptions oldOptions;
+    oldOptions.host = "127.0.0.1";
+    oldOptions.port = 4243;
+    oldOptions.handoffPath = "pulse_broker_handoff.sock";
+
+    NATSServer oldServer(oldOptions);
+    assert(oldServer.start());
+
+    SOCKET subscriber = connectToServer("127.0.0.1", 4243);
+    receiveFromServer(subscriber);
+    sendToServer(subscriber, "CONNECT {\"verbose\":false}\r\n");
+    sendToServer(subscriber, "SUB restart 7\r\nPING\r\n");
+    assert(receiveFromServer(subscriber) == "PONG\r\n");
+
+    ServerOptions newOptions;
+    newOptions.host = "127.0.0.1";
+    newOptions.port = 4243;
+    newOptions.takeoverPath = "pulse_broker_handoff.sock";
+
+    NATSServer newServer(newOptions);
+    assert(newServer.start());
+    assert(!oldServer.isRunning());
+    assert(newServer.getMemoryReport().connections == 1);
+    assert(newServer.getMemoryReport().subscriptions == 1);
+
+    // The connection survives with its CONNECT options and subscriptions.
+    sendToServer(subscriber, "PUB restart 2\r\nhi\r\n");
+    assert(receiveFromServer(subscriber) == "MSG restart 7 2\r\nhi\r\n");
+
+    SOCKET publisher = connectToServer("127.0.0.1", 4243);
+    assert(receiveFromServer(publisher).substr(0, 4) == "INFO");
+    sendToServer(publisher, "CONNECT {\"verbose\":false}\r\nPUB restart 3\r\nnew\r\n");
+    assert(receiveFromServer(subscriber) == "MSG restart 7 3\r\nnew\r\n");
+
+    closesocket(publisher);
+    closesocket(subscriber);
+    WSACleanup();
+    WSACleanup();
+    newServer.stop();
+    oldServer.stop();
+}
+
+TEST(hot_restart_refuses_other_processes) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4250;
+    options.handoffPath = "pulse_broker_handoff_peer.sock";
+
+    NATSServer server(options);
+    assert(server.start());
+
+    // A requester naming a process other than itself gets nothing.
+    SOCKET peer = connectToUnixServer(options.handoffPath);
+    assert(peer != INVALID_SOCKET);
+    assert(Handoff::sendFrame(peer, std::to_string(Handoff::currentProcessId() + 1)));
+
+    std::string reply;
+    assert(!Handoff::receiveFrame(peer, reply));
+    closesocket(peer);
+
+    assert(server.isRunning());
+    SOCKET client = connectToServer("127.0.0.1", 4250);
+    assert(receiveFromServer(client).substr(0, 4) == "INFO");
+
+    closesocket(client);
+    WSACleanup();
+    WSACleanup();
+    server.stop();
+}
+
+TEST(hot_restart_keeps_work_queues) {
+    WorkQueueConfig jobs;
+    jobs.prefix = "jobs.";
+
+    ServerOptions oldOptions;
+    oldOptions.host = "127.0.0.1";
+    oldOptions.port = 4248;
+    oldOptions.handoffPath = "pulse_broker_handoff_wq.sock";
+    oldOptions.workQueues.push_back(jobs);
+
+    NATSServer oldServer(oldOptions);
+    assert(oldServer.start());
+
+    SOCKET worker = connectToServer("127.0.0.1", 4248);
+    receiveFromServer(worker);
+    sendToServer(worker, "CONNECT {\"verbose\":false}\r\nSUB _INBOX.w 2\r\n"
+                         "PUB jobs.resize 1\r\na\r\nPUB jobs.resize 1\r\nb\r\n"
+                         "PUB $WQ.FETCH.jobs.resize _INBOX.w 0\r\n\r\n");
+    assert(receiveFromServer(worker) == "MSG jobs.resize 2 $WQ.ACK.1.1 1\r\na\r\n");
+
+    ServerOptions newOptions = oldOptions;
+    newOptions.handoffPath.clear();
+    newOptions.takeoverPath = "pulse_broker_handoff_wq.sock";
+
+    NATSServer newServer(newOptions);
+    assert(newServer.start());
+    assert(!oldServer.isRunning());
+    assert(newServer.getMemoryReport().workQueueMessages == 2);
+
+    // The delivered message can still be acknowledged, and the queued one
+    // is next.
+    sendToServer(worker, "PUB $WQ.ACK.1.1 0\r\n\r\nPUB $WQ.FETCH.jobs.resize _INBOX.w 0\r\n\r\n");
+    assert(receiveFromServer(worker) == "MSG jobs.resize 2 $WQ.ACK.2.1 1\r\nb\r\n");
+    assert(newServer.getMemoryReport().workQueueMessages == 1);
+
+    closesocket(worker);
+    WSACleanup();
+    newServer.stop();
+    oldServer.stop();
+}
+
+TEST(hot_restart_keeps_history) {
+    SubjectHistoryLimit ticks;
+    ticks.prefix = "ticks.";
+    ticks.depth = 2;
+
+    ServerOptions oldOptions;
+    oldOptions.host = "127.0.0.1";
+    oldOptions.port = 4249;
+    oldOptions.handoffPath = "pulse_broker_handoff_history.sock";
+    oldOptions.subjectHistory.push_back(ticks);
+
+    NATSServer oldServer(oldOptions);
+    assert(oldServer.start());
+
+    SOCKET publisher = connectToServer("127.0.0.1", 4249);
+    receiveFromServer(publisher);
+    sendToServer(publisher, "CONNECT {\"verbose\":false}\r\n"
+                            "PUB ticks.eur 1\r\n1\r\nPUB ticks.eur 1\r\n2\r\nPUB ticks.eur 1\r\n3\r\nPING\r\n");
+    assert(receiveFromServer(publisher) == "PONG\r\n");
+
+    ServerOptions newOptions = oldOptions;
+    newOptions.handoffPath.clear();
+    newOptions.takeoverPath = "pulse_broker_handoff_history.sock";
+
+    NATSServer newServer(newOptions);
+    assert(newServer.start());
+    assert(!oldServer.isRunning());
+    assert(newServer.getMemoryReport().historyMessages == 2);
+
+    SOCKET subscriber = connectToServer("127.0.0.1", 4249);
+    receiveFromServer(subscriber);
+    sendToServer(subscriber, "CONNECT {\"verbose\":false}\r\nSUB ticks.eur 5\r\nPING\r\n");
+
+    std::string expected = "MSG ticks.eur 5 1\r\n2\r\nMSG ticks.eur 5 1\r\n3\r\nPONG\r\n";
+    std::string received;
+    while (received.size() < expected.size()) {
+        std::string chunk = receiveFromServer(subscriber);
+        assert(!chunk.empty());
+        received += chunk;
+    }
+    assert(received == expected);
+
+    closesocket(subscriber);
+    closesocket(publisher);
+    WSACleanup();
+    WSACleanup();
+    newServer.stop();
+    oldServer.stop();
+}
+
+TEST(subject_history_replayed_on_subscribe) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4244;
+    SubjectHistoryLimit limit;
+    limit.prefix = "ticks.";
+    limit.depth = 2;
+    options.subjectHistory.push_back(limit);
+
+    NATSServer server(options);
+    server.start();
+
+    SOCKET publisher = connectToServer("127.0.0.1", 4244);
+    receiveFromServer(publisher);
+    sendToServer(publisher, "CONNECT {\"verbose\":false}\r\n");
+    sendToServer(publisher, "PUB ticks.eur 1\r\n1\r\nPUB ticks.eur 1\r\n2\r\nPUB ticks.eur 1\r\n3\r\n"
+                            "PUB other 1\r\nx\r\nPING\r\n");
+    assert(receiveFromServer(publisher) == "PONG\r\n");
+
+    MemoryReport report = server.getMemoryReport();
+    assert(report.historyMessages == 2);
+    assert(report.historyBytes > 0);
+
+    SOCKET subscriber = connectToServer("127.0.0.1", 4244);
+    receiveFromServer(subscriber);
+    sendToServer(subscriber, "CONNECT {\"verbose\":false}\r\nSUB ticks.eur 5\r\nSUB other 6\r\nPING\r\n");
+
+    std::string expected = "MSG ticks.eur 5 1\r\n2\r\nMSG ticks.eur 5 1\r\n3\r\nPONG\r\n";
+    std::string received;
+    while (received.size() < expected.size()) {
+        std::string chunk = receiveFromServer(subscriber);
+        assert(!chunk.empty());
+        received += chunk;
+    }
+    assert(received == expected);
+
+    // Live traffic follows the replay.
+    sendToServer(publisher, "PUB ticks.eur 1\r\n4\r\n");
+    assert(receiveFromServer(subscriber) == "MSG ticks.eur 5 1\r\n4\r\n");
+
+    closesocket(subscriber);
+    closesocket(publisher);
+    WSACleanup();
+    WSACleanup();
+    server.stop();
+}
+
+TEST(large_payloads_and_max_payload) {
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4245;
+    options.maxPayload = 256 * 1024;
+
+    NATSServer server(options);
+    server.start();
+
+    SOCKET subscriber = connectToServer("127.0.0.1", 4245);
+    SOCKET publisher = connectToServer("127.0.0.1", 4245);
+    std::string info = receiveFromServer(publisher);
+    assert(info.find("\"max_payload\":262144") != std::string::npos);
+    receiveFromServer(subscriber);
+
+    sendToServer(subscriber, "CONNECT {\"verbose\":false}\r\nSUB big 1\r\nPING\r\n");
+    assert(receiveFromServer(subscriber) == "PONG\r\n");
+    sendToServer(publisher, "CONNECT {\"verbose\":false}\r\n");
+
+    std::string payload(200 * 1024, 'p');
+    payload[0] = 'a';
+    payload[payload.size() - 1] = 'z';
+    sendToServer(publisher, "PUB big " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n");
+
+    std::string expected = "MSG big 1 " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+    std::string received;
+    while (received.size() < expected.size()) {
+        std::string chunk = receiveFromServer(subscriber);
+        assert(!chunk.empty());
+        received += chunk;
+    }
+    assert(received == expected);
+
+    // Refused on the header alone; the body is never sent.
+    sendToServer(publisher, "PUB big 300000\r\n");
+    assert(receiveFromServer(publisher) == "-ERR 'Maximum Payload Violation'\r\n");
+    assert(receiveFromServer(publisher).empty());
+
+    SOCKET flooder = connectToServer("127.0.0.1", 4245);
+    receiveFromServer(flooder);
+    sendToServer(flooder, "SUB " + std::string(NATSProtocolParser::MAX_CONTROL_LINE, 'x'));
+    assert(receiveFromServer(flooder) == "-ERR 'Maximum Control Line Exceeded'\r\n");
+
+    closesocket(flooder);
+    closesocket(publisher);
+    closesocket(subscriber);
+    WSACleanup();
+    WSACleanup();
+    WSACleanup();
+    server.stop();
+}
+
 void server_tests() {
     std::cout << "Running NATSServer tests...\n";
     
@@ -133,14 +985,76 @@ void server_tests() {
     RUN_TEST(client_connection);
     RUN_TEST(ping_command);
     RUN_TEST(connect_command);
+    RUN_TEST(unix_socket_listener);
+    RUN_TEST(shared_memory_ring_publish);
+    RUN_TEST(connect_verbose_false);
+    RUN_TEST(connect_echo_false);
+    RUN_TEST(connect_pedantic_rejects_invalid_subject);
+    RUN_TEST(idle_connection_memory);
+    RUN_TEST(disconnected_client_reclaimed);
+    RUN_TEST(partial_command_buffered_lazily);
+    RUN_TEST(keepalive_ping_and_stale_eviction);
+    RUN_TEST(connect_timeout_eviction);
+    RUN_TEST(traffic_stats_request);
+    RUN_TEST(lock_stats_request);
+    RUN_TEST(alloc_stats_request);
+    RUN_TEST(subjects_interned_once);
+    RUN_TEST(parallel_fanout_preserves_order);
+    RUN_TEST(control_frames_bypass_queued_data);
+    RUN_TEST(rate_limit_rejects_over_limit_publishes);
+    RUN_TEST(rate_limit_backpressure_delays_publishes);
+    RUN_TEST(hot_restart_keeps_connections);
+    RUN_TEST(hot_restart_refuses_other_processes);
+    RUN_TEST(hot_restart_keeps_work_queues);
+    RUN_TEST(hot_restart_keeps_history);
+    RUN_TEST(subject_history_replayed_on_subscribe);
+    RUN_TEST(large_payloads_and_max_payload);
     
     std::cout << "All server tests PASSED!\n";
 }
 
+void byte_scan_tests();
 void parser_tests();
+void shared_memory_ring_tests();
+void timing_wheel_tests();
+void traffic_stats_tests();
+void lock_stats_tests();
+void alloc_stats_tests();
+void subject_table_tests();
+void subscription_store_tests();
+void fanout_pool_tests();
+void rate_limiter_tests();
+void handoff_tests();
+void local_harness_tests();
+void message_history_tests();
+void memory_budget_tests();
+void subject_mapping_tests();
+void account_tests();
+void work_queue_tests();
+void binary_protocol_tests();
+void tls_tests();
 
 int main() {
+    byte_scan_tests();
     parser_tests();
+    shared_memory_ring_tests();
+    timing_wheel_tests();
+    traffic_stats_tests();
+    lock_stats_tests();
+    alloc_stats_tests();
+    subject_table_tests();
+    subscription_store_tests();
+    fanout_pool_tests();
+    rate_limiter_tests();
+    handoff_tests();
+    local_harness_tests();
+    message_history_tests();
+    memory_budget_tests();
+    subject_mapping_tests();
+    account_tests();
+    work_queue_tests();
+    binary_protocol_tests();
+    tls_tests();
     server_tests();
     
     std::cout << "All tests completed successfully!\n";
@@ -0,0 +1,93 @@
+#include "../include/SharedMemoryRing.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+struct RingFrame {
+    std::string subject;
+    std::string replyTo;
+    std::string payload;
+};
+
+static std::vector<RingFrame> drainFrames(SharedMemoryRing& ring) {
+    std::vector<RingFrame> frames;
+    ring.drain([&](const char* subject, size_t subjectSize,
+                   const char* replyTo, size_t replyToSize,
+                   const char* payload, size_t payloadSize) {
+        frames.push_back({std::string(subject, subjectSize), std::string(replyTo, replyToSize),
+                          std::string(payload, payloadSize)});
+    });
+    return frames;
+}
+
+TEST(ring_publish_and_drain) {
+    auto consumer = SharedMemoryRing::create("pulse_broker_test_ring", 4096);
+    assert(consumer != nullptr);
+
+    auto producer = SharedMemoryRing::attach("pulse_broker_test_ring");
+    assert(producer != nullptr);
+    assert(producer->getCapacity() == 4096);
+
+    assert(producer->tryPublish("FOO", "Hello"));
+    assert(producer->tryPublish("BAR", "World", "INBOX"));
+
+    auto frames = drainFrames(*consumer);
+    assert(frames.size() == 2);
+    assert(frames[0].subject == "FOO");
+    assert(frames[0].replyTo.empty());
+    assert(frames[0].payload == "Hello");
+    assert(frames[1].subject == "BAR");
+    assert(frames[1].replyTo == "INBOX");
+    assert(frames[1].payload == "World");
+
+    assert(drainFrames(*consumer).empty());
+}
+
+TEST(ring_wraparound) {
+    auto consumer = SharedMemoryRing::create("pulse_broker_test_wrap", 4096);
+    auto producer = SharedMemoryRing::attach("pulse_broker_test_wrap");
+    assert(consumer != nullptr && producer != nullptr);
+
+    std::string payload(100, 'x');
+    for (int i = 0; i < 1000; i++) {
+        assert(producer->tryPublish("WRAP", payload + std::to_string(i)));
+
+        auto frames = drainFrames(*consumer);
+        assert(frames.size() == 1);
+        assert(frames[0].payload == payload + std::to_string(i));
+    }
+}
+
+TEST(ring_full) {
+    auto consumer = SharedMemoryRing::create("pulse_broker_test_full", 4096);
+    auto producer = SharedMemoryRing::attach("pulse_broker_test_full");
+    assert(consumer != nullptr && producer != nullptr);
+
+    std::string payload(1000, 'x');
+    int published = 0;
+    while (producer->tryPublish("FULL", payload)) {
+        published++;
+    }
+    assert(published > 0 && published < 5);
+
+    assert(!producer->tryPublish("FULL", std::string(4096, 'x')));
+
+    assert(drainFrames(*consumer).size() == static_cast<size_t>(published));
+    assert(producer->tryPublish("FULL", payload));
+}
+
+void shared_memory_ring_tests() {
+    std::cout << "Running SharedMemoryRing tests...\n";
+
+    RUN_TEST(ring_publish_and_drain);
+    RUN_TEST(ring_wraparound);
+    RUN_TEST(ring_full);
+
+    std::cout << "All shared memory ring tests PASSED!\n";
+}
@@ -0,0 +1,105 @@
+#include "../include/SubjectMapping.h"
+#include "../include/LocalHarness.h"
+#include <iostream>
+#include <cassert>
+#include <set>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+namespace {
+
+SubjectMappingRule rule(const std::string& source, const std::string& destination) {
+    SubjectMappingRule mapping;
+    mapping.source = source;
+    mapping.destination = destination;
+    return mapping;
+}
+
+}
+
+TEST(subject_mapping_validation) {
+    std::string error;
+    assert(SubjectMapper::validate(rule("orders.*", "orders.{{partition(16,1)}}.*"), error));
+    assert(SubjectMapper::validate(rule("a.*.*", "b.{{wildcard(2)}}.{{wildcard(1)}}"), error));
+    assert(SubjectMapper::validate(rule("logs.>", "archive.>"), error));
+
+    assert(!SubjectMapper::validate(rule("orders.*", "orders.*.*"), error));
+    assert(!SubjectMapper::validate(rule("orders.*", "orders.{{partition(16,2)}}"), error));
+    assert(!SubjectMapper::validate(rule("orders.*", "orders.{{partition(0,1)}}"), error));
+    assert(!SubjectMapper::validate(rule("orders.*", "orders.{{shuffle(1)}}"), error));
+    assert(!SubjectMapper::validate(rule("orders.>.x", "orders.>"), error));
+    assert(!SubjectMapper::validate(rule("orders.*", "orders.>"), error));
+    assert(!SubjectMapper::validate(rule("orders..*", "x"), error));
+    assert(!error.empty());
+}
+
+TEST(subject_mapping_rewrites_tokens) {
+    SubjectMapper mapper({rule("a.*.*", "b.{{wildcard(2)}}.*.{{wildcard(1)}}"), rule("logs.>", "archive.>"),
+                          rule("a.x.y", "never")});
+    assert(mapper.isEnabled());
+
+    std::string mapped;
+    assert(mapper.map("a.x.y", mapped) && mapped == "b.y.x.x");
+    assert(mapper.map("logs.app.error", mapped) && mapped == "archive.app.error");
+    assert(!mapper.map("logs", mapped));
+    assert(!mapper.map("a.x", mapped));
+    assert(!mapper.map("c.x.y", mapped));
+
+    SubjectMapper empty({});
+    assert(!empty.isEnabled());
+}
+
+TEST(subject_mapping_partitions_are_stable) {
+    // FNV-1a of "a" is 0xe40c292c.
+    assert(SubjectMapper::partition({"a"}, 1000) == 220);
+
+    SubjectMapper mapper({rule("orders.*", "orders.{{partition(16,1)}}")});
+    std::set<std::string> partitions;
+    for (int customer = 0; customer < 1000; customer++) {
+        std::string id = std::to_string(customer);
+        std::string first;
+        std::string second;
+        assert(mapper.map("orders." + id, first));
+        assert(mapper.map("orders." + id, second));
+        assert(first == second);
+        assert(first == "orders." + std::to_string(SubjectMapper::partition({id}, 16)));
+        partitions.insert(first);
+    }
+    assert(partitions.size() == 16);
+}
+
+TEST(subject_mapping_applied_on_publish) {
+    ServerOptions options;
+    options.subjectMappings.push_back(rule("orders.*", "orders.{{partition(4,1)}}"));
+    LocalHarness harness(options);
+    assert(harness.start());
+
+    int consumer = harness.connect();
+    int publisher = harness.connect();
+    assert(consumer >= 0 && publisher >= 0);
+
+    std::string partition = std::to_string(SubjectMapper::partition({"42"}, 4));
+    harness.send(consumer, "CONNECT {\"verbose\":false}\r\nSUB orders." + partition + " 1\r\nPING\r\n");
+    assert(harness.receive(consumer) == "PONG\r\n");
+
+    harness.send(publisher, "CONNECT {\"verbose\":false}\r\nPUB orders.42 5\r\nfirst\r\nPUB orders.42 6\r\nsecond\r\n");
+
+    std::string expected = "MSG orders." + partition + " 1 5\r\nfirst\r\nMSG orders." + partition + " 1 6\r\nsecond\r\n";
+    std::string messages;
+    assert(harness.receiveExactly(consumer, expected.size(), messages));
+    assert(messages == expected);
+}
+
+void subject_mapping_tests() {
+    std::cout << "Running subject mapping tests...\n";
+
+    RUN_TEST(subject_mapping_validation);
+    RUN_TEST(subject_mapping_rewrites_tokens);
+    RUN_TEST(subject_mapping_partitions_are_stable);
+    RUN_TEST(subject_mapping_applied_on_publish);
+
+    std::cout << "All subject mapping tests PASSED!\n";
+}
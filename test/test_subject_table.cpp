@@ -0,0 +1,90 @@
+#include "../include/SubjectTable.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+TEST(intern_returns_same_id) {
+    SubjectTable subjects;
+
+    SubjectId foo = subjects.intern("FOO.bar");
+    SubjectId again = subjects.intern("FOO.bar");
+    SubjectId other = subjects.intern("FOO.baz");
+
+    assert(foo != SubjectTable::INVALID_ID);
+    assert(foo == again);
+    assert(foo != other);
+    assert(subjects.size() == 2);
+    assert(subjects.getSubject(foo) == "FOO.bar");
+    assert(subjects.getReferenceCount(foo) == 2);
+
+    assert(subjects.find("FOO.bar") == foo);
+    assert(subjects.find("FOO") == SubjectTable::INVALID_ID);
+    assert(subjects.getReferenceCount(foo) == 2);
+}
+
+TEST(release_recycles_id) {
+    SubjectTable subjects;
+
+    SubjectId inbox = subjects.intern("_INBOX.1");
+    subjects.retain(inbox);
+    subjects.release(inbox);
+    assert(subjects.find("_INBOX.1") == inbox);
+
+    subjects.release(inbox);
+    assert(subjects.find("_INBOX.1") == SubjectTable::INVALID_ID);
+    assert(subjects.size() == 0);
+
+    SubjectId next = subjects.intern("_INBOX.2");
+    assert(next == inbox);
+    assert(subjects.getSubject(next) == "_INBOX.2");
+}
+
+TEST(concurrent_intern) {
+    SubjectTable subjects;
+    std::vector<std::vector<SubjectId>> ids(4);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < ids.size(); t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 5000; i++) {
+                ids[t].push_back(subjects.intern("subject." + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    assert(subjects.size() == 5000);
+    for (int i = 0; i < 5000; i++) {
+        for (size_t t = 1; t < ids.size(); t++) {
+            assert(ids[t][i] == ids[0][i]);
+        }
+        assert(subjects.getSubject(ids[0][i]) == "subject." + std::to_string(i));
+        assert(subjects.getReferenceCount(ids[0][i]) == ids.size());
+    }
+
+    for (auto& threadIds : ids) {
+        for (SubjectId id : threadIds) {
+            subjects.release(id);
+        }
+    }
+    assert(subjects.size() == 0);
+}
+
+void subject_table_tests() {
+    std::cout << "Running SubjectTable tests...\n";
+
+    RUN_TEST(intern_returns_same_id);
+    RUN_TEST(release_recycles_id);
+    RUN_TEST(concurrent_intern);
+
+    std::cout << "All subject table tests PASSED!\n";
+}
@@ -0,0 +1,84 @@
+#include "../include/Subscription.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+// The store never dereferences clients, so tests can use placeholder pointers.
+static Client* fakeClient(uintptr_t id) {
+    return reinterpret_cast<Client*>(id * 64);
+}
+
+TEST(store_groups_by_subject) {
+    SubjectTable subjects;
+    SubscriptionStore store(subjects);
+
+    store.add(fakeClient(1), "FOO", "1");
+    store.add(fakeClient(2), "FOO", "7");
+    store.add(fakeClient(1), "BAR", "2");
+
+    assert(store.size() == 3);
+    assert(store.getSubjectCount() == 2);
+    assert(subjects.size() == 2);
+
+    const auto* foo = store.find("FOO");
+    assert(foo != nullptr && foo->size() == 2);
+    assert((*foo)[0].client == fakeClient(1) && (*foo)[0].sid == "1");
+    assert((*foo)[1].client == fakeClient(2) && (*foo)[1].sid == "7");
+
+    assert(store.find("BAZ") == nullptr);
+}
+
+TEST(store_remove_keeps_handles_valid) {
+    SubjectTable subjects;
+    SubscriptionStore store(subjects);
+
+    SubscriptionHandle first = store.add(fakeClient(1), "FOO", "1");
+    SubscriptionHandle second = store.add(fakeClient(2), "FOO", "2");
+    SubscriptionHandle third = store.add(fakeClient(3), "FOO", "3");
+
+    store.remove(first);
+    const auto* foo = store.find("FOO");
+    assert(foo->size() == 2);
+
+    store.remove(third);
+    foo = store.find("FOO");
+    assert(foo->size() == 1);
+    assert((*foo)[0].handle == second && (*foo)[0].sid == "2");
+
+    store.remove(second);
+    store.remove(second);
+    assert(store.find("FOO") == nullptr);
+    assert(store.size() == 0);
+    assert(subjects.size() == 0);
+
+    SubscriptionHandle reused = store.add(fakeClient(4), "BAR", "9");
+    assert(reused == second);
+    assert(store.getSubjectId(reused) == subjects.find("BAR"));
+}
+
+TEST(store_clear_releases_subjects) {
+    SubjectTable subjects;
+    {
+        SubscriptionStore store(subjects);
+        store.add(fakeClient(1), "FOO", "1");
+        store.add(fakeClient(2), "FOO", "2");
+        store.add(fakeClient(2), "BAR", "3");
+        assert(subjects.getReferenceCount(subjects.find("FOO")) == 2);
+    }
+    assert(subjects.size() == 0);
+}
+
+void subscription_store_tests() {
+    std::cout << "Running SubscriptionStore tests...\n";
+
+    RUN_TEST(store_groups_by_subject);
+    RUN_TEST(store_remove_keeps_handles_valid);
+    RUN_TEST(store_clear_releases_subjects);
+
+    std::cout << "All subscription store tests PASSED!\n";
+}
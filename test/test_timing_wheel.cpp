@@ -0,0 +1,140 @@
+#include "../include/TimingWheel.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+using Clock = TimingWheel::Clock;
+using std::chrono::milliseconds;
+
+struct TestTimer : TimingWheel::Timer {
+    int id = 0;
+    uint64_t firedAt = 0;
+};
+
+TEST(wheel_fires_in_order) {
+    Clock::time_point start = Clock::now();
+    std::vector<int> fired;
+    TimingWheel wheel(milliseconds(10), [&](TimingWheel::Timer& timer) {
+        fired.push_back(static_cast<TestTimer&>(timer).id);
+    }, start);
+
+    TestTimer a, b, c;
+    a.id = 1;
+    b.id = 2;
+    c.id = 3;
+
+    wheel.schedule(c, milliseconds(300));
+    wheel.schedule(a, milliseconds(10));
+    wheel.schedule(b, milliseconds(50));
+    assert(wheel.size() == 3);
+
+    wheel.advance(start + milliseconds(9));
+    assert(fired.empty());
+
+    wheel.advance(start + milliseconds(60));
+    assert(fired.size() == 2 && fired[0] == 1 && fired[1] == 2);
+
+    wheel.advance(start + milliseconds(1000));
+    assert(fired.size() == 3 && fired[2] == 3);
+    assert(wheel.size() == 0);
+}
+
+TEST(wheel_cancel) {
+    Clock::time_point start = Clock::now();
+    int fired = 0;
+    TimingWheel wheel(milliseconds(1), [&](TimingWheel::Timer&) { fired++; }, start);
+
+    TestTimer timer;
+    wheel.schedule(timer, milliseconds(5));
+    assert(timer.isScheduled());
+
+    wheel.cancel(timer);
+    assert(!timer.isScheduled());
+    assert(wheel.size() == 0);
+
+    wheel.advance(start + milliseconds(100));
+    assert(fired == 0);
+}
+
+TEST(wheel_cascades_exactly) {
+    Clock::time_point start = Clock::now();
+    std::vector<TestTimer> timers(500);
+    TimingWheel* wheelPtr = nullptr;
+    TimingWheel wheel(milliseconds(1), [&](TimingWheel::Timer& timer) {
+        static_cast<TestTimer&>(timer).firedAt = wheelPtr->getCurrentTick();
+    }, start);
+    wheelPtr = &wheel;
+
+    for (size_t i = 0; i < timers.size(); i++) {
+        timers[i].id = static_cast<int>(i);
+        wheel.schedule(timers[i], milliseconds(1 + i * 997 % 300000));
+    }
+
+    for (int step = 1; step <= 310000; step += 7) {
+        wheel.advance(start + milliseconds(step));
+    }
+
+    for (size_t i = 0; i < timers.size(); i++) {
+        assert(timers[i].firedAt == 1 + i * 997 % 300000);
+    }
+    assert(wheel.size() == 0);
+}
+
+TEST(wheel_reschedule_from_handler) {
+    Clock::time_point start = Clock::now();
+    int fired = 0;
+    TestTimer timer;
+    TimingWheel* wheelPtr = nullptr;
+    TimingWheel wheel(milliseconds(10), [&](TimingWheel::Timer& expired) {
+        fired++;
+        wheelPtr->schedule(expired, milliseconds(100));
+    }, start);
+    wheelPtr = &wheel;
+
+    wheel.schedule(timer, milliseconds(100));
+    wheel.advance(start + milliseconds(1050));
+
+    assert(fired == 10);
+    assert(timer.isScheduled());
+}
+
+TEST(wheel_poll_timeout) {
+    Clock::time_point start = Clock::now();
+    TimingWheel wheel(milliseconds(50), [](TimingWheel::Timer&) {}, start);
+
+    assert(wheel.getPollTimeout(start) == -1);
+
+    TestTimer timer;
+    wheel.schedule(timer, milliseconds(500));
+
+    int timeout = wheel.getPollTimeout(start + milliseconds(20));
+    assert(timeout >= 480 && timeout <= 481);
+
+    // Beyond the inner wheel: wake once, when it wraps and cascades.
+    TestTimer far;
+    wheel.cancel(timer);
+    wheel.schedule(far, milliseconds(60000));
+    timeout = wheel.getPollTimeout(start + milliseconds(20));
+    assert(timeout >= 3180 && timeout <= 3181);
+
+    assert(wheel.advance(start + milliseconds(3200)) == 0);
+    timeout = wheel.getPollTimeout(start + milliseconds(3200));
+    assert(timeout > 0 && timeout <= 3201);
+}
+
+void timing_wheel_tests() {
+    std::cout << "Running TimingWheel tests...\n";
+
+    RUN_TEST(wheel_fires_in_order);
+    RUN_TEST(wheel_cancel);
+    RUN_TEST(wheel_cascades_exactly);
+    RUN_TEST(wheel_reschedule_from_handler);
+    RUN_TEST(wheel_poll_timeout);
+
+    std::cout << "All timing wheel tests PASSED!\n";
+}
@@ -0,0 +1,155 @@
+#include "../include/Tls.h"
+#include "../include/NATSServer.h"
+#include <iostream>
+#include <cassert>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+namespace {
+
+// A blocking client that reads INFO in the clear and then switches to TLS.
+class TlsTestClient {
+public:
+    TlsTestClient() : socket_(INVALID_SOCKET) {
+    }
+
+    ~TlsTestClient() {
+        session_.reset();
+        if (socket_ != INVALID_SOCKET) {
+            closesocket(socket_);
+        }
+    }
+
+    bool connect(int port, const std::shared_ptr<TlsContext>& context) {
+        socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (socket_ == INVALID_SOCKET) {
+            return false;
+        }
+
+        sockaddr_in serverAddr = {};
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &(serverAddr.sin_addr));
+        if (::connect(socket_, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+            return false;
+        }
+
+        // Byte at a time, so nothing of the handshake is read as INFO.
+        char c;
+        while (info_.size() < 2 || info_.compare(info_.size() - 2, 2, "\r\n") != 0) {
+            if (recv(socket_, &c, 1, 0) != 1) {
+                return false;
+            }
+            info_ += c;
+        }
+
+        session_ = context->createSession(socket_);
+        return session_ && session_->connect();
+    }
+
+    bool send(const std::string& data) {
+        size_t offset = 0;
+        while (offset < data.size()) {
+            int sent = session_->write(data.data() + offset, data.size() - offset);
+            if (sent <= 0) {
+                return false;
+            }
+            offset += static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    bool receiveExactly(size_t size, std::string& data) {
+        data.clear();
+        char chunk[TlsSession::MAX_RECORD_SIZE];
+        while (data.size() < size) {
+            int received = session_->read(chunk, sizeof(chunk));
+            if (received <= 0) {
+                return false;
+            }
+            data.append(chunk, static_cast<size_t>(received));
+        }
+        return data.size() == size;
+    }
+
+    const std::string& getInfo() const { return info_; }
+    TlsSession& getSession() { return *session_; }
+
+private:
+    SOCKET socket_;
+    std::string info_;
+    std::unique_ptr<TlsSession> session_;
+};
+
+}
+
+TEST(tls_contexts_need_build_support) {
+    std::string error;
+    if (!TlsContext::isAvailable()) {
+        assert(!TlsContext::createSelfSigned(true, error));
+        assert(error.find("PULSE_BROKER_TLS") != std::string::npos);
+        assert(!TlsContext::isKernelOffloadAvailable());
+        return;
+    }
+
+    assert(!TlsContext::createServer("missing-cert.pem", "missing-key.pem", true, error));
+    assert(error.find("missing-cert.pem") != std::string::npos);
+    assert(TlsContext::createClient(true, error));
+}
+
+TEST(tls_publish_and_deliver) {
+    if (!TlsContext::isAvailable()) {
+        return;
+    }
+
+    std::string error;
+    ServerOptions options;
+    options.host = "127.0.0.1";
+    options.port = 4246;
+    options.tls = TlsContext::createSelfSigned(true, error);
+    assert(options.tls);
+    NATSServer server(options);
+    assert(server.start());
+
+    std::shared_ptr<TlsContext> clientContext = TlsContext::createClient(true, error);
+    {
+        TlsTestClient subscriber;
+        TlsTestClient publisher;
+        assert(subscriber.connect(4246, clientContext) && publisher.connect(4246, clientContext));
+        assert(subscriber.getInfo().find("\"tls_required\":true") != std::string::npos);
+        assert(subscriber.getSession().isEstablished());
+
+        std::string reply;
+        assert(subscriber.send("CONNECT {\"verbose\":false}\r\nSUB big 1\r\nPING\r\n"));
+        assert(subscriber.receiveExactly(6, reply) && reply == "PONG\r\n");
+
+        // Spans several records in both directions.
+        std::string payload(100 * 1024, 'x');
+        payload[0] = 'a';
+        payload[payload.size() - 1] = 'z';
+        assert(publisher.send("CONNECT {\"verbose\":false}\r\nPUB big " + std::to_string(payload.size()) + "\r\n" +
+                              payload + "\r\n"));
+
+        std::string expected = "MSG big 1 " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n";
+        assert(subscriber.receiveExactly(expected.size(), reply));
+        assert(reply == expected);
+    }
+
+    server.stop();
+}
+
+void tls_tests() {
+    std::cout << "Running TLS tests...\n";
+
+    RUN_TEST(tls_contexts_need_build_support);
+    RUN_TEST(tls_publish_and_deliver);
+
+    std::cout << "All TLS tests PASSED!\n";
+}
@@ -0,0 +1,138 @@
+#include "../include/TrafficStats.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+using Clock = TrafficStats::Clock;
+using std::chrono::milliseconds;
+
+static void record(TrafficStats& stats, const std::string& subject, const std::string& publisher, size_t bytes,
+                   Clock::time_point now) {
+    stats.record(subject, publisher.data(), publisher.size(), bytes, now);
+}
+
+TEST(sketch_never_undercounts) {
+    CountMinSketch sketch(64);
+
+    for (uint64_t key = 1; key <= 1000; key++) {
+        sketch.add(key * 0x9E3779B97F4A7C15ULL, key % 7 + 1, 10);
+    }
+
+    for (uint64_t key = 1; key <= 1000; key++) {
+        TrafficCounts counts = sketch.estimate(key * 0x9E3779B97F4A7C15ULL);
+        assert(counts.messages >= key % 7 + 1);
+        assert(counts.bytes >= 10);
+    }
+}
+
+TEST(heavy_hitters_keep_largest) {
+    HeavyHitters hitters(2);
+    hitters.offer(1, "a", 1, 5);
+    hitters.offer(2, "b", 1, 1);
+    hitters.offer(3, "c", 1, 3);
+    hitters.offer(4, "d", 1, 1);
+
+    const auto& candidates = hitters.getCandidates();
+    assert(candidates.size() == 2);
+    assert((candidates[0].key == "a" && candidates[1].key == "c") ||
+           (candidates[0].key == "c" && candidates[1].key == "a"));
+}
+
+TEST(traffic_top_subjects_and_publishers) {
+    Clock::time_point start = Clock::now();
+    TrafficStats stats(milliseconds(1000), 3, 512, start);
+
+    for (int i = 0; i < 500; i++) {
+        record(stats, "orders.new", "cid:1", 10, start);
+        record(stats, "noise." + std::to_string(i), "cid:" + std::to_string(100 + i), 1, start);
+    }
+    for (int i = 0; i < 20; i++) {
+        record(stats, "images.upload", "cid:2", 10000, start);
+    }
+
+    TrafficReport report = stats.getReport(start);
+    assert(report.windowMs == 1000);
+    assert(report.current.messages == 1020);
+    assert(report.current.bytes == 500 * 10 + 500 + 20 * 10000);
+
+    assert(report.current.subjectsByMessages.size() == 3);
+    assert(report.current.subjectsByMessages[0].key == "orders.new");
+    assert(report.current.subjectsByMessages[0].messages >= 500);
+    assert(report.current.subjectsByBytes[0].key == "images.upload");
+    assert(report.current.subjectsByBytes[0].bytes >= 200000);
+
+    assert(report.current.publishersByMessages[0].key == "cid:1");
+    assert(report.current.publishersByBytes[0].key == "cid:2");
+}
+
+TEST(traffic_windows_rotate) {
+    Clock::time_point start = Clock::now();
+    TrafficStats stats(milliseconds(100), 5, 512, start);
+
+    record(stats, "FOO", "cid:1", 5, start);
+    record(stats, "FOO", "cid:1", 5, start + milliseconds(10));
+
+    TrafficReport report = stats.getReport(start + milliseconds(150));
+    assert(report.current.messages == 0);
+    assert(report.previous.complete);
+    assert(report.previous.messages == 2);
+    assert(report.previous.subjectsByMessages[0].key == "FOO");
+    assert(report.previous.subjectsByMessages[0].messages == 2);
+
+    report = stats.getReport(start + milliseconds(450));
+    assert(report.current.messages == 0);
+    assert(report.previous.messages == 0);
+}
+
+TEST(traffic_stale_epoch_keeps_windows) {
+    Clock::time_point start = Clock::now();
+    TrafficStats stats(milliseconds(100), 5, 512, start);
+
+    record(stats, "FOO", "cid:1", 5, start);
+    record(stats, "BAR", "cid:1", 5, start + milliseconds(110));
+    record(stats, "BAR", "cid:2", 5, start + milliseconds(50));
+
+    TrafficReport report = stats.getReport(start + milliseconds(120));
+    assert(report.previous.messages == 1);
+    assert(report.current.messages == 2);
+
+    report = stats.getReport(start + milliseconds(20));
+    assert(report.previous.messages == 1);
+    assert(report.current.messages == 2);
+}
+
+TEST(traffic_report_json) {
+    TrafficReport report;
+    report.windowMs = 60000;
+    report.current.messages = 3;
+    report.current.bytes = 15;
+
+    TrafficEntry entry;
+    entry.key = "FOO\"BAR";
+    entry.messages = 3;
+    entry.bytes = 15;
+    report.current.subjectsByMessages.push_back(entry);
+
+    std::string json = TrafficStats::toJson(report);
+    assert(json.find("\"window_ms\":60000") != std::string::npos);
+    assert(json.find("{\"key\":\"FOO\\\"BAR\",\"msgs\":3,\"bytes\":15}") != std::string::npos);
+    assert(json.find("\"previous\":{\"complete\":false") != std::string::npos);
+}
+
+void traffic_stats_tests() {
+    std::cout << "Running TrafficStats tests...\n";
+
+    RUN_TEST(sketch_never_undercounts);
+    RUN_TEST(heavy_hitters_keep_largest);
+    RUN_TEST(traffic_top_subjects_and_publishers);
+    RUN_TEST(traffic_windows_rotate);
+    RUN_TEST(traffic_stale_epoch_keeps_windows);
+    RUN_TEST(traffic_report_json);
+
+    std::cout << "All traffic stats tests PASSED!\n";
+}
@@ -0,0 +1,238 @@
+#include "../include/WorkQueue.h"
+#include "../include/LocalHarness.h"
+#include <iostream>
+#include <cassert>
+
+using namespace pulse_broker;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) std::cout << "Running test: " << #name << "... "; test_##name(); std::cout << "PASSED" << std::endl;
+
+namespace {
+
+WorkQueueConfig queueConfig(const std::string& prefix, size_t maxMessages, int ackWaitMs) {
+    WorkQueueConfig config;
+    config.prefix = prefix;
+    config.maxMessages = maxMessages;
+    config.ackWaitMs = ackWaitMs;
+    return config;
+}
+
+FetchRequest fetchRequest(size_t batch, int expiresMs) {
+    FetchRequest request;
+    request.batch = batch;
+    request.expiresMs = expiresMs;
+    return request;
+}
+
+bool push(WorkQueues& queues, const std::string& subject, const std::string& payload,
+          std::vector<WorkBatch>& ready) {
+    return queues.push(subject, payload.data(), payload.size(), ready);
+}
+
+}
+
+TEST(work_queue_parses_fetch_requests) {
+    FetchRequest request;
+    assert(WorkQueues::parseFetchRequest(nullptr, 0, request));
+    assert(request.batch == 1 && request.expiresMs == 0);
+
+    std::string json = "{\"batch\":25, \"expires\": 5000}";
+    assert(WorkQueues::parseFetchRequest(json.data(), json.size(), request));
+    assert(request.batch == 25 && request.expiresMs == 5000);
+
+    json = "{\"expires\":100}";
+    assert(WorkQueues::parseFetchRequest(json.data(), json.size(), request));
+    assert(request.batch == 1 && request.expiresMs == 100);
+
+    json = "{\"batch\":0}";
+    assert(!WorkQueues::parseFetchRequest(json.data(), json.size(), request));
+    json = "{\"batch\":\"ten\"}";
+    assert(!WorkQueues::parseFetchRequest(json.data(), json.size(), request));
+    json = "10";
+    assert(!WorkQueues::parseFetchRequest(json.data(), json.size(), request));
+}
+
+TEST(work_queue_batches_and_bounds) {
+    WorkQueues queues({queueConfig("jobs.", 3, 1000)});
+    std::vector<WorkBatch> ready;
+
+    assert(!queues.matches("news") && queues.matches("jobs.resize"));
+    assert(push(queues, "jobs.resize", "a", ready));
+    assert(push(queues, "jobs.resize", "b", ready));
+    assert(push(queues, "jobs.resize", "c", ready));
+    assert(!push(queues, "jobs.resize", "d", ready));
+    assert(push(queues, "jobs.encode", "e", ready));
+    assert(ready.empty() && queues.getPendingCount() == 4);
+
+    assert(queues.fetch("jobs.resize", "_INBOX.w", fetchRequest(2, 0), ready));
+    assert(ready.size() == 1);
+    assert(ready[0].subject == "jobs.resize" && ready[0].inbox == "_INBOX.w");
+    assert(ready[0].messages.size() == 2);
+    assert(*ready[0].messages[0].payload == "a" && *ready[0].messages[1].payload == "b");
+    assert(ready[0].messages[0].deliveries == 1);
+    assert(queues.getInFlightCount() == 2 && queues.getPendingCount() == 2);
+
+    // Unacknowledged messages still count against the bound.
+    assert(!push(queues, "jobs.resize", "d", ready));
+    assert(queues.ack(ready[0].messages[0].sequence));
+    assert(!queues.ack(ready[0].messages[0].sequence));
+    assert(push(queues, "jobs.resize", "d", ready));
+
+    assert(!queues.fetch("news", "_INBOX.w", fetchRequest(1, 0), ready));
+
+    queues.clear();
+    assert(queues.getPendingCount() == 0 && queues.getInFlightCount() == 0 && queues.getMemoryUsage() == 0);
+}
+
+TEST(work_queue_redelivers_after_ack_wait) {
+    WorkQueues::Clock::time_point start = WorkQueues::Clock::now();
+    WorkQueues queues({queueConfig("jobs.", 10, 100)}, start);
+    std::vector<WorkBatch> ready;
+
+    assert(push(queues, "jobs.a", "x", ready));
+    assert(push(queues, "jobs.a", "y", ready));
+    assert(queues.fetch("jobs.a", "_INBOX.w", fetchRequest(2, 0), ready));
+    WorkBatch first = ready[0];
+    ready.clear();
+    assert(queues.ack(first.messages[1].sequence));
+
+    queues.advance(start + std::chrono::milliseconds(50), ready);
+    assert(ready.empty() && queues.getInFlightCount() == 1);
+
+    queues.advance(start + std::chrono::milliseconds(150), ready);
+    assert(ready.empty() && queues.getInFlightCount() == 0 && queues.getPendingCount() == 1);
+
+    assert(queues.fetch("jobs.a", "_INBOX.other", fetchRequest(5, 0), ready));
+    assert(ready.size() == 1 && ready[0].messages.size() == 1);
+    assert(ready[0].messages[0].sequence == first.messages[0].sequence);
+    assert(*ready[0].messages[0].payload == "x" && ready[0].messages[0].deliveries == 2);
+
+    std::vector<WorkBatch> nakked;
+    assert(queues.nak(ready[0].messages[0].sequence, nakked));
+    assert(nakked.empty() && queues.getPendingCount() == 1);
+}
+
+TEST(work_queue_waiting_fetches) {
+    WorkQueues::Clock::time_point start = WorkQueues::Clock::now();
+    WorkQueues queues({queueConfig("jobs.", 10, 1000)}, start);
+    std::vector<WorkBatch> ready;
+
+    // Nothing queued and no wait: the fetch ends at once, empty.
+    assert(queues.fetch("jobs.a", "_INBOX.1", fetchRequest(3, 0), ready));
+    assert(ready.size() == 1 && ready[0].messages.empty());
+    ready.clear();
+
+    assert(queues.fetch("jobs.a", "_INBOX.1", fetchRequest(3, 200), ready));
+    assert(queues.fetch("jobs.a", "_INBOX.2", fetchRequest(3, 50), ready));
+    assert(ready.empty() && queues.getWaitingCount() == 2);
+
+    assert(push(queues, "jobs.a", "x", ready));
+    assert(ready.size() == 1 && ready[0].inbox == "_INBOX.1" && ready[0].messages.size() == 1);
+    ready.clear();
+
+    queues.advance(start + std::chrono::milliseconds(100), ready);
+    assert(ready.size() == 1 && ready[0].inbox == "_INBOX.2" && ready[0].messages.empty());
+    assert(queues.getWaitingCount() == 0);
+}
+
+TEST(work_queue_save_and_restore) {
+    WorkQueues::Clock::time_point start = WorkQueues::Clock::now();
+    WorkQueues queues({queueConfig("jobs.", 10, 100)}, start);
+    std::vector<WorkBatch> ready;
+
+    assert(push(queues, "jobs.a", "x", ready));
+    assert(push(queues, "jobs.a", "y", ready));
+    assert(push(queues, "jobs.a", "z", ready));
+    assert(queues.fetch("jobs.a", "_INBOX.w", fetchRequest(1, 0), ready));
+    uint64_t delivered = ready[0].messages[0].sequence;
+    assert(queues.fetch("jobs.b", "_INBOX.w", fetchRequest(2, 500), ready));
+
+    WorkQueueState state;
+    queues.save(state);
+    assert(state.messages.size() == 3 && state.fetches.size() == 1);
+    assert(state.fetches[0].inbox == "_INBOX.w" && state.fetches[0].batch == 2);
+    assert(state.fetches[0].expiresMs > 0 && state.fetches[0].expiresMs <= 500);
+
+    WorkQueues restored({queueConfig("jobs.", 10, 100)}, start);
+    restored.restore(state);
+    assert(restored.getPendingCount() == 2 && restored.getInFlightCount() == 1);
+    assert(restored.getWaitingCount() == 1);
+    assert(restored.getMemoryUsage() == queues.getMemoryUsage());
+
+    // The waiting fetch is served by the next push, with a fresh sequence.
+    ready.clear();
+    assert(push(restored, "jobs.b", "w", ready));
+    assert(ready.size() == 1 && ready[0].inbox == "_INBOX.w");
+    assert(ready[0].messages[0].sequence > delivered + 2);
+    assert(restored.ack(ready[0].messages[0].sequence));
+
+    // Queued messages keep their order.
+    ready.clear();
+    assert(restored.fetch("jobs.a", "_INBOX.w", fetchRequest(5, 0), ready));
+    assert(ready[0].messages.size() == 2);
+    assert(*ready[0].messages[0].payload == "y" && *ready[0].messages[1].payload == "z");
+    assert(restored.ack(ready[0].messages[0].sequence) && restored.ack(ready[0].messages[1].sequence));
+
+    // The delivered one is still owed an ack and comes back after its ack
+    // wait, with its delivery count.
+    ready.clear();
+    restored.advance(start + std::chrono::milliseconds(150), ready);
+    assert(restored.getInFlightCount() == 0 && restored.getPendingCount() == 1);
+    assert(restored.fetch("jobs.a", "_INBOX.w", fetchRequest(1, 0), ready));
+    assert(ready[0].messages[0].sequence == delivered && ready[0].messages[0].deliveries == 2);
+}
+
+TEST(work_queue_pull_over_protocol) {
+    ServerOptions options;
+    options.workQueues.push_back(queueConfig("jobs.", 3, 30000));
+    LocalHarness harness(options);
+    assert(harness.start());
+
+    int worker = harness.connect();
+    int publisher = harness.connect();
+    assert(worker >= 0 && publisher >= 0);
+
+    harness.send(worker, "CONNECT {\"verbose\":false}\r\nSUB jobs.resize 1\r\nSUB _INBOX.w 2\r\nPING\r\n");
+    assert(harness.receive(worker) == "PONG\r\n");
+
+    harness.send(publisher, "CONNECT {\"verbose\":false}\r\nPUB jobs.resize 1\r\na\r\nPUB jobs.resize 1\r\nb\r\n"
+                            "PUB jobs.resize 1\r\nc\r\nPUB jobs.resize 1\r\nd\r\nPING\r\n");
+    std::string replies;
+    std::string full = "-ERR 'Work Queue Full'\r\nPONG\r\n";
+    assert(harness.receiveExactly(publisher, full.size(), replies));
+    assert(replies == full);
+
+    std::string request = "{\"batch\":2}";
+    harness.send(worker, "PUB $WQ.FETCH.jobs.resize _INBOX.w " + std::to_string(request.size()) + "\r\n" +
+                         request + "\r\n");
+    std::string expected = "MSG jobs.resize 2 $WQ.ACK.1.1 1\r\na\r\nMSG jobs.resize 2 $WQ.ACK.2.1 1\r\nb\r\n";
+    std::string messages;
+    assert(harness.receiveExactly(worker, expected.size(), messages));
+    assert(messages == expected);
+
+    harness.send(worker, "PUB $WQ.ACK.1.1 0\r\n\r\nPUB $WQ.ACK.2.1 4\r\n-NAK\r\nPUB $WQ.FETCH.jobs.resize _INBOX.w "
+                         "0\r\n\r\nPING\r\n");
+    expected = "MSG jobs.resize 2 $WQ.ACK.2.2 1\r\nb\r\nPONG\r\n";
+    assert(harness.receiveExactly(worker, expected.size(), messages));
+    assert(messages == expected);
+
+    MemoryReport report = harness.getServer().getMemoryReport();
+    assert(report.workQueueMessages == 2 && report.workQueueBytes > 0);
+
+    harness.send(worker, "PUB $WQ.FETCH.news _INBOX.w 0\r\n\r\n");
+    assert(harness.receive(worker) == "-ERR 'Invalid Work Queue Request'\r\n");
+}
+
+void work_queue_tests() {
+    std::cout << "Running work queue tests...\n";
+
+    RUN_TEST(work_queue_parses_fetch_requests);
+    RUN_TEST(work_queue_batches_and_bounds);
+    RUN_TEST(work_queue_redelivers_after_ack_wait);
+    RUN_TEST(work_queue_waiting_fetches);
+    RUN_TEST(work_queue_save_and_restore);
+    RUN_TEST(work_queue_pull_over_protocol);
+
+    std::cout << "All work queue tests PASSED!\n";
+}